@@ -1,4 +1,8 @@
 #include "all_abstx.h"
+#include "../types/cb_function.h"
+
+#include <set>
+#include <sstream>
 
 
 Seq<Owned<Abstx_identifier>> Global_scope::type_identifiers;
@@ -30,6 +34,76 @@ Shared<Abstx_function_literal> Abstx_node::parent_function() const
 }
 
 
+// functions with at most this many statements are inlined if they don't call anything and don't have inner scopes
+// this covers accessors and small arithmetic helpers, where the call costs more than the body
+static const int max_auto_inline_statements = 4;
+
+bool Abstx_function_literal::inlined() const
+{
+    if (is_inline) return true;
+    if (!is_codegen_ready(scope.status) || scope.statements.size > max_auto_inline_statements) return false;
+    for (const auto& st : scope.statements) {
+        Shared<Abstx_function_call> call = dynamic_pointer_cast<Abstx_function_call>(st);
+        if (call && !call->compile_time) return false; // not a leaf function
+        if (dynamic_pointer_cast<Abstx_if>(st) || dynamic_pointer_cast<Abstx_for>(st) || dynamic_pointer_cast<Abstx_while>(st)
+            || dynamic_pointer_cast<Abstx_anonymous_scope>(st) || dynamic_pointer_cast<Abstx_c_code>(st)) {
+            return false; // might be arbitrarily large
+        }
+    }
+    return true;
+}
+
+
+void Abstx_c_code::generate_code(std::ostream& target) const
+{
+    ASSERT(is_codegen_ready(status));
+    global_scope()->generated_c_code++;
+    target << c_code << std::endl;
+}
+
+
+uint64_t Abstx_scope::declaration_arena_uid() const
+{
+    for (Shared<const Abstx_scope> scope = this; scope != nullptr; scope = scope->parent_scope()) {
+        if (scope->arena_uid) return scope->arena_uid;
+        if (dynamic_pointer_cast<const Abstx_function_scope>(scope)) break; // the arena doesn't reach into called functions
+        Shared<const Abstx_for_scope> fs = dynamic_pointer_cast<const Abstx_for_scope>(scope);
+        if (fs && fs->loop() && fs->loop()->parallel) break; // nor into the chunk functions of parallel loops, which run on other threads
+    }
+    return 0;
+}
+
+
+void Abstx_declaration::generate_arena_bindings(std::ostream& target) const
+{
+    uint64_t arena_uid = parent_scope()->declaration_arena_uid();
+    if (!arena_uid) return;
+    for (const auto& id : identifiers) {
+        std::ostringstream name;
+        id->generate_code(name);
+        id->get_type()->generate_arena_binding(target, name.str(), "&_cb_arena_" + std::to_string(arena_uid));
+    }
+}
+
+
+void Abstx_return::generate_code(std::ostream& target) const
+{
+    ASSERT(is_codegen_ready(status));
+    // release all #arena scopes that are left, innermost first
+    Shared<Abstx_function_scope> fn_scope = nullptr;
+    for (Shared<Abstx_scope> scope = parent_scope(); scope != nullptr && fn_scope == nullptr; scope = scope->parent_scope()) {
+        scope->generate_arena_end(target);
+        fn_scope = dynamic_pointer_cast<Abstx_function_scope>(scope);
+    }
+    target << "return";
+    if (fn_scope && fn_scope->return_value) {
+        target << " "; // the only out argument is returned by value (see CB_Function::returns_value())
+        fn_scope->return_value->generate_code(target);
+    }
+    target << ";" << std::endl;
+}
+
+
 
 
 Token_iterator Abstx_node::parse_begin() const {
@@ -60,10 +134,100 @@ struct Constant_data_container
     }
 };
 
+void Global_scope::generate_functions(std::ostream& definitions, std::ostream& declarations)
+{
+    // generating a function body might add more functions and parallel loops, and the chunk function of a parallel loop
+    //     might do the same -> repeat until nothing new is found
+    std::set<uint64_t> generated;
+    uint32_t generated_loops = 0;
+    bool done = false;
+    while (!done) {
+        done = true;
+        for (const auto& fn : used_functions) {
+            if (generated.insert(fn.first).second) {
+                ASSERT(fn.second); // no function can be nullpointer here
+                fn.second->generate_declaration(definitions, declarations);
+                done = false;
+                break; // used_functions might have changed
+            }
+        }
+        if (done && generated_loops < parallel_loops.size) {
+            parallel_loops[generated_loops++]->generate_parallel_body(definitions);
+            done = false;
+        }
+    }
+}
+
+std::string Global_scope::generate_used_globals(Seq<Shared<const Abstx_identifier>>& unknown)
+{
+    // the declarations might use more globals and functions, which might use more globals -> repeat until nothing new is found
+    std::map<const Statement*, std::string> declarations;
+    std::set<const Abstx_identifier*> checked;
+    bool done = false;
+    while (!done) {
+        std::ostringstream functions;
+        generate_functions(functions, functions); // only done to fill in used_functions and used_globals
+        done = true;
+        for (const auto& g : used_globals) {
+            if (!checked.insert(g.first).second) continue;
+            Shared<Statement> decl = dynamic_pointer_cast<Statement>(g.second->owner);
+            if (decl == nullptr || decl->global_scope().v != this || declarations.count(decl.v)) continue; // imported globals are declared by their own file
+            if (!is_codegen_ready(decl->status)) {
+                unknown.add(g.second);
+                continue;
+            }
+            std::ostringstream code;
+            decl->generate_code(code);
+            declarations[decl.v] = code.str();
+            done = false;
+            break; // used_globals might have changed
+        }
+    }
+
+    std::ostringstream target;
+    for (const auto& st : statements) {
+        auto decl = declarations.find(st.v);
+        if (decl != declarations.end()) target << decl->second;
+    }
+    return target.str();
+}
+
+void Global_scope::generate_program(const std::string& code, std::ostream& target)
+{
+    std::ostringstream declarations; // functions are called directly -> all must be declared before the first definition
+    std::ostringstream definitions;
+    generate_functions(definitions, declarations);
+
+    // all types are known at this point
+    generate_typedefs(target);
+    target << declarations.str();
+    target << code;
+
+    // the async thunks are found while generating the function bodies, but have to be declared before them
+    // the thread pool and the channels need threads (and atomics, futexes, ...) -> programs that don't use them don't get them
+    if (uses_async_runtime()) {
+        target << "#define _CB_ASYNC_IMPLEMENTATION" << std::endl;
+        target << "#include \"cb_async.h\"" << std::endl;
+    }
+    if (uses_channels) {
+        target << "#define _CB_CHANNEL_IMPLEMENTATION" << std::endl;
+        target << "#include \"cb_channel.h\"" << std::endl;
+    }
+    target << "#include \"cb_arena.h\"" << std::endl;
+    for (const auto& sig : async_signatures) {
+        sig.second->generate_async_thunk(target);
+    }
+    for (const auto& loop : parallel_loops) {
+        loop->generate_parallel_declaration(target);
+    }
+    target << definitions.str();
+}
+
+
 static Constant_data_container _constant_data_container;
 
 void add_constant_data(void* p) { _constant_data_container.add_constant_data(p); }
-void* alloc_constant_data(size_t bytes) { _constant_data_container.add_constant_data(malloc(bytes)); }
+void* alloc_constant_data(size_t bytes) { void* p = malloc(bytes); _constant_data_container.add_constant_data(p); return p; }
 void free_constant_data(void* p) { _constant_data_container.free_constant_data(p); }
 void free_all_constant_data() { _constant_data_container.~Constant_data_container(); }
 
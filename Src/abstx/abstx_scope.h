@@ -4,6 +4,7 @@
 #include "statements/abstx_using.h"
 #include "expressions/abstx_identifier.h"
 #include "../utilities/flag.h"
+#include "../parser/dependency_graph.h"
 #include "../types/cb_string.h"
 
 #include <map>
@@ -18,6 +19,7 @@ Dynamic scopes perform each action in order. An identifier can only be used afte
 Syntax:
 {...} // Anonymous scope
 Async {...} // Anonymous scope with keywords
+#arena {...} // Anonymous scope where everything is allocated in a bump arena, released at the end of the scope (see backend_c/cb_arena.h)
 Name := {...}; // Named scope
 Name := Async {...}; // Named scope with keywords
 */
@@ -25,8 +27,13 @@ Name := Async {...}; // Named scope with keywords
 const flag SCOPE_ASYNC = 1;
 const flag SCOPE_DYNAMIC = 2;
 const flag SCOPE_SELF_CONTAINED = 3; // should be set if the scope never references identifiers outside itself.
+const flag SCOPE_ARENA = 4; // containers declared in the scope grow in an arena; set for the #arena scope and inherited by all scopes inside it
 
 struct Abstx_function_call;
+struct Abstx_for;
+struct CB_Function;
+struct Global_scope;
+Parsing_status run_all_waves(Shared<Global_scope> gs); // implemented in compile_time/run_batch.cpp
 
 struct Abstx_scope : Abstx_node
 {
@@ -43,6 +50,9 @@ struct Abstx_scope : Abstx_node
     bool dynamic() const { return flags == SCOPE_DYNAMIC; }
     bool async() const { return flags == SCOPE_ASYNC; }
     bool self_contained() const { return flags == SCOPE_SELF_CONTAINED; }
+    bool arena() const { return flags == SCOPE_ARENA; } // no destructors has to be generated, all memory is released with the arena
+
+    uint64_t arena_uid = 0; // set if this scope begins a new arena; the arena is named _cb_arena_<uid> in the generated code
 
     Abstx_scope() {}
     Abstx_scope(uint8_t flags) : flags{flags+SCOPE_SELF_CONTAINED} {}
@@ -173,12 +183,23 @@ struct Abstx_scope : Abstx_node
     void generate_code(std::ostream& target) const override {
         ASSERT(is_codegen_ready(status), status << " " << toS() << " at " << context.toS());
         target << "{" << std::endl;
+        if (arena_uid) target << "_cb_arena _cb_arena_" << arena_uid << " = {0};" << std::endl;
         for (const auto& st : statements) {
             st->generate_code(target);
         }
+        generate_arena_end(target);
         target << "}" << std::endl;
     };
 
+    // the uid of the innermost arena that contains this scope within its function (or parallel loop body), or 0 if there is none
+    // containers declared in this scope are bound to that arena (see CB_Type::generate_arena_binding())
+    uint64_t declaration_arena_uid() const; // implemented in abstx_implementations.cpp
+
+    // releases the arena begun by this scope, if any. Also used by return statements inside the scope.
+    void generate_arena_end(std::ostream& target) const {
+        if (arena_uid) target << "_cb_arena_end(&_cb_arena_" << arena_uid << ");" << std::endl;
+    }
+
     virtual Parsing_status fully_parse(); // implemented in statement_parser.cpp
 
 };
@@ -191,6 +212,17 @@ struct Global_scope : Abstx_scope
     std::string file_name;
     const Seq<Token> tokens; // should be treated as const
     std::map<uint64_t, Shared<const Abstx_function_literal>> used_functions; // map fn_id_uid -> abstx_fn
+    std::map<const Abstx_identifier*, Shared<const Abstx_identifier>> used_globals; // variables in a static scope, used by the generated code
+    Dependency_graph dependencies; // all statements in static scopes
+    std::map<uint32_t, Shared<const CB_Function>> async_signatures; // map fn type uid -> fn type, for all function types used in async calls
+    Seq<Shared<const Abstx_for>> parallel_loops; // all parallel for loops; their chunk functions are generated separately from the function code
+    bool uses_channels = false; // set when code that creates or uses a channel is generated
+    int generated_c_code = 0; // the number of #c statements generated; code that contains #c can't be cached (see run_cache.h)
+    Seq<Shared<Abstx_function_literal>> reached_functions; // function literals whose scopes should be parsed, in the order they were reached
+    uint32_t parsed_functions = 0; // the number of reached_functions whose scopes have been parsed
+    Seq<Shared<Abstx_function_call>> parallel_calls; // function calls in parallel for loops; checked for side effects when the called functions are parsed
+    uint32_t checked_parallel_calls = 0; // the number of parallel_calls that have been checked
+    Seq<int> infix_operators; // the symbols of the infix operators declared in this file (see operator_table.h)
 
     Global_scope(Seq<Token>&& tokens) : tokens{std::move(tokens)} {
         add_built_in_types_as_identifiers();
@@ -206,19 +238,57 @@ struct Global_scope : Abstx_scope
         Abstx_scope::fully_parse(); // first pass reading of statements
         ASSERT(status == Parsing_status::PARTIALLY_PARSED, status);
 
-        // fully resolve statements
-        for (auto& s : statements) {
-            s->fully_parse();
-            if (is_error(s->status) && !is_fatal(status)) status = s->status;
-            if (is_fatal(status)) return status; // give up
+        // fully resolve statements, in dependency order
+        // (#run statements are already added by read_run_expression())
+        // cycles are reported when the #run statements are done (see run_all_waves())
+        for (auto& s : statements) dependencies.add_node(s);
+        Parsing_status dep_status = dependencies.resolve(false);
+        if (is_error(dep_status) && !is_fatal(status)) status = dep_status;
+        if (is_fatal(status)) return status; // give up
+
+        // evaluate #run statements; the results might unblock other statements
+        Parsing_status run_status = run_all_waves(this);
+        if (is_error(run_status) && !is_fatal(status)) status = run_status;
+
+        // parse everything that can be reached from the entry point
+        Shared<Abstx_identifier> entry_point = identifiers["main"];
+        if (entry_point != nullptr && is_codegen_ready(entry_point->status) && entry_point->has_constant_value()) {
+            reach(entry_point->get_constant_value());
         }
-
-        // @TODO: find entry point
-        // fully_parse the entry point's function scope
+        Parsing_status fn_status = parse_reached_functions();
+        if (is_error(fn_status) && !is_fatal(status)) status = fn_status;
 
         return status;
     }
 
+    // Function scopes are parsed on demand. A function is reached when it's referenced from the entry point (main),
+    //   from a #run statement, or from the scope of another reached function.
+    // Only reached functions are type checked and generated, so unused functions (e.g. in imported files) are only read up to their signatures.
+    // from is the node that references the function; its function gets fn in referenced_functions
+    void reach(const Any& fn_value, Shared<Abstx_node> from = nullptr); // does nothing if fn_value isn't a function literal; implemented in expression_parser.cpp
+    void reach(Shared<Abstx_function_literal> fn, Shared<Abstx_node> from = nullptr);
+    // parses the scopes of all reached functions, including the ones reached while doing so
+    // then logs an error for each new inline function that can reach itself, since it can't be inlined,
+    //   and for each new call from a parallel for loop to a function with side effects
+    Parsing_status parse_reached_functions();
+
+    // Generates all used functions and the chunk functions of all parallel for loops, including the ones found while doing so.
+    void generate_functions(std::ostream& definitions, std::ostream& declarations); // implemented in abstx_implementations.cpp
+
+    // Returns the declarations of the global variables in this file that the used functions need, in statement order.
+    // #run statements are compiled without the rest of the global scope, so these are added to their code (see run_batch.h).
+    // Variables whose declarations aren't resolved yet are skipped, and added to unknown.
+    std::string generate_used_globals(Seq<Shared<const Abstx_identifier>>& unknown); // implemented in abstx_implementations.cpp
+
+    // true if the generated code has async calls or parallel for loops, which need the thread pool in backend_c/cb_async.h
+    bool uses_async_runtime() const { return !async_signatures.empty() || parallel_loops.size > 0; }
+
+    // Generates a complete C program: the types, the used functions, and the runtime they need (headers, async thunks, parallel loops).
+    // The async and channel runtimes are only included if the generated code uses them (see uses_async_runtime() and uses_channels).
+    // code uses the functions, and must be generated first, since that fills in used_functions.
+    // It's placed after the function declarations. Used both for the compiled program and for #run statements.
+    void generate_program(const std::string& code, std::ostream& target); // implemented in abstx_implementations.cpp
+
 private:
     static Seq<Owned<Abstx_identifier>> type_identifiers;
     static Token_context built_in_context;
@@ -258,6 +328,7 @@ private:
 struct Abstx_function_scope : Abstx_scope
 {
     std::map<std::string, Owned<Abstx_identifier>> fn_identifiers; // id name -> id. Identifiers are owned by the function scope.
+    Shared<Abstx_identifier> return_value = nullptr; // the out argument, if it's returned as the C return value (see CB_Function::returns_value())
 
     Abstx_function_scope() : Abstx_scope((uint64_t)SCOPE_DYNAMIC) {}
 
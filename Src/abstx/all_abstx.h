@@ -2,6 +2,7 @@
 #include "abstx_scope.h"
 #include "statements/abstx_assignment.h"
 #include "statements/abstx_c_code.h"
+#include "statements/abstx_channel_send.h"
 #include "statements/abstx_declaration.h"
 #include "statements/abstx_defer.h"
 #include "statements/abstx_for.h"
@@ -18,10 +19,15 @@
 #include "expressions/abstx_simple_literal.h"
 #include "expressions/abstx_struct_literal.h"
 #include "expressions/abstx_sequence_literal.h"
+#include "expressions/abstx_channel.h"
+#include "expressions/abstx_map.h"
+#include "expressions/abstx_infix_operator.h"
+#include "expressions/abstx_prefix_operator.h"
 
 #include "expressions/variable_expression.h"
-// #include "expressions/abstx_array_index.h" // this should maybe be handled by an operator
+#include "expressions/abstx_seq_index.h"
 #include "expressions/abstx_identifier.h"
 #include "expressions/abstx_identifier_reference.h"
 #include "expressions/abstx_pointer_dereference.h"
 #include "expressions/abstx_struct_getter.h"
+#include "expressions/abstx_vector.h"
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "value_expression.h"
+#include "../../types/cb_channel.h"
+
+#include <sstream>
+
+/*
+Channel expressions (see types/cb_channel.h)
+
+chan T          // channel type
+chan(N) T       // new channel with room for N values
+<- c            // receive one value from c
+*/
+
+// chan T, or chan(N) T
+struct Abstx_channel_literal : Value_expression {
+    Owned<Value_expression> member_type_expr;
+    bool is_type = true; // false if a new channel should be created
+    uint64_t capacity = 0;
+    Shared<const CB_Type> channel_type = nullptr; // set when finalized
+    Any const_value;
+
+    std::string toS() const override {
+        std::ostringstream oss;
+        oss << "chan";
+        if (!is_type) oss << "(" << capacity << ")";
+        oss << " ";
+        if (member_type_expr) oss << member_type_expr->toS();
+        return oss.str();
+    }
+
+    Shared<const CB_Type> get_type() override {
+        if (is_type) return CB_Type::type;
+        return channel_type;
+    }
+
+    bool has_constant_value() const override {
+        return is_type && channel_type != nullptr;
+    }
+
+    const Any& get_constant_value() override {
+        if (const_value.v_ptr != nullptr || !has_constant_value()) return const_value;
+        const_value.v_type = CB_Type::type;
+        const_value.v_ptr = (void*)&channel_type->uid;
+        return const_value;
+    }
+
+    void generate_code(std::ostream& target) const override
+    {
+        ASSERT(is_codegen_ready(status));
+        Shared<const CB_Channel> ct = static_pointer_cast<const CB_Channel>(channel_type);
+        if (is_type) ct->generate_type(target);
+        else {
+            global_scope()->uses_channels = true;
+            ct->generate_new(target, capacity);
+        }
+    }
+
+    void finalize() override {
+        if (is_error(status) || is_codegen_ready(status)) return;
+        ASSERT(member_type_expr);
+        member_type_expr->finalize();
+        if (is_error(member_type_expr->status) || member_type_expr->status == Parsing_status::DEPENDENCIES_NEEDED) {
+            status = member_type_expr->status;
+            return;
+        }
+        Shared<const CB_Type> t = member_type_expr->get_type();
+        if (t == nullptr || *t != *CB_Type::type || !member_type_expr->has_constant_value()) {
+            log_error("Channel member type must be a type known at compile time", member_type_expr->context);
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        channel_type = CB_Channel::get_channel_type(parse_type(member_type_expr->get_constant_value()));
+        status = Parsing_status::FULLY_RESOLVED;
+    }
+};
+
+
+// <- c
+struct Abstx_channel_receive : Value_expression {
+    Owned<Value_expression> channel;
+
+    std::string toS() const override {
+        ASSERT(channel);
+        return "<- " + channel->toS();
+    }
+
+    Shared<const CB_Type> get_type() override {
+        ASSERT(channel);
+        Shared<const CB_Channel> ct = dynamic_pointer_cast<const CB_Channel>(channel->get_type());
+        if (ct == nullptr) return nullptr;
+        return ct->v_type;
+    }
+
+    bool has_constant_value() const override { return false; }
+
+    const Any& get_constant_value() override {
+        static const Any no_value;
+        return no_value;
+    }
+
+    void generate_code(std::ostream& target) const override
+    {
+        ASSERT(is_codegen_ready(status));
+        Shared<const CB_Channel> ct = dynamic_pointer_cast<const CB_Channel>(channel->get_type());
+        global_scope()->uses_channels = true;
+        ct->generate_receive(target);
+        target << "(";
+        channel->generate_code(target);
+        target << ")";
+    }
+
+    void finalize() override {
+        if (is_error(status) || is_codegen_ready(status)) return;
+        ASSERT(channel);
+        channel->finalize();
+        if (is_error(channel->status) || channel->status == Parsing_status::DEPENDENCIES_NEEDED) {
+            status = channel->status;
+            return;
+        }
+        if (dynamic_pointer_cast<const CB_Channel>(channel->get_type()) == nullptr) {
+            log_error("Receive from non-channel expression", channel->context);
+            add_note("Expression has type " + channel->get_type()->toS());
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        status = Parsing_status::FULLY_RESOLVED;
+    }
+};
@@ -4,11 +4,34 @@
 #include "../abstx_scope.h"
 #include "../../types/cb_function.h"
 
+#include <map>
+#include <vector>
+
 /*
 Syntax:
 foo : fn(int, int)->(int, int) = fn(a: int, b: int)->(c: int, d: int) { return a, b; };
 sum : fn(int, int)->int = fn(a: int, b: int)->int { return a+b; }; // only one return value -> don't need the paren
 bar : fn() = fn() {}; // no return value -> don't need the arrow
+
+Function literals with $ in their in arguments are generic (see CB_Generic_function).
+Only the arguments are examined when a generic literal is read; the whole literal is read again for each specialization.
+
+The function scope is skipped when the literal is read, and is only parsed once the function is reached (see Global_scope::reach()).
+Functions that are never reached are generated as NULL.
+
+A function with exactly one out argument returns it as the C return value (see CB_Function::returns_value()).
+    The out argument is then a local variable in the generated function.
+
+square :: inline fn(a: int)->int { return a*a; };
+
+Inline functions are generated as static inline, always_inline C functions, which the C compiler inlines at every call.
+    An inline function that can reach itself (directly or through other functions) can't be inlined, and is an error
+    (see Global_scope::parse_reached_functions()).
+Small leaf functions (see inlined()) are generated as static inline even if they aren't marked inline. The C compiler decides
+    whether to inline them, so they are not inlined in #run dlls, which are compiled without optimization.
+
+A function has side effects if it, or any function it reaches, writes to a global variable or through a pointer,
+    or contains #c code (see find_side_effect()). Functions without side effects can be called from parallel for loops.
 */
 
 struct Abstx_function_literal : Value_expression
@@ -21,6 +44,20 @@ struct Abstx_function_literal : Value_expression
         bool explicit_uninitialized = false;
         bool generic_id = false; // $ marker on the identifier -> value must be known at compile time of function call
         bool generic_type = false; // $ marker on the type -> type must be known at compile time of function call
+        std::string generic_type_name = ""; // T in $T
+    };
+
+    // the inferred types of the $T arguments and the compile time values of the $a arguments, in argument order
+    struct Specialization_key {
+        std::vector<CB_Type::c_typedef> types;
+        std::vector<std::string> values; // as c literals
+        bool operator<(const Specialization_key& key) const { return types < key.types || (types == key.types && values < key.values); }
+    };
+
+    // the names and values that replaces the generic arguments when a specialization is read
+    struct Generic_bindings {
+        std::map<std::string, Shared<const CB_Type>> types;
+        std::map<std::string, Any> values;
     };
 
     Abstx_identifier function_identifier; // contains the hidden name and type of the function
@@ -28,6 +65,14 @@ struct Abstx_function_literal : Value_expression
     Seq<Function_arg> out_args; // out arguments metadata
     Abstx_function_scope scope; // function scope
 
+    bool generic = false; // only the specializations are compiled
+    std::map<Specialization_key, Owned<Abstx_function_literal>> specializations; // shared by all calls to the generic function
+    Shared<Abstx_function_literal> specialization_of = nullptr;
+    bool reached = false; // set when the function is queued for parsing of its scope
+    bool is_inline = false; // marked with inline
+    Seq<Shared<Abstx_function_literal>> referenced_functions; // functions reached from this scope (see Global_scope::reach())
+    Shared<Abstx_node> side_effect = nullptr; // the first statement in the scope that writes to a global, writes through a pointer, or is #c code
+
     std::string toS() const override {
         // @todo: write better toS()
         return "function";
@@ -57,6 +102,8 @@ struct Abstx_function_literal : Value_expression
     }
 
     void generate_code(std::ostream& target) const override {
+        if (generic) return CB_Generic_function::type->generate_literal(target, nullptr); // only exists at compile time
+        if (!reached) { target << "NULL"; return; } // never used -> the body isn't parsed or generated
         global_scope()->used_functions[function_identifier.uid] = this;
         return function_identifier.generate_code(target);
     }
@@ -70,12 +117,24 @@ struct Abstx_function_literal : Value_expression
 
     void finalize() override; // implemented in expression_parser.cpp
 
+    // true if the function is marked inline, or if the scope is small and doesn't call any other functions
+    bool inlined() const; // implemented in abstx_implementations.cpp
+
+    // the first side effect of the function or of any function it reaches, or nullptr if it has none
+    // only complete when all reached functions are parsed (see Global_scope::parse_reached_functions())
+    Shared<Abstx_node> find_side_effect() const; // implemented in expression_parser.cpp
+
 private:
     void generate_declaration_internal(std::ostream& target, bool header) const {
         ASSERT(is_codegen_ready(status));
+        Shared<Abstx_identifier> return_value = scope.return_value;
 
         // function declaration syntax
-        target << "void "; // all cb functions returns void
+        if (is_inline) target << "static inline __attribute__((always_inline)) ";
+        else if (inlined()) target << "static inline "; // the C compiler decides
+        if (return_value) return_value->get_type()->generate_type(target);
+        else target << "void"; // out arguments are returned through pointers
+        target << " ";
         function_identifier.generate_code(target);
         target << "(";
         for (int i = 0; i < in_args.size; ++i) {
@@ -88,8 +147,8 @@ private:
             }
             arg.identifier->generate_code(target);
         }
-        if (in_args.size > 0 && out_args.size > 0) target << ", ";
-        for (int i = 0; i < out_args.size; ++i) {
+        if (in_args.size > 0 && out_args.size > 0 && !return_value) target << ", ";
+        for (uint32_t i = 0; i < out_args.size && !return_value; ++i) {
             const auto& arg = out_args[i];
             if (i) target << ", ";
             arg.identifier->get_type()->generate_type(target);
@@ -98,7 +157,20 @@ private:
         }
         target << ")";
         if (header) target << ";" << std::endl;
-        else {
+        else if (return_value) {
+            Shared<const CB_Type> type = return_value->get_type();
+            target << " {" << std::endl;
+            type->generate_type(target);
+            target << " ";
+            return_value->generate_code(target);
+            target << " = ";
+            type->generate_literal(target, type->default_value().v_ptr);
+            target << ";" << std::endl;
+            scope.generate_code(target);
+            target << "return ";
+            return_value->generate_code(target);
+            target << ";" << std::endl << "}" << std::endl;
+        } else {
             target << " ";
             scope.generate_code(target);
         }
@@ -107,9 +179,16 @@ private:
         // int is primitive, T is not primitive
         // default values for a, b are set during the function call (another abstx node)
         /*
-        void foo(int a, T const* b, int* a, T* b) {
+        void foo(int a, T const* b, int* c, T* d) {
             // scope satatements
         }
+        int bar(int a, T const* b) {
+            int c = 0;
+            {
+                // scope satatements
+            }
+            return c;
+        }
         */
     }
 };
@@ -2,8 +2,10 @@
 
 #include "variable_expression.h"
 #include "../../types/cb_any.h"
+#include "../../types/cb_range.h" // CB_Iterable
 #include "../../utilities/unique_id.h"
 #include "../statements/abstx_statement.h"
+#include "../../parser/dependency_graph.h"
 
 #include <sstream>
 
@@ -17,6 +19,12 @@ struct Abstx_identifier : Variable_expression {
     // This can be non-standard CB values, for example be a function or scope expression
     Shared<Value_expression> value_expression = nullptr;
 
+    // set for iterators of for loops where the c iterator is an index (see CB_Iterable::iterator_is_index())
+    Shared<const CB_Iterable> iterated_by = nullptr;
+    std::string iterated_range = ""; // c name of the range that is iterated over
+
+    bool by_pointer = false; // set for arguments that are passed by pointer (non-primitive in arguments and out arguments); references to them are dereferenced
+
     std::string toS() const override {
         ASSERT(name.length() > 0);
         std::ostringstream oss;
@@ -63,7 +71,7 @@ struct Abstx_identifier : Variable_expression {
             // try to resolve the owning declaration statement
             Shared<Statement> decl = dynamic_pointer_cast<Statement>(owner);
             if (decl != nullptr) {
-                decl->fully_parse();
+                resolve_dependency(decl); // might be postponed until decl is resolved
             } else {
                 // id could be owned by a struct or function
                 ASSERT(is_error(status)); // if not error, we should have been able to infer type by now
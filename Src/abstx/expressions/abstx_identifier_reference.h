@@ -1,7 +1,10 @@
+#pragma once
+
 
 #include "variable_expression.h"
 #include "abstx_identifier.h"
 #include "../abstx_scope.h"
+#include "../../compile_time/constant_folding.h"
 
 /*
 An identifier reference is a variable expreesion, referencing a identifier defined somewhere else.
@@ -9,6 +12,8 @@ The reference is owned by the statement it is in.
 
 This class is mostly here so the same identifier can be used and "owned" by several places, while the original identifier
   is only declared once (and is owned by that declaration statement).
+
+References to constant numbers and bools are replaced with the value, as a literal (see compile_time/constant_folding.h).
 */
 
 struct Abstx_identifier_reference : Variable_expression {
@@ -37,6 +42,23 @@ struct Abstx_identifier_reference : Variable_expression {
 
     void generate_code(std::ostream& target) const override {
         ASSERT(id);
+        if (id->iterated_by) {
+            std::ostringstream it_name;
+            id->generate_code(it_name);
+            id->iterated_by->generate_iterator_value(target, id->iterated_range, it_name.str());
+            return;
+        }
+        if (id->has_constant_value() && is_foldable_type(id->get_type())) return id->get_constant_value().generate_literal(target);
+        if (id->by_pointer) {
+            target << "(*";
+            id->generate_code(target);
+            target << ")";
+            return;
+        }
+        Shared<Abstx_scope> scope = id->parent_scope();
+        if (scope != nullptr && !scope->dynamic() && id->get_type() != CB_Type::type) {
+            global_scope()->used_globals[id.v] = id; // see Global_scope::generate_used_globals()
+        }
         return id->generate_code(target);
     }
 
@@ -50,6 +72,7 @@ struct Abstx_identifier_reference : Variable_expression {
             id->finalize();
             status = id->status;
             // LOG("Abstx_identifier_reference.finalize(): finalized identifier " << name << " has status " << id->status);
+            if (is_codegen_ready(status) && id->has_constant_value()) global_scope()->reach(id->get_constant_value(), this); // referenced functions must be parsed
         } else {
             LOG("Abstx_identifier_reference.finalize(): failed to get identifier " << name << " -> setting Parsing_status::DEPENDENCIES_NEEDED");
             status = Parsing_status::DEPENDENCIES_NEEDED;
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "value_expression.h"
+#include "../../types/cb_primitives.h"
+#include "../../types/cb_vector.h"
+#include "../../compile_time/constant_folding.h"
+
+#include <sstream>
+
+/*
+Built-in infix operators on numbers and SIMD vectors (see types/cb_vector.h): + - * / %
+Both operands must have the same type, which is also the type of the result.
+Vector operators work element-wise. % is only defined for integer types.
+
+Comparison operators on numbers: < > <= >= == !=. == and != are also defined for bools. The result is a bool.
+Logical operators on bools: && ||. The right hand side is only evaluated if needed, as in C.
+
+a + b * c               // a + (b * c); * / % binds tighter than + - (see parser/operator_table.h)
+a < b && b < c          // (a < b) && (b < c); comparisons bind tighter than && and ||
+
+The operators are generated as native C operators (gcc vector extensions for vectors), so the C compiler can keep the operands in registers.
+If both operands are constant, the operator is evaluated at compile time with compile_time/built_in_operators.h,
+    which has the same semantics (see compile_time/constant_folding.h).
+*/
+struct Abstx_infix_operator : Value_expression {
+    std::string op;
+    Owned<Value_expression> lhs;
+    Owned<Value_expression> rhs;
+    Shared<const CB_Type> type = nullptr; // set when finalized
+    Any value; // set when finalized, if the operator could be evaluated at compile time
+
+    std::string toS() const override {
+        ASSERT(lhs && rhs);
+        return "(" + lhs->toS() + " " + op + " " + rhs->toS() + ")";
+    }
+
+    Shared<const CB_Type> get_type() override {
+        return type;
+    }
+
+    bool has_constant_value() const override { return value.v_ptr != nullptr; }
+
+    const Any& get_constant_value() override { return value; }
+
+    void generate_code(std::ostream& target) const override
+    {
+        ASSERT(is_codegen_ready(status));
+        if (value.v_ptr) return value.generate_literal(target);
+        target << "((";
+        type->generate_type(target);
+        target << ")(";
+        lhs->generate_code(target);
+        target << " " << op << " ";
+        rhs->generate_code(target);
+        target << "))";
+    }
+
+    void finalize() override {
+        if (is_error(status) || is_codegen_ready(status)) return;
+        ASSERT(lhs && rhs);
+        lhs->finalize();
+        rhs->finalize();
+        for (const auto& e : { Shared<Value_expression>(lhs), Shared<Value_expression>(rhs) }) {
+            if (is_error(e->status) || e->status == Parsing_status::DEPENDENCIES_NEEDED) {
+                status = e->status;
+                return;
+            }
+        }
+        Shared<const CB_Type> lhs_type = lhs->get_type();
+        Shared<const CB_Type> rhs_type = rhs->get_type();
+        if (*lhs_type != *rhs_type) {
+            log_error("Mismatched types for operator " + op, context);
+            add_note("Left hand side has type " + lhs_type->toS() + ", but right hand side has type " + rhs_type->toS());
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        if (!is_defined(op, lhs_type)) {
+            log_error("Operator " + op + " is not defined for type " + lhs_type->toS(), context);
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        type = is_comparison(op) || is_logical(op) ? CB_Bool::type : lhs_type;
+        if (lhs->has_constant_value() && rhs->has_constant_value()) {
+            fold_infix_operator(op, lhs->get_constant_value(), rhs->get_constant_value(), value);
+        }
+        status = Parsing_status::FULLY_RESOLVED;
+    }
+
+    // operand_name(): the type name used in built_in_operators.h, or "" if there are no built-in operators for the type
+    static std::string operand_name(Shared<const CB_Type> type) {
+        ASSERT(type);
+        if (*type == *CB_Int::type) return "i64";
+        if (*type == *CB_Uint::type) return "u64";
+        if (*type == *CB_f32::type) return "float";
+        if (*type == *CB_f64::type || *type == *CB_Float::type) return "double";
+        for (const auto& t : { CB_i8::type, CB_i16::type, CB_i32::type, CB_i64::type, CB_u8::type, CB_u16::type, CB_u32::type, CB_u64::type }) {
+            if (*type == *t) return t->toS();
+        }
+        if (dynamic_pointer_cast<const CB_Vector>(type)) return type->toS();
+        return "";
+    }
+
+    static bool is_comparison(const std::string& op) {
+        return op == "<" || op == ">" || op == "<=" || op == ">=" || op == "==" || op == "!=";
+    }
+
+    static bool is_logical(const std::string& op) {
+        return op == "&&" || op == "||";
+    }
+
+    // vectors are not compared, since the result would be a mask instead of a bool
+    static bool is_defined(const std::string& op, Shared<const CB_Type> type) {
+        bool is_bool = *type == *CB_Bool::type;
+        if (is_logical(op)) return is_bool;
+        if (op == "==" || op == "!=") return is_bool || (operand_name(type) != "" && !dynamic_pointer_cast<const CB_Vector>(type));
+        if (is_comparison(op)) return operand_name(type) != "" && !dynamic_pointer_cast<const CB_Vector>(type);
+        return operand_name(type) != "" && !(op == "%" && is_float(type));
+    }
+
+    static bool is_float(Shared<const CB_Type> type) {
+        Shared<const CB_Vector> vector_type = dynamic_pointer_cast<const CB_Vector>(type);
+        if (vector_type) type = vector_type->lane_type();
+        return *type == *CB_f32::type || *type == *CB_f64::type || *type == *CB_Float::type;
+    }
+};
+
+
+/*
+
+c := a + b * a;
+
+// Generates c-code:
+
+_cb_v4f32 c = ((_cb_v4f32)(a + ((_cb_v4f32)(b * a))));
+
+// the cast keeps the type of small integers, which are promoted to int by the C operator
+
+if (a * 2 == 8 && !done) { ... }
+
+// Generates c-code:
+
+if (((_cb_bool)(((_cb_bool)(((_cb_uint)(a * 2ULL)) == 8ULL)) && ((_cb_bool)!(done))))) { ... }
+
+*/
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "value_expression.h"
+#include "variable_expression.h"
+#include "../statements/abstx_for.h" // check_shared_write()
+#include "../../types/cb_map.h"
+
+#include <sstream>
+
+/*
+Map expressions (see types/cb_map.h)
+
+[K] V                   // map type
+["a"->1, "b"->2]        // new map; the types are taken from the first pair
+[string->int: ]         // new map with explicit types
+m[k]                    // the value of k in m; k is inserted if it's not in the map
+*/
+
+// [K] V, or a map literal
+struct Abstx_map_literal : Value_expression {
+    bool is_type = true; // false if a new map should be created
+    Owned<Value_expression> key_type_expr; // only set for map types and literals with explicit types
+    Owned<Value_expression> value_type_expr;
+    Seq<Owned<Value_expression>> keys;
+    Seq<Owned<Value_expression>> values;
+    Shared<const CB_Type> map_type = nullptr; // set when finalized
+    Any const_value;
+
+    std::string toS() const override {
+        std::ostringstream oss;
+        if (is_type) {
+            oss << "[" << (key_type_expr ? key_type_expr->toS() : "") << "] " << (value_type_expr ? value_type_expr->toS() : "");
+            return oss.str();
+        }
+        oss << "[";
+        if (key_type_expr) oss << key_type_expr->toS() << "->" << value_type_expr->toS() << ": ";
+        for (uint32_t i = 0; i < keys.size; ++i) {
+            if (i) oss << ", ";
+            oss << keys[i]->toS() << "->" << values[i]->toS();
+        }
+        oss << "]";
+        return oss.str();
+    }
+
+    Shared<const CB_Type> get_type() override {
+        if (is_type) return CB_Type::type;
+        return map_type;
+    }
+
+    bool has_constant_value() const override {
+        return is_type && map_type != nullptr;
+    }
+
+    const Any& get_constant_value() override {
+        if (const_value.v_ptr != nullptr || !has_constant_value()) return const_value;
+        const_value.v_type = CB_Type::type;
+        const_value.v_ptr = (void*)&map_type->uid;
+        return const_value;
+    }
+
+    void generate_code(std::ostream& target) const override
+    {
+        ASSERT(is_codegen_ready(status));
+        Shared<const CB_Map> mt = static_pointer_cast<const CB_Map>(map_type);
+        if (is_type) {
+            mt->generate_type(target);
+            return;
+        }
+        if (keys.size == 0) {
+            target << "(";
+            mt->generate_type(target);
+            target << "){0}";
+            return;
+        }
+        // same as CB_Map::generate_literal(), but with expressions instead of constant values
+        target << "({ ";
+        mt->generate_type(target);
+        target << " _cb_m = {0}; ";
+        for (uint32_t i = 0; i < keys.size; ++i) {
+            target << "*";
+            mt->generate_at(target);
+            target << "(&_cb_m, ";
+            keys[i]->generate_code(target);
+            target << ") = ";
+            values[i]->generate_code(target);
+            target << "; ";
+        }
+        target << "_cb_m; })";
+    }
+
+    void finalize() override; // implemented in expression_parser.cpp
+};
+
+
+// m[k]
+struct Abstx_map_index : Variable_expression {
+    Owned<Value_expression> map;
+    Owned<Value_expression> key;
+
+    std::string toS() const override {
+        ASSERT(map && key);
+        return map->toS() + "[" + key->toS() + "]";
+    }
+
+    Shared<const CB_Type> get_type() override {
+        ASSERT(map);
+        Shared<const CB_Map> mt = dynamic_pointer_cast<const CB_Map>(map->get_type());
+        if (mt == nullptr) return nullptr;
+        return mt->v_type;
+    }
+
+    bool has_constant_value() const override { return false; }
+
+    const Any& get_constant_value() override {
+        static const Any no_value;
+        return no_value;
+    }
+
+    void generate_code(std::ostream& target) const override
+    {
+        ASSERT(is_codegen_ready(status));
+        Shared<const CB_Map> mt = dynamic_pointer_cast<const CB_Map>(map->get_type());
+        target << "(*";
+        mt->generate_at(target);
+        target << "(&";
+        map->generate_code(target);
+        target << ", ";
+        key->generate_code(target);
+        target << "))";
+    }
+
+    void finalize() override {
+        if (is_error(status) || is_codegen_ready(status)) return;
+        ASSERT(map && key);
+        map->finalize();
+        key->finalize();
+        for (const auto& e : { Shared<Value_expression>(map), Shared<Value_expression>(key) }) {
+            if (is_error(e->status) || e->status == Parsing_status::DEPENDENCIES_NEEDED) {
+                status = e->status;
+                return;
+            }
+        }
+        Shared<const CB_Map> mt = dynamic_pointer_cast<const CB_Map>(map->get_type());
+        ASSERT(mt); // checked by the parser
+        if (*key->get_type() != *mt->k_type) {
+            log_error("Map key has the wrong type", key->context);
+            add_note("Expected " + mt->k_type->toS() + " but found " + key->get_type()->toS());
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        if (!check_shared_write(this, this)) {
+            add_note("Indexing a map adds the key if it's missing");
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        status = Parsing_status::FULLY_RESOLVED;
+    }
+};
+
+
+/*
+
+m := ["a"->1];
+m["b"] = 2;
+
+// Generates c-code:
+
+_cb_type_25 m = ({ _cb_type_25 _cb_m = {0}; *_cb_map_at_25(&_cb_m, "a") = 1; _cb_m; });
+(*_cb_map_at_25(&m, "b")) = 2;
+
+*/
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "value_expression.h"
+#include "abstx_infix_operator.h" // operand_name(), is_float()
+#include "../../types/cb_vector.h"
+#include "../../compile_time/constant_folding.h"
+
+#include <sstream>
+
+/*
+Built-in prefix operators on signed numbers and SIMD vectors (see types/cb_vector.h): -
+The result has the same type as the operand. Vector operators work element-wise.
+Logical not on bools: !
+
+-a * b                  // (-a) * b; prefix operators binds tighter than infix operators
+-v.x                    // -(v.x); suffix operators binds tighter than prefix operators
+
+A constant operand is negated at compile time (see compile_time/constant_folding.h).
+*/
+struct Abstx_prefix_operator : Value_expression {
+    std::string op;
+    Owned<Value_expression> operand;
+    Shared<const CB_Type> type = nullptr; // set when finalized
+    Any value; // set when finalized, if the operator could be evaluated at compile time
+
+    std::string toS() const override {
+        ASSERT(operand);
+        return "(" + op + operand->toS() + ")";
+    }
+
+    Shared<const CB_Type> get_type() override {
+        return type;
+    }
+
+    bool has_constant_value() const override { return value.v_ptr != nullptr; }
+
+    const Any& get_constant_value() override { return value; }
+
+    // the cast keeps the type of small integers, which are promoted to int by the C operator
+    void generate_code(std::ostream& target) const override
+    {
+        ASSERT(is_codegen_ready(status));
+        ASSERT(op == "-" || op == "!");
+        if (value.v_ptr) return value.generate_literal(target);
+        target << "((";
+        type->generate_type(target);
+        target << ")" << op << "(";
+        operand->generate_code(target);
+        target << "))";
+    }
+
+    void finalize() override {
+        if (is_error(status) || is_codegen_ready(status)) return;
+        ASSERT(operand);
+        operand->finalize();
+        if (is_error(operand->status) || operand->status == Parsing_status::DEPENDENCIES_NEEDED) {
+            status = operand->status;
+            return;
+        }
+        Shared<const CB_Type> operand_type = operand->get_type();
+        if (op == "!" ? *operand_type != *CB_Bool::type : !is_signed(operand_type)) {
+            log_error("Operator " + op + " is not defined for type " + operand_type->toS(), context);
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        type = operand_type;
+        if (operand->has_constant_value()) fold_prefix_operator(op, operand->get_constant_value(), value);
+        status = Parsing_status::FULLY_RESOLVED;
+    }
+
+private:
+    static bool is_signed(Shared<const CB_Type> type) {
+        std::string name = Abstx_infix_operator::operand_name(type);
+        if (name == "") return false;
+        if (Abstx_infix_operator::is_float(type)) return true;
+        Shared<const CB_Vector> vector_type = dynamic_pointer_cast<const CB_Vector>(type);
+        if (vector_type) name = Abstx_infix_operator::operand_name(vector_type->lane_type());
+        return name[0] == 'i';
+    }
+};
+
+
+/*
+
+b := -a * a;
+
+// Generates c-code:
+
+_cb_i64 b = ((_cb_i64)(((_cb_i64)-(a)) * a));
+
+*/
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "value_expression.h"
+#include "variable_expression.h"
+#include "abstx_identifier_reference.h"
+#include "abstx_infix_operator.h" // operand_name()
+#include "../statements/abstx_for.h"
+#include "../../types/cb_seq.h"
+#include "../../types/cb_soa_seq.h"
+
+#include <sstream>
+
+/*
+Sequence indexing (see types/cb_seq.h)
+
+s[i]                    // element i of s
+
+Indices outside of the sequence are handled by a checked index function (see CB_Indexable::generate_at()):
+    dynamic sequences grow if i >= size, and negative indices gives a temporary default value.
+
+The check is skipped when the index is known to be inside the sequence:
+    - a constant index in a static sequence
+    - the key of a loop over the same sequence, if the loop body can't resize the sequence or change the key
+    - the key of a loop over a static sequence that isn't larger than the indexed static sequence
+Indexing a #soa sequence gathers the members of the element into a struct, and assigning to it scatters them
+    (see types/cb_soa_seq.h).
+
+Since indexing might grow the sequence, a parallel for loop can only index sequences from outside the loop where
+    the index is known to be inside the sequence (see check_shared_write()).
+*/
+
+struct Abstx_seq_index : Variable_expression {
+    Owned<Value_expression> seq;
+    Owned<Value_expression> index;
+    Shared<const Abstx_for> bounds_loop = nullptr; // the loop whose key is the index, if that proves that the index is valid
+    bool constant_in_bounds = false;
+
+    std::string toS() const override {
+        ASSERT(seq && index);
+        return seq->toS() + "[" + index->toS() + "]";
+    }
+
+    Shared<const CB_Type> get_type() override {
+        ASSERT(seq);
+        if (auto seq_type = dynamic_pointer_cast<const CB_Seq>(seq->get_type())) return seq_type->v_type;
+        if (auto seq_type = dynamic_pointer_cast<const CB_Fixed_seq>(seq->get_type())) return seq_type->v_type;
+        if (auto seq_type = dynamic_pointer_cast<const CB_Soa_seq>(seq->get_type())) return static_pointer_cast<const CB_Type>(seq_type->v_type);
+        return nullptr;
+    }
+
+    bool has_constant_value() const override { return false; }
+
+    const Any& get_constant_value() override {
+        static const Any no_value;
+        return no_value;
+    }
+
+    // only known after the whole loop body is parsed
+    bool in_bounds() const {
+        return constant_in_bounds || (bounds_loop != nullptr && bounds_loop->key_in_bounds);
+    }
+
+    void generate_code(std::ostream& target) const override
+    {
+        ASSERT(is_codegen_ready(status));
+        Shared<const CB_Indexable> indexable = dynamic_pointer_cast<const CB_Indexable>(seq->get_type());
+        ASSERT(indexable); // checked by finalize()
+        std::ostringstream seq_code;
+        seq->generate_code(seq_code);
+
+        if (in_bounds()) {
+            indexable->generate_index_start(target, seq_code.str());
+            index->generate_code(target);
+            indexable->generate_index_end(target);
+        } else if (soa_type()) {
+            // the element is returned by value
+            indexable->generate_at(target);
+            target << "(&" << seq_code.str() << ", ";
+            index->generate_code(target);
+            target << ")";
+        } else {
+            target << "(*";
+            indexable->generate_at(target);
+            target << "(&" << seq_code.str() << ", ";
+            index->generate_code(target);
+            target << "))";
+        }
+    }
+
+    // the elements of a #soa sequence aren't c lvalues -> all members are set at once
+    void generate_assignment(std::ostream& target, const std::string& value) const override {
+        Shared<const CB_Soa_seq> soa = soa_type();
+        if (soa == nullptr) return Variable_expression::generate_assignment(target, value);
+        ASSERT(is_codegen_ready(status));
+        if (in_bounds()) soa->generate_set(target);
+        else soa->generate_put(target);
+        target << "(&";
+        seq->generate_code(target);
+        target << ", ";
+        index->generate_code(target);
+        target << ", " << value << ");" << std::endl;
+    }
+
+    // s[i].member in a #soa sequence only touches the array of the member, if i is known to be inside the sequence
+    // returns false if the member has to be read from the whole element instead
+    bool generate_member(std::ostream& target, const std::string& member) const {
+        Shared<const CB_Soa_seq> soa = soa_type();
+        if (soa == nullptr || !in_bounds()) return false;
+        std::ostringstream seq_code, index_code;
+        seq->generate_code(seq_code);
+        index->generate_code(index_code);
+        soa->generate_field_index(target, seq_code.str(), index_code.str(), member);
+        return true;
+    }
+
+    Shared<const CB_Soa_seq> soa_type() const { return dynamic_pointer_cast<const CB_Soa_seq>(seq->get_type()); }
+
+    void finalize() override {
+        if (is_error(status) || is_codegen_ready(status)) return;
+        ASSERT(seq && index);
+        seq->finalize();
+        index->finalize();
+        for (const auto& e : { Shared<Value_expression>(seq), Shared<Value_expression>(index) }) {
+            if (is_error(e->status) || e->status == Parsing_status::DEPENDENCIES_NEEDED) {
+                status = e->status;
+                return;
+            }
+        }
+        if (get_type() == nullptr) {
+            log_error("Indexing of non-sequence type " + seq->get_type()->toS(), context);
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        Shared<const CB_Type> index_type = index->get_type();
+        if (Abstx_infix_operator::operand_name(index_type) == "" || Abstx_infix_operator::is_float(index_type) || dynamic_pointer_cast<const CB_Vector>(index_type)) {
+            log_error("Sequence index of non-integer type " + index_type->toS(), index->context);
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+
+        Shared<const CB_Fixed_seq> fixed_type = dynamic_pointer_cast<const CB_Fixed_seq>(seq->get_type());
+        if (fixed_type && index->has_constant_value()) {
+            int64_t i = constant_index();
+            constant_in_bounds = i >= 0 && i < fixed_type->size;
+        }
+        bounds_loop = find_bounds_loop();
+        if (!fixed_type && !in_bounds()) {
+            // the sequence might grow, which is a write even if the element is only read
+            if (!check_shared_write(this, this)) {
+                add_note("Indexing outside of a sequence grows it");
+                status = Parsing_status::TYPE_ERROR;
+                return;
+            }
+            Shared<Abstx_identifier_reference> ref = dynamic_pointer_cast<Abstx_identifier_reference>((Shared<Value_expression>)seq);
+            if (ref) invalidate_loop_bounds(ref->id, this);
+        }
+        status = Parsing_status::FULLY_RESOLVED;
+    }
+
+private:
+    Shared<const Abstx_for> find_bounds_loop() const {
+        Shared<Abstx_identifier_reference> index_ref = dynamic_pointer_cast<Abstx_identifier_reference>((Shared<Value_expression>)index);
+        if (index_ref == nullptr || index_ref->id == nullptr) return nullptr;
+        for (Shared<Abstx_node> node = owner; node != nullptr; node = node->owner) {
+            Shared<Abstx_for_scope> fs = dynamic_pointer_cast<Abstx_for_scope>(node);
+            if (fs == nullptr) continue;
+            Shared<Abstx_for> loop = fs->loop();
+            if (loop == nullptr || loop->key.v != index_ref->id.v) continue;
+
+            // found the loop with the index as key
+            Shared<Abstx_identifier_reference> seq_ref = dynamic_pointer_cast<Abstx_identifier_reference>((Shared<Value_expression>)seq);
+            if (seq_ref && seq_ref->id != nullptr && loop->range_identifier().v == seq_ref->id.v) return loop;
+            Shared<const CB_Fixed_seq> fixed_type = dynamic_pointer_cast<const CB_Fixed_seq>(seq->get_type());
+            Shared<const CB_Fixed_seq> range_type = dynamic_pointer_cast<const CB_Fixed_seq>(loop->range->get_type());
+            if (fixed_type && range_type && range_type->size <= fixed_type->size) return loop;
+            return nullptr;
+        }
+        return nullptr;
+    }
+
+    int64_t constant_index() const {
+        const Any& value = index->get_constant_value();
+        ASSERT(value.v_ptr);
+        size_t size = value.v_type->cb_sizeof();
+        bool is_signed = Abstx_infix_operator::operand_name(value.v_type)[0] == 'i';
+        if (size == 1) return is_signed ? *(int8_t const*)value.v_ptr : *(uint8_t const*)value.v_ptr;
+        if (size == 2) return is_signed ? *(int16_t const*)value.v_ptr : *(uint16_t const*)value.v_ptr;
+        if (size == 4) return is_signed ? *(int32_t const*)value.v_ptr : *(uint32_t const*)value.v_ptr;
+        uint64_t v = *(uint64_t const*)value.v_ptr;
+        if (!is_signed && v > INT64_MAX) return -1; // too large for any sequence
+        return (int64_t)v;
+    }
+};
+
+
+/*
+
+s : [..] int;
+for (i, v in s) {
+    s[i] = v * 2;
+}
+s[10] = 1;
+
+// Generates c-code:
+
+{ _cb_type_20 _cb_range_21 = s;
+_cb_int v; for (_cb_i64 i = 0; i < _cb_range_21.size && (v = _cb_range_21.v_ptr[i], 1); ++i){
+s.v_ptr[i] = ...;
+}
+}
+(*_cb_seq_at_20(&s, 10ULL)) = 1ULL;
+
+*/
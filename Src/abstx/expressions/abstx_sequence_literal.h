@@ -3,6 +3,7 @@
 #include "value_expression.h"
 #include "../../types/cb_type.h"
 #include "../../types/cb_seq.h"
+#include "../../types/cb_soa_seq.h"
 
 struct Abstx_sequence_literal : Value_expression {
 
@@ -60,3 +61,39 @@ struct Abstx_sequence_literal : Value_expression {
     }
 };
 
+
+
+// [..] T, or [..] #soa T for a sequence of structs stored as one array per member
+struct Abstx_sequence_type : Value_expression {
+    bool soa = false;
+    Owned<Value_expression> value_type_expr;
+    Shared<const CB_Type> seq_type = nullptr; // set when finalized
+    Any const_value;
+
+    std::string toS() const override {
+        return std::string("[..] ") + (soa ? "#soa " : "") + (value_type_expr ? value_type_expr->toS() : "");
+    }
+
+    Shared<const CB_Type> get_type() override {
+        return CB_Type::type;
+    }
+
+    bool has_constant_value() const override {
+        return seq_type != nullptr;
+    }
+
+    const Any& get_constant_value() override {
+        if (const_value.v_ptr != nullptr || !has_constant_value()) return const_value;
+        const_value.v_type = CB_Type::type;
+        const_value.v_ptr = (void*)&seq_type->uid;
+        return const_value;
+    }
+
+    void generate_code(std::ostream& target) const override
+    {
+        ASSERT(is_codegen_ready(status));
+        seq_type->generate_type(target);
+    }
+
+    void finalize() override; // implemented in expression_parser.cpp
+};
@@ -2,6 +2,8 @@
 
 #include "variable_expression.h"
 #include "abstx_identifier.h"
+#include "abstx_identifier_reference.h"
+#include "abstx_seq_index.h" // #soa elements
 #include "../../types/cb_struct.h"
 
 struct Abstx_struct_getter : Variable_expression {
@@ -44,9 +46,43 @@ struct Abstx_struct_getter : Variable_expression {
     void generate_code(std::ostream& target) const override
     {
         ASSERT(is_codegen_ready(status));
+        std::ostringstream member_name;
+        member->id->generate_code(member_name);
+        Shared<Abstx_identifier_reference> ref = dynamic_pointer_cast<Abstx_identifier_reference>((Shared<Variable_expression>)struct_expr);
+        if (ref != nullptr && ref->id->iterated_by) {
+            // the iterator is an index, so only the array of this member is accessed
+            std::ostringstream it_name;
+            ref->id->generate_code(it_name);
+            ref->id->iterated_by->generate_iterator_member(target, ref->id->iterated_range, it_name.str(), member_name.str());
+            return;
+        }
+        Shared<Abstx_seq_index> index = dynamic_pointer_cast<Abstx_seq_index>((Shared<Variable_expression>)struct_expr);
+        if (index != nullptr && index->generate_member(target, member_name.str())) return;
         struct_expr->generate_code(target);
-        target << ".";
-        member->id->generate_code(target);
+        target << "." << member_name.str();
+    }
+
+    // a member of an element of a #soa sequence that might grow isn't a c lvalue
+    //   -> the element is read, changed and written back (see Abstx_seq_index::generate_assignment())
+    void generate_assignment(std::ostream& target, const std::string& value) const override {
+        std::string members = "";
+        Shared<const Abstx_struct_getter> getter = this;
+        for (; getter != nullptr; getter = dynamic_pointer_cast<const Abstx_struct_getter>((Shared<Variable_expression>)getter->struct_expr)) {
+            std::ostringstream member_name;
+            getter->member->id->generate_code(member_name);
+            members = "." + member_name.str() + members;
+            Shared<Abstx_seq_index> index = dynamic_pointer_cast<Abstx_seq_index>((Shared<Variable_expression>)getter->struct_expr);
+            if (index == nullptr || index->soa_type() == nullptr || index->in_bounds()) continue;
+            target << "{ ";
+            index->get_type()->generate_type(target);
+            target << " _cb_element = ";
+            index->generate_code(target);
+            target << "; _cb_element" << members << " = " << value << "; ";
+            index->generate_assignment(target, "_cb_element");
+            target << "}" << std::endl;
+            return;
+        }
+        Variable_expression::generate_assignment(target, value);
     }
 
     void finalize() override {
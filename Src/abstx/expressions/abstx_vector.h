@@ -0,0 +1,164 @@
+#pragma once
+
+#include "value_expression.h"
+#include "variable_expression.h"
+#include "abstx_infix_operator.h" // operand_name()
+#include "../../types/cb_vector.h"
+#include "../../types/cb_seq.h"
+
+#include <sstream>
+
+/*
+Vector expressions (see types/cb_vector.h)
+
+v4f32(x)                // every lane set to the number x, converted to the lane type
+v4f32(s, i)             // the elements s[i] to s[i+3] of a sequence of f32, loaded as a vector
+v4f32(s, i) = v;        // stores the vector in s[i] to s[i+3]
+
+The elements are accessed directly; the sequence is not grown, so i+3 must be less than the size of the sequence.
+*/
+
+// v4f32(x)
+struct Abstx_vector_splat : Value_expression {
+    Shared<const CB_Vector> vector_type;
+    Owned<Value_expression> value;
+
+    std::string toS() const override {
+        ASSERT(vector_type);
+        return vector_type->toS() + "(" + (value ? value->toS() : "") + ")";
+    }
+
+    Shared<const CB_Type> get_type() override {
+        return static_pointer_cast<const CB_Type>(vector_type);
+    }
+
+    bool has_constant_value() const override { return false; }
+
+    const Any& get_constant_value() override {
+        static const Any no_value;
+        return no_value;
+    }
+
+    void generate_code(std::ostream& target) const override
+    {
+        ASSERT(is_codegen_ready(status));
+        // gcc converts the scalar to a vector with the same value in all lanes
+        target << "((";
+        vector_type->generate_type(target);
+        target << "){0} + (";
+        vector_type->lane_type()->generate_type(target);
+        target << ")(";
+        value->generate_code(target);
+        target << "))";
+    }
+
+    void finalize() override {
+        if (is_error(status) || is_codegen_ready(status)) return;
+        ASSERT(vector_type && value);
+        value->finalize();
+        if (is_error(value->status) || value->status == Parsing_status::DEPENDENCIES_NEEDED) {
+            status = value->status;
+            return;
+        }
+        Shared<const CB_Type> type = value->get_type();
+        if (Abstx_infix_operator::operand_name(type) == "" || dynamic_pointer_cast<const CB_Vector>(type)) {
+            log_error("Unable to set the lanes of " + vector_type->toS() + " from a value of type " + type->toS(), value->context);
+            add_note("Expected a number");
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        status = Parsing_status::FULLY_RESOLVED;
+    }
+};
+
+
+// v4f32(s, i)
+struct Abstx_vector_view : Variable_expression {
+    Shared<const CB_Vector> vector_type;
+    Owned<Value_expression> seq;
+    Owned<Value_expression> index;
+
+    std::string toS() const override {
+        ASSERT(vector_type && seq && index);
+        return vector_type->toS() + "(" + seq->toS() + ", " + index->toS() + ")";
+    }
+
+    Shared<const CB_Type> get_type() override {
+        return static_pointer_cast<const CB_Type>(vector_type);
+    }
+
+    bool has_constant_value() const override { return false; }
+
+    const Any& get_constant_value() override {
+        static const Any no_value;
+        return no_value;
+    }
+
+    // an unaligned vector pointer to the first element, so it can be used both as a value and as an lvalue
+    void generate_code(std::ostream& target) const override
+    {
+        ASSERT(is_codegen_ready(status));
+        std::ostringstream seq_code;
+        seq->generate_code(seq_code);
+        std::ostringstream index_code;
+        index->generate_code(index_code);
+
+        target << "(*(";
+        vector_type->generate_type(target);
+        target << "_unaligned*)&";
+        indexable()->generate_index_start(target, seq_code.str());
+        target << index_code.str();
+        indexable()->generate_index_end(target);
+        target << ")";
+    }
+
+    void finalize() override {
+        if (is_error(status) || is_codegen_ready(status)) return;
+        ASSERT(vector_type && seq && index);
+        seq->finalize();
+        index->finalize();
+        for (const auto& e : { Shared<Value_expression>(seq), Shared<Value_expression>(index) }) {
+            if (is_error(e->status) || e->status == Parsing_status::DEPENDENCIES_NEEDED) {
+                status = e->status;
+                return;
+            }
+        }
+        Shared<const CB_Type> v_type = nullptr;
+        if (auto seq_type = dynamic_pointer_cast<const CB_Seq>(seq->get_type())) v_type = seq_type->v_type;
+        else if (auto seq_type = dynamic_pointer_cast<const CB_Fixed_seq>(seq->get_type())) v_type = seq_type->v_type;
+        if (v_type == nullptr || *v_type != *vector_type->lane_type()) {
+            log_error("Unable to load " + vector_type->toS() + " from a value of type " + seq->get_type()->toS(), seq->context);
+            add_note("Expected a sequence of " + vector_type->lane_type()->toS());
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        Shared<const CB_Type> index_type = index->get_type();
+        if (Abstx_infix_operator::operand_name(index_type) == "" || Abstx_infix_operator::is_float(index_type) || dynamic_pointer_cast<const CB_Vector>(index_type)) {
+            log_error("Sequence index of non-integer type " + index_type->toS(), index->context);
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        status = Parsing_status::FULLY_RESOLVED;
+    }
+
+private:
+    Shared<const CB_Indexable> indexable() const {
+        Shared<const CB_Indexable> indexable = dynamic_pointer_cast<const CB_Indexable>(seq->get_type());
+        ASSERT(indexable); // checked by finalize()
+        return indexable;
+    }
+};
+
+
+/*
+
+s : [..] f32;
+v := v4f32(s, 4) * v4f32(2.0);
+v4f32(s, 0) = v;
+
+// Generates c-code:
+
+_cb_v4f32 v = ((_cb_v4f32)((*(_cb_v4f32_unaligned*)&s.v_ptr[4ULL]) * ((_cb_v4f32){0} + (_cb_f32)(2))));
+(*(_cb_v4f32_unaligned*)&s.v_ptr[0ULL]) = v;
+
+*/
@@ -5,7 +5,12 @@
 // An evaluated variable is anything that can be assigned a value.
 struct Variable_expression : Value_expression
 {
-
+    // value is the c code of the assigned value
+    // the generated code of most variables is a c lvalue; the ones that aren't (see Abstx_seq_index) override this
+    virtual void generate_assignment(std::ostream& target, const std::string& value) const {
+        generate_code(target);
+        target << " = " << value << ";" << std::endl;
+    }
 };
 
 
@@ -45,6 +50,11 @@ struct Variable_expression_reference : Variable_expression {
         return expr->generate_code(target);
     }
 
+    void generate_assignment(std::ostream& target, const std::string& value) const override {
+        ASSERT(expr);
+        return expr->generate_assignment(target, value);
+    }
+
     void finalize() override {
         ASSERT(expr);
         expr->finalize();
@@ -53,11 +53,10 @@ struct Abstx_assignment : Statement {
         ASSERT(is_codegen_ready(status));
         ASSERT(lhs.size == rhs.size);
         for (int i = 0; i < lhs.size; ++i) {
-            lhs[i]->generate_code(target); // this should be a valid c style lvalue
-            target << " = ";
-            if (rhs.size == 1) rhs[0]->generate_code(target);
-            else rhs[i]->generate_code(target);
-            target << ";" << std::endl;
+            std::ostringstream value;
+            if (rhs.size == 1) rhs[0]->generate_code(value);
+            else rhs[i]->generate_code(value);
+            lhs[i]->generate_assignment(target, value.str());
         }
     };
 
@@ -34,9 +34,6 @@ struct Abstx_c_code : Statement {
 
     Parsing_status fully_parse() override; // implemented in statement_parser.cpp
 
-    void generate_code(std::ostream& target) const override {
-        ASSERT(is_codegen_ready(status));
-        target << c_code << std::endl;
-    };
+    void generate_code(std::ostream& target) const override; // implemented in abstx_implementations.cpp
 
 };
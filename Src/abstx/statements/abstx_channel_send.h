@@ -0,0 +1,80 @@
+#pragma once
+
+#include "abstx_statement.h"
+#include "../expressions/value_expression.h"
+#include "../expressions/abstx_channel.h"
+#include "../../types/cb_channel.h"
+
+#include <sstream>
+
+/*
+Syntax:
+c <- 5;         // sends 5 to the channel c. Blocks while the channel is full.
+<- c;           // receives one value from c and throws it away. Blocks while the channel is empty.
+*/
+
+struct Abstx_channel_send : Statement {
+
+    Owned<Value_expression> channel;
+    Owned<Value_expression> value;
+
+    std::string toS() const override {
+        ASSERT(channel != nullptr);
+        ASSERT(value != nullptr);
+        return channel->toS() + " <- " + value->toS() + ";";
+    }
+
+    Parsing_status fully_parse() override; // implemented in statement_parser.cpp
+
+    void generate_code(std::ostream& target) const override {
+        ASSERT(is_codegen_ready(status));
+        Shared<const CB_Channel> ct = dynamic_pointer_cast<const CB_Channel>(channel->get_type());
+        ASSERT(ct);
+        global_scope()->uses_channels = true;
+        ct->generate_send(target);
+        target << "(";
+        channel->generate_code(target);
+        target << ", ";
+        value->generate_code(target);
+        target << ");" << std::endl;
+    };
+
+};
+
+
+// a receive expression used as a statement; it still has to wait for a value
+struct Abstx_channel_receive_statement : Statement {
+
+    Owned<Value_expression> receive;
+
+    std::string toS() const override {
+        ASSERT(receive != nullptr);
+        return receive->toS() + ";";
+    }
+
+    Parsing_status fully_parse() override {
+        if (is_error(status) || is_codegen_ready(status)) return status;
+        receive->finalize();
+        status = receive->status;
+        return status;
+    }
+
+    void generate_code(std::ostream& target) const override {
+        ASSERT(is_codegen_ready(status));
+        receive->generate_code(target);
+        target << ";" << std::endl;
+    };
+};
+
+
+/*
+
+c <- a;
+<- c;
+
+// Generates c-code:
+
+_cb_chan_send_25(c, a);
+_cb_chan_recv_25(c);
+
+*/
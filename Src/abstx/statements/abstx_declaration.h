@@ -66,12 +66,15 @@ struct Abstx_declaration : Statement {
     void generate_code(std::ostream& target) const override {
         ASSERT(is_codegen_ready(status), "something went wrong in declaration "+toS());
         if (value_expressions.empty()) {
-            // explicit uninitialized
+            // default values
             for (int i = 0; i < identifiers.size; ++i) {
                 ASSERT(identifiers[i]); // can't be nullpointer
-                identifiers[i]->get_type()->generate_type(target);
+                Shared<const CB_Type> t = identifiers[i]->get_type();
+                t->generate_type(target);
                 target << " ";
                 identifiers[i]->generate_code(target); // this should be a variable name
+                target << " = ";
+                t->generate_literal(target, t->default_value().v_ptr);
                 target << ";" << std::endl;
             }
         } else {
@@ -86,8 +89,12 @@ struct Abstx_declaration : Statement {
                 target << ";" << std::endl;
             }
         }
+        generate_arena_bindings(target);
     };
 
+    // containers declared inside an #arena scope grow in the arena (see backend_c/cb_arena.h)
+    void generate_arena_bindings(std::ostream& target) const; // implemented in abstx_implementations.cpp
+
 };
 
 
@@ -3,39 +3,118 @@
 #include "abstx_statement.h"
 #include "../abstx_scope.h"
 #include "../expressions/value_expression.h"
+#include "../expressions/variable_expression.h"
+#include "../expressions/abstx_identifier.h"
+#include "../expressions/abstx_identifier_reference.h"
 #include "../../utilities/unique_id.h"
 #include "../../types/cb_range.h" // CB_Iterable
 
+#include <map>
+#include <sstream>
+
 /*
 for (n in range) {}
 for (n in range, step=s) {}
-for (n in range, index=s) {}
 for (n in range, reverse) {}
+for (k, v in map) {}
+for (i, v in seq) {}        // i is the index of v
+
+Indexing the sequence that is looped over with the loop index, as in
+    for (i, v in s) { s[i] = v + 1; }
+    doesn't need to check the index as long as the loop body can't resize s or change i (see Abstx_seq_index).
+If the body might resize s (for example with s[1000] = 0, or by reading s[j] with an index that isn't known to be valid),
+    the size and the elements are read from s in each iteration, so the loop also visits the elements added by the body.
+
+Parallel for: the iterations are split into chunks that are run on the async thread pool (see backend_c/cb_async.h)
+for #parallel (n in range) {}
+for #parallel (n in range, reduce(+: sum), reduce(max: m)) {}
+for #parallel (i, v in s) { s[i] = v * 2; }
+
+The body of a parallel for may read any variable, but it may only write to variables declared inside the loop,
+    to its reduction variables, and to the elements of sequences indexed by its key (each iteration has its own element).
+    Each chunk works on its own copy of the reduction variables, starting from the identity of the operator
+    (0 for +, 1 for *, the current value for min and max). The copies are combined with the original variable when
+    all chunks are done.
+Reduction operators: + * min max
+Everything that might change memory shared between the chunks is an error in a parallel body (see check_shared_write()):
+    indexing that might grow a sequence or a map from outside the loop, writes through pointers,
+    and calls to functions with side effects (see Abstx_function_literal::find_side_effect()).
 */
 
+struct Abstx_for;
+
+// The scope of a for loop keeps track of all identifiers from outside the loop that are used inside it.
+// Parallel loops use this to know which variables to pass to the chunks, and which writes to forbid.
+struct Abstx_for_scope : Abstx_scope
+{
+    std::map<std::string, Shared<Abstx_identifier>> captures; // id name -> identifier declared outside the loop
+
+    Abstx_for_scope(uint8_t flags) : Abstx_scope(flags) {}
+
+    Shared<Abstx_identifier> get_identifier(const std::string& id, bool recursive=true) override
+    {
+        auto local = identifiers.find(id);
+        if (local != identifiers.end() && local->second != nullptr) return local->second;
+        Shared<Abstx_identifier> p = Abstx_scope::get_identifier(id, recursive);
+        if (p != nullptr) captures[id] = p;
+        return p;
+    }
+
+    Shared<Abstx_for> loop() const;
+};
+
+
 struct Abstx_for : Statement {
 
-    Owned<Abstx_identifier> range = nullptr; // type has to be subclass of CB_Iterable
+    struct Reduction {
+        std::string op; // + * min max
+        Shared<Abstx_identifier> id;
+        Token_context context;
+    };
+
+    Owned<Value_expression> range = nullptr; // type has to be subclass of CB_Iterable
     Shared<const CB_Iterable> iterable_type = nullptr; // the type of range, put here for convenience
     bool reverse = false;
     uint64_t step = 1;
-    bool anonymous_range = false; // if anonymous,
+    bool parallel = false;
+    Seq<Reduction> reductions;
+    uint64_t uid = 0; // used for unique c names
+
+    Owned<Abstx_for_scope> scope;
+    Owned<Abstx_identifier> it; // the iterator variable, declared in the scope
+    Owned<Abstx_identifier> key = nullptr; // only for iterables with keys (maps and sequences)
+    bool key_in_bounds = true; // set to false if the body might resize the range or change the key, see invalidate_loop_bounds()
+    bool range_changes = false; // set if the body might resize or replace the range variable, see invalidate_loop_bounds()
 
-    Owned<Abstx_scope> scope;
-    Shared<Abstx_identifier> it; // owned by the scope
+    std::string range_name() const { return "_cb_range_" + std::to_string(uid); } // the range is evaluated once, before the loop
 
-    std::string toS() const override { return "for(){}"; }
+    // the c name that the elements and the bound are read through in each iteration
+    // normally the copy of the range, but if the body might move the elements of the range variable, the copy would
+    //   still point to the freed memory. The variable itself is read instead, so the loop sees the new size and elements.
+    std::string iterated_name() const {
+        Shared<Abstx_identifier> range_id = range_identifier();
+        if (!range_changes || range_id == nullptr || !iterable_type->reallocates()) return range_name();
+        return c_name(range_id);
+    }
+
+    std::string toS() const override {
+        std::ostringstream oss;
+        oss << "for ";
+        if (parallel) oss << "#parallel ";
+        oss << "(";
+        if (key) oss << key->name << ", ";
+        if (it) oss << it->name << " in ";
+        if (range) oss << range->toS();
+        if (step != 1) oss << ", step=" << step;
+        if (reverse) oss << ", reverse";
+        for (const auto& r : reductions) oss << ", reduce(" << r.op << ": " << r.id->name << ")";
+        oss << ") {}";
+        return oss.str();
+    }
 
     void debug_print(Debug_os& os, bool recursive=true) const override
     {
-        // FIXME: better for::toS()
-
-        os << "For(";
-        if (recursive) {
-            ASSERT(range != nullptr);
-            os << range->toS();
-        }
-        os << ") ";
+        os << toS() << " ";
         if (recursive) {
             ASSERT(scope != nullptr);
             scope->debug_print(os, recursive);
@@ -45,24 +124,171 @@ struct Abstx_for : Statement {
 
     Parsing_status fully_parse() override; // implemented in statement_parser.cpp
 
+    // the identifier that is looped over, if the range is just a variable
+    Shared<Abstx_identifier> range_identifier() const {
+        Shared<Abstx_identifier_reference> ref = dynamic_pointer_cast<Abstx_identifier_reference>((Shared<Value_expression>)range);
+        return ref ? ref->id : nullptr;
+    }
+
+    bool is_reduction(Shared<Abstx_identifier> id) const {
+        for (const auto& r : reductions) {
+            if (r.id.v == id.v) return true;
+        }
+        return false;
+    }
+
+    static bool is_reducible_type(Shared<const CB_Type> t) {
+        if (t == nullptr) return false;
+        for (const auto& nt : { CB_i8::type, CB_i16::type, CB_i32::type, CB_i64::type, CB_Int::type,
+                                CB_u8::type, CB_u16::type, CB_u32::type, CB_u64::type, CB_Uint::type,
+                                CB_f32::type, CB_f64::type, CB_Float::type }) {
+            if (*t == *nt) return true;
+        }
+        return false;
+    }
+
     void generate_code(std::ostream& target) const override {
         ASSERT(is_codegen_ready(status));
 
-        if (anonymous_range) {
-            // declare range
-            target << "{ ";
-            range->generate_code(target);
-            target << " = ";
-            range->value.generate_literal(target);
-            target << "; ";
+        // the range expression is evaluated once, before the loop
+        target << "{ ";
+        range->get_type()->generate_type(target);
+        target << " " << range_name() << " = ";
+        range->generate_code(target);
+        target << ";" << std::endl;
+
+        if (parallel) generate_parallel_call(target);
+        else {
+            if (key) iterable_type->generate_for_key_value(target, iterated_name(), key->name, it->name, true);
+            else iterable_type->generate_for(target, iterated_name(), it->name, step, reverse, true);
+            scope->generate_code(target);
+            iterable_type->generate_for_after_scope(target, true);
+        }
+
+        target << "}" << std::endl;
+    }
+
+    // context struct and prototype of the chunk function, printed before all function code
+    void generate_parallel_declaration(std::ostream& target) const {
+        ASSERT(parallel);
+        target << "typedef struct { ";
+        range->get_type()->generate_type(target);
+        target << " _cb_range; ";
+        for (const auto& id : captured_variables()) {
+            generate_captured_type(target, id);
+            target << " " << c_name(id) << "; ";
+        }
+        for (uint32_t i = 0; i < reductions.size; ++i) {
+            reductions[i].id->get_type()->generate_type(target);
+            target << " " << c_name(reductions[i].id) << "; ";
+            reductions[i].id->get_type()->generate_type(target);
+            target << "* _cb_red_" << i << "; ";
         }
+        target << "} _cb_pfor_ctx_" << uid << ";" << std::endl;
+        target << "static void _cb_pfor_" << uid << "(void* _cb_ctx_p, int64_t _cb_begin, int64_t _cb_end, int _cb_chunk);" << std::endl;
+    }
 
-        iterable_type->generate_for(target, range->name, it->name, step, reverse, anonymous_range);
+    // the chunk function: runs the loop body for the iteration indices [_cb_begin, _cb_end)
+    void generate_parallel_body(std::ostream& target) const {
+        ASSERT(parallel);
+        target << "static void _cb_pfor_" << uid << "(void* _cb_ctx_p, int64_t _cb_begin, int64_t _cb_end, int _cb_chunk) {" << std::endl;
+        target << "_cb_pfor_ctx_" << uid << "* _cb_ctx = (_cb_pfor_ctx_" << uid << "*)_cb_ctx_p;" << std::endl;
+        range->get_type()->generate_type(target);
+        target << " " << range_name() << " = _cb_ctx->_cb_range;" << std::endl;
+        for (const auto& id : captured_variables()) {
+            generate_captured_type(target, id);
+            target << " " << c_name(id) << " = _cb_ctx->" << c_name(id) << ";" << std::endl;
+        }
+        for (const auto& r : reductions) {
+            r.id->get_type()->generate_type(target);
+            target << " " << c_name(r.id) << " = ";
+            if (r.op == "+") target << "0";
+            else if (r.op == "*") target << "1";
+            else target << "_cb_ctx->" << c_name(r.id); // min, max
+            target << ";" << std::endl;
+        }
+        target << "for (int64_t _cb_i = _cb_begin; _cb_i < _cb_end; ++_cb_i) {" << std::endl;
+        if (key) {
+            key->get_type()->generate_type(target);
+            target << " " << key->name << " = _cb_i;" << std::endl; // loops with keys have no step and aren't reversed
+        }
+        iterable_type->generate_iterator_declaration(target, it->name);
+        target << " = ";
+        iterable_type->generate_element(target, range_name(), "_cb_i", step, reverse);
+        target << ";" << std::endl;
         scope->generate_code(target);
-        iterable_type->generate_for_after_scope(target);
+        target << "}" << std::endl;
+        for (uint32_t i = 0; i < reductions.size; ++i) {
+            target << "_cb_ctx->_cb_red_" << i << "[_cb_chunk] = " << c_name(reductions[i].id) << ";" << std::endl;
+        }
+        target << "}" << std::endl;
+    }
+
+private:
 
-        if (anonymous_range) {
-            // close brace from before
+    // captured variables that are passed by value to the chunks: local variables from outside the loop
+    // variables in static scopes are c globals, and can be used directly
+    Seq<Shared<Abstx_identifier>> captured_variables() const {
+        Seq<Shared<Abstx_identifier>> ids;
+        for (const auto& c : scope->captures) {
+            Shared<Abstx_scope> s = c.second->parent_scope();
+            if (s == nullptr || !s->dynamic() || is_reduction(c.second)) continue;
+            ids.add(c.second);
+        }
+        return ids;
+    }
+
+    // arguments that are passed by pointer are captured as the pointer; the loop body can't write to them anyway
+    static void generate_captured_type(std::ostream& target, Shared<Abstx_identifier> id) {
+        id->get_type()->generate_type(target);
+        if (id->by_pointer) target << " const*";
+    }
+
+    static std::string c_name(Shared<Abstx_identifier> id) {
+        std::ostringstream oss;
+        id->generate_code(oss);
+        return oss.str();
+    }
+
+    void generate_parallel_call(std::ostream& target) const {
+        Shared<Global_scope> gs = global_scope();
+        bool registered = false;
+        for (const auto& l : gs->parallel_loops) {
+            if (l.v == this) registered = true;
+        }
+        if (!registered) gs->parallel_loops.add(Shared<const Abstx_for>(this));
+
+        std::string ctx = "_cb_ctx_" + std::to_string(uid);
+        std::string n = "_cb_n_" + std::to_string(uid);
+        std::string chunks = "_cb_chunks_" + std::to_string(uid);
+
+        target << "_cb_pfor_ctx_" << uid << " " << ctx << ";" << std::endl;
+        target << ctx << "._cb_range = " << range_name() << ";" << std::endl;
+        for (const auto& id : captured_variables()) {
+            target << ctx << "." << c_name(id) << " = " << c_name(id) << ";" << std::endl;
+        }
+        target << "int64_t " << n << " = ";
+        iterable_type->generate_count(target, range_name(), step);
+        target << ";" << std::endl;
+        target << "int " << chunks << " = _cb_async_chunk_count(" << n << ");" << std::endl;
+        for (uint32_t i = 0; i < reductions.size; ++i) {
+            reductions[i].id->get_type()->generate_type(target);
+            target << " _cb_red_" << uid << "_" << i << "[" << chunks << "];" << std::endl;
+            target << ctx << "." << c_name(reductions[i].id) << " = " << c_name(reductions[i].id) << ";" << std::endl;
+            target << ctx << "._cb_red_" << i << " = _cb_red_" << uid << "_" << i << ";" << std::endl;
+        }
+        target << "_cb_async_parallel_for(" << n << ", " << chunks << ", _cb_pfor_" << uid << ", &" << ctx << ");" << std::endl;
+
+        // combine the partial results
+        if (reductions.size > 0) {
+            target << "if (" << n << " > 0) for (int _cb_c = 0; _cb_c < " << chunks << "; ++_cb_c) {" << std::endl;
+            for (uint32_t i = 0; i < reductions.size; ++i) {
+                std::string v = c_name(reductions[i].id);
+                std::string p = "_cb_red_" + std::to_string(uid) + "_" + std::to_string(i) + "[_cb_c]";
+                const std::string& op = reductions[i].op;
+                if (op == "+" || op == "*") target << v << " = " << v << " " << op << " " << p << ";" << std::endl;
+                else target << "if (" << p << (op == "min" ? " < " : " > ") << v << ") " << v << " = " << p << ";" << std::endl;
+            }
             target << "}" << std::endl;
         }
     }
@@ -70,15 +296,85 @@ struct Abstx_for : Statement {
 };
 
 
+inline Shared<Abstx_for> Abstx_for_scope::loop() const { return dynamic_pointer_cast<Abstx_for>(owner); }
+
+
+// the innermost parallel for loop around node, or nullptr
+inline Shared<Abstx_for> enclosing_parallel_loop(Shared<Abstx_node> node) {
+    for (; node != nullptr; node = node->owner) {
+        Shared<Abstx_for_scope> fs = dynamic_pointer_cast<Abstx_for_scope>(node);
+        if (fs && fs->loop() && fs->loop()->parallel) return fs->loop();
+    }
+    return nullptr;
+}
+
+// Called for everything that writes to a variable: assignments, out arguments, and indexing that might grow a sequence or a map.
+// Returns false (and logs an error) if target is shared between the chunks of a parallel for loop that writer is inside of.
+// Writes to globals and through pointers are also recorded as side effects of the function of writer.
+bool check_shared_write(Shared<Variable_expression> target, Shared<Abstx_node> writer); // implemented in statement_parser.cpp
+
+
+// Called for everything in a loop body that might change a variable: assignments, growing sequence indexing, function calls and c code.
+// The loops around node that are over id, or that has id as their key, can no longer assume that the key is a valid index,
+//     and loops over id read their elements through id instead of through the copy of the range (see Abstx_for::iterated_name()).
+// If id is null, any variable might change. With only_globals set, loops over local variables are not affected
+//     (function calls can't change local variables, except through their out arguments).
+inline void invalidate_loop_bounds(Shared<Abstx_identifier> id, Shared<Abstx_node> node, bool only_globals = false) {
+    for (; node != nullptr; node = node->owner) {
+        Shared<Abstx_for_scope> fs = dynamic_pointer_cast<Abstx_for_scope>(node);
+        if (fs == nullptr) continue;
+        Shared<Abstx_for> loop = fs->loop();
+        if (loop == nullptr) continue;
+        Shared<Abstx_identifier> range_id = loop->range_identifier();
+        bool range_changes = false, key_changes = false;
+        if (id == nullptr) {
+            Shared<Abstx_scope> s = range_id ? range_id->parent_scope() : nullptr;
+            range_changes = !only_globals || s == nullptr || !s->dynamic();
+        } else {
+            range_changes = range_id.v == id.v;
+            key_changes = loop->key && loop->key.v == id.v;
+        }
+        if (range_changes) loop->range_changes = true;
+        if (loop->key && (range_changes || key_changes)) loop->key_in_bounds = false;
+    }
+}
+
+
 /*
 
+for (n in r) {}
+for #parallel (n in s, reduce(+: sum)) {}
+
 // Generates c-code:
 
-for (double n = range.start; n <= range.end; n+=step) {} // reverse = false
-for (double n = range.end; n >= range.start; n-=step) {} // reverse = true
+{ _cb_i_range _cb_range_12 = r;
+for (_cb_i64 n = _cb_range_12.r_start; n <= _cb_range_12.r_end;n += 1){ }
+}
 
-for (int index = 0; i <= (range.end-range.start)/step; i++) {} // step != 1
-for (int index = 0; i <= (range.end-range.start); i++) {} // step = 1
+{ _cb_type_15 _cb_range_14 = s;
+_cb_pfor_ctx_14 _cb_ctx_14;
+_cb_ctx_14._cb_range = _cb_range_14;
+int64_t _cb_n_14 = (((int64_t)_cb_range_14.size + 0) / 1);
+int _cb_chunks_14 = _cb_async_chunk_count(_cb_n_14);
+_cb_int _cb_red_14_0[_cb_chunks_14];
+_cb_ctx_14.sum = sum;
+_cb_ctx_14._cb_red_0 = _cb_red_14_0;
+_cb_async_parallel_for(_cb_n_14, _cb_chunks_14, _cb_pfor_14, &_cb_ctx_14);
+if (_cb_n_14 > 0) for (int _cb_c = 0; _cb_c < _cb_chunks_14; ++_cb_c) {
+sum = sum + _cb_red_14_0[_cb_c];
+}
+}
 
+// the chunk function, printed after all other function code:
+static void _cb_pfor_14(void* _cb_ctx_p, int64_t _cb_begin, int64_t _cb_end, int _cb_chunk) {
+_cb_pfor_ctx_14* _cb_ctx = (_cb_pfor_ctx_14*)_cb_ctx_p;
+_cb_type_15 _cb_range_14 = _cb_ctx->_cb_range;
+_cb_int sum = 0;
+for (int64_t _cb_i = _cb_begin; _cb_i < _cb_end; ++_cb_i) {
+_cb_int n = _cb_range_14.v_ptr[_cb_i * 1];
+{ ... }
+}
+_cb_ctx->_cb_red_0[_cb_chunk] = sum;
+}
 
 */
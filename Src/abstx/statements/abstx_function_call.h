@@ -5,20 +5,24 @@
 
 /*
 
-In compiled CB, all functions returns void - return values are instead handled by pointer references that are included as arguments.
-Therefore, we can't use CB functions as value expressions. Instead, any function call has to be evaluated first and the
-  return values stored in temporary values. Then those temporary values can be used as value expressions instead.
+In compiled CB, functions with several return values returns void - the return values are instead handled by pointer
+  references that are included as arguments. A function with exactly one return value returns it as a normal C return value
+  (see CB_Function::returns_value()).
+In both cases, any function call has to be evaluated first and the return values stored in temporary values.
+  Then those temporary values can be used as value expressions instead.
 
 Example:
     foo := fn(i:int)->r:int { return i; }
+    bar := fn(i:int)->(r:int, s:int) { r = i; s = i; }
     a = foo(foo(2));
+    b, c = bar(a);
 generates C code:
-    void foo(int i, int* r) { *r = i; return; }
-    { // temporary values are kept inside a separate scope
-        int _tmp_123;
-        foo(2, &_tmp_123);
-        foo(_tmp_123, &a);
-    }
+    int foo(int i) { int r = 0; { r = i; return r; } return r; }
+    void bar(int i, int* r, int* s) { (*r) = i; (*s) = i; }
+    int _cb_tmp_123 = 0;
+    _cb_tmp_123 = foo(2);
+    a = foo(_cb_tmp_123);
+    bar(a, &b, &c);
 
 
 
@@ -60,6 +64,8 @@ struct Abstx_function_call : Statement
     Owned<Variable_expression> function_pointer;
     Seq<Owned<Value_expression>> in_args;
     Seq<Shared<Variable_expression>> out_args;
+    bool compile_time = false; // #run statement; evaluated during compilation and never part of the generated code
+    bool async = false; // async statement; submitted to the thread pool and not waited for
 
     std::string toS() const override { return "function call statement"; }
 
@@ -68,7 +74,15 @@ struct Abstx_function_call : Statement
     void generate_code(std::ostream& target) const override
     {
         ASSERT(is_codegen_ready(status));
-        function_pointer->generate_code(target);
+        if (compile_time) return; // evaluated in compile_time/run_batch.cpp
+        if (async) return generate_async_code(target);
+        bool returns_value = function_type()->returns_value();
+        if (returns_value) {
+            ASSERT(out_args.size == 1);
+            out_args[0]->generate_code(target);
+            target << " = ";
+        }
+        generate_function(target);
         target << "(";
         for (int i = 0; i < in_args.size; ++i) {
             const auto& arg = in_args[i];
@@ -78,8 +92,8 @@ struct Abstx_function_call : Statement
             }
             arg->generate_code(target);
         }
-        if (in_args.size > 0 && out_args.size > 0) target << ", ";
-        for (int i = 0; i < out_args.size; ++i) {
+        if (in_args.size > 0 && out_args.size > 0 && !returns_value) target << ", ";
+        for (uint32_t i = 0; i < out_args.size && !returns_value; ++i) {
             const auto& arg = out_args[i];
             if (i) target << ", ";
             target << "&"; // always pass non-cost pointer to the original value
@@ -88,6 +102,41 @@ struct Abstx_function_call : Statement
         target << ");" << std::endl;
 
     }
+
+    Shared<const CB_Function> function_type() const {
+        Shared<const CB_Function> fn_type = dynamic_pointer_cast<const CB_Function>(function && function->specialization_of ? function->get_type() : function_pointer->get_type());
+        ASSERT(fn_type);
+        return fn_type;
+    }
+
+private:
+    // a generic function has no value in the generated code, so its specialization is called directly
+    // known functions are called directly as well, so the C compiler can inline them
+    void generate_function(std::ostream& target) const {
+        if (function) function->generate_code(target);
+        else function_pointer->generate_code(target);
+    }
+
+    // the in arguments are copied into a separately allocated block, since the caller might return before the call is made
+    // the thunk that unpacks them is generated once for each function type (see CB_Function::generate_async_thunk())
+    void generate_async_code(std::ostream& target) const
+    {
+        ASSERT(out_args.size == 0);
+        Shared<const CB_Function> fn_type = function_type();
+        global_scope()->async_signatures[fn_type->uid] = fn_type;
+
+        target << "{" << std::endl;
+        target << "_cb_async_args_" << fn_type->uid << "* _cb_args = (_cb_async_args_" << fn_type->uid << "*)_cb_async_alloc(sizeof(_cb_async_args_" << fn_type->uid << "));" << std::endl;
+        for (uint32_t i = 0; i < in_args.size; ++i) {
+            target << "_cb_args->a" << i << " = ";
+            in_args[i]->generate_code(target);
+            target << ";" << std::endl;
+        }
+        target << "_cb_async_submit(_cb_async_thunk_" << fn_type->uid << ", (void*)";
+        generate_function(target);
+        target << ", _cb_args);" << std::endl;
+        target << "}" << std::endl;
+    }
 };
 
 
@@ -95,13 +144,18 @@ struct Abstx_function_call_expression : Variable_expression {
     Shared<Abstx_function_call> function_call;
     std::string toS() const override { return "function call expression"; }
 
+    // a call with one return value can be used as any other value, e.g. in foo(a) + 1
+    // the call itself is a separate statement; the expression is the temporary value it returns to
     Shared<const CB_Type> get_type() override {
-        ASSERT(false, "Abstx_function_call_expression::get_type() not allowed since functions can have several types - check funcion_call->out_args instead");
+        ASSERT(function_call);
+        ASSERT(function_call->out_args.size == 1, "Abstx_function_call_expression::get_type() not allowed since functions can have several types - check funcion_call->out_args instead");
+        return function_call->out_args[0]->get_type();
     }
 
     void generate_code(std::ostream& target) const override {
         ASSERT(function_call);
-        function_call->generate_code(target);
+        ASSERT(function_call->out_args.size == 1);
+        function_call->out_args[0]->generate_code(target);
     }
 
     bool has_constant_value() const override {
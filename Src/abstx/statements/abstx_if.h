@@ -14,6 +14,9 @@ elsif (b2) {}
 elsif (b3) {}
 else {}
 then {}
+
+Conditions with constant values are resolved at compile time: scopes that can never be entered are not generated,
+  and a scope that is always entered (if it is reached) ends the chain.
 */
 
 
@@ -51,6 +54,15 @@ struct Abstx_if : Statement {
             scope->generate_code(target);
         };
 
+        // returns 1 if the condition is always true, 0 if it is always false, or -1 if it isn't constant
+        int constant_condition() const {
+            ASSERT(condition != nullptr);
+            if (!condition->has_constant_value()) return -1;
+            const Any& value = condition->get_constant_value();
+            if (!value.has_value(*CB_Bool::type)) return -1;
+            return *(CB_Bool::c_typedef const*)value.v_ptr ? 1 : 0;
+        }
+
         Parsing_status fully_parse() {
             if (is_codegen_ready(status) || is_error(status)) return status;
             condition->finalize();
@@ -104,12 +116,21 @@ struct Abstx_if : Statement {
     void generate_code(std::ostream& target) const override {
         if (!is_codegen_ready(status)) LOG("status is " << status);
         ASSERT(is_codegen_ready(status));
-        for (int i = 0; i < conditional_scopes.size; ++i) {
-            if (i) target << "else ";
-            conditional_scopes[i]->generate_code(target);
+        bool first = true;
+        for (const auto& cs : conditional_scopes) {
+            int constant_condition = cs->constant_condition();
+            if (constant_condition == 0) continue;
+            if (constant_condition == 1) {
+                if (!first) target << "else ";
+                cs->scope->generate_code(target);
+                return;
+            }
+            if (!first) target << "else ";
+            cs->generate_code(target);
+            first = false;
         }
         if (else_scope != nullptr) {
-            target << "else ";
+            if (!first) target << "else ";
             else_scope->generate_code(target);
         }
         // @todo: add support for then-scopes (needs support for adding a statement to a scope) see syntax below
@@ -23,10 +23,7 @@ struct Abstx_return : Statement {
 
     Parsing_status fully_parse() override; // implemented in statement_parser.cpp
 
-    void generate_code(std::ostream& target) const override {
-        ASSERT(is_codegen_ready(status));
-        target << "return;" << std::endl;
-    };
+    void generate_code(std::ostream& target) const override; // implemented in abstx_implementations.cpp
 };
 
 
@@ -0,0 +1,153 @@
+#ifndef _CB_ARENA_H
+#define _CB_ARENA_H
+
+/*
+Runtime for #arena scopes in generated C code.
+
+All allocations made by the runtime (strings, maps, sequences) go through _cb_alloc(), _cb_realloc() and _cb_free().
+Every allocation starts with a _cb_alloc_header that holds the arena it was allocated in, or NULL for heap memory,
+    so the owner of any allocation is found in O(1) (see _cb_arena_owner()).
+    - _cb_alloc() allocates on the heap.
+    - _cb_alloc_like() and _cb_realloc() allocate where the old memory is: in the same arena, or on the heap.
+    - _cb_free() does nothing for arena memory.
+
+A container declared inside an #arena scope is bound to the arena by its declaration: it starts with an empty
+    allocation from the arena (see _cb_arena_empty()), so it grows in the arena. All other containers use the heap,
+    even when they grow inside an arena scope.
+
+    #arena { s : [..] int; }    // { _cb_arena _cb_arena_12 = {0}; _cb_type_7 s = ...; if (!s.v_ptr) s.v_ptr = _cb_arena_empty(&_cb_arena_12); ... _cb_arena_end(&_cb_arena_12); }
+
+Arena memory is taken from chunks, which are released all at once when the scope ends:
+    - _cb_arena_alloc() bumps a pointer in the latest chunk. A new chunk is allocated when the latest one is full.
+    - _cb_realloc() grows the latest allocation in place if possible, otherwise it allocates and copies.
+Nothing allocated in an arena may be used after the scope has ended. The arena isn't thread safe, so containers
+    bound to it must only grow on the thread that runs the scope.
+Arena scopes can be nested; a declaration uses the innermost arena.
+Only memory allocated by these functions has a header; no other memory may be passed to them.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _CB_ARENA_ALIGN 16 // same guarantee as malloc
+#define _CB_ARENA_CHUNK_SIZE (64*1024)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _cb_arena_chunk {
+    struct _cb_arena_chunk* prev;
+    uint8_t* end;
+    // data follows here; the header is 16 bytes, so the data has the same alignment as the chunk
+} _cb_arena_chunk;
+
+typedef struct _cb_arena {
+    _cb_arena_chunk* chunk; // the latest chunk
+    uint8_t* top;           // the first free byte in the latest chunk
+    uint8_t* last;          // the latest allocation, which can be grown in place
+} _cb_arena;
+
+typedef union _cb_alloc_header {
+    _cb_arena* arena;       // NULL for heap memory
+    uint8_t align[_CB_ARENA_ALIGN]; // the allocation after the header keeps the alignment of malloc
+} _cb_alloc_header;
+
+
+
+// releases all memory allocated in the arena
+static inline void _cb_arena_end(_cb_arena* a)
+{
+    _cb_arena_chunk* chunk = a->chunk;
+    while (chunk) {
+        _cb_arena_chunk* prev = chunk->prev;
+        free(chunk);
+        chunk = prev;
+    }
+    memset(a, 0, sizeof(*a));
+}
+
+static inline void* _cb_arena_alloc(_cb_arena* a, size_t size)
+{
+    size = sizeof(_cb_alloc_header) + ((size + _CB_ARENA_ALIGN-1) & ~(size_t)(_CB_ARENA_ALIGN-1));
+    if (!a->chunk || (size_t)(a->chunk->end - a->top) < size) {
+        // chunks double in size, so there are only a few of them
+        size_t chunk_size = a->chunk ? 2*(size_t)(a->chunk->end - (uint8_t*)(a->chunk+1)) : _CB_ARENA_CHUNK_SIZE;
+        if (chunk_size < size) chunk_size = size;
+        _cb_arena_chunk* chunk = (_cb_arena_chunk*)malloc(sizeof(_cb_arena_chunk) + chunk_size);
+        if (!chunk) return NULL;
+        chunk->prev = a->chunk;
+        chunk->end = (uint8_t*)(chunk+1) + chunk_size;
+        a->chunk = chunk;
+        a->top = (uint8_t*)(chunk+1);
+    }
+    _cb_alloc_header* header = (_cb_alloc_header*)a->top;
+    header->arena = a;
+    a->last = (uint8_t*)(header+1);
+    a->top += size;
+    return a->last;
+}
+
+// the buffer of an empty container that is declared inside the arena scope, so that it grows in the arena
+static inline void* _cb_arena_empty(_cb_arena* a)
+{
+    return _cb_arena_alloc(a, 0);
+}
+
+// returns the arena that p was allocated in, or NULL if it's heap memory
+static inline _cb_arena* _cb_arena_owner(void const* p)
+{
+    return ((_cb_alloc_header const*)p - 1)->arena;
+}
+
+
+
+static inline void* _cb_alloc(size_t size)
+{
+    _cb_alloc_header* header = (_cb_alloc_header*)malloc(sizeof(_cb_alloc_header) + size);
+    if (!header) return NULL;
+    header->arena = NULL;
+    return header+1;
+}
+
+// allocates memory with the same lifetime as p: in the arena that owns p, or on the heap
+// used when a container moves its data to a new allocation
+static inline void* _cb_alloc_like(void const* p, size_t size)
+{
+    _cb_arena* a = p ? _cb_arena_owner(p) : NULL;
+    return a ? _cb_arena_alloc(a, size) : _cb_alloc(size);
+}
+
+// old_size is the size of the allocation p, which is needed to copy arena memory
+// the memory stays where it was first allocated, so values from outside the arena scope can still be used after it has ended
+static inline void* _cb_realloc(void* p, size_t old_size, size_t new_size)
+{
+    if (!p) return _cb_alloc(new_size);
+    _cb_arena* a = _cb_arena_owner(p);
+    if (!a) {
+        _cb_alloc_header* header = (_cb_alloc_header*)realloc((_cb_alloc_header*)p - 1, sizeof(_cb_alloc_header) + new_size);
+        return header ? header+1 : NULL;
+    }
+    if (p == a->last && (size_t)(a->chunk->end - (uint8_t*)p) >= new_size) {
+        // the latest allocation can grow in place
+        a->top = (uint8_t*)p + ((new_size + _CB_ARENA_ALIGN-1) & ~(size_t)(_CB_ARENA_ALIGN-1));
+        return p;
+    }
+    void* new_p = _cb_arena_alloc(a, new_size);
+    if (new_p) memcpy(new_p, p, old_size < new_size ? old_size : new_size);
+    return new_p;
+}
+
+static inline void _cb_free(void* p)
+{
+    if (!p || _cb_arena_owner(p)) return; // arena memory is released with the arena
+    free((_cb_alloc_header*)p - 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CB_ARENA_H
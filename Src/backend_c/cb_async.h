@@ -0,0 +1,436 @@
+#ifndef _CB_ASYNC_H
+#define _CB_ASYNC_H
+
+/*
+Runtime for async function calls in generated C code.
+
+    async foo(a, b);
+
+is compiled to a task submission on a work-stealing thread pool:
+
+    {
+        _cb_async_args_12* _cb_args = (_cb_async_args_12*)_cb_async_alloc(sizeof(_cb_async_args_12));
+        _cb_args->a0 = a;
+        _cb_args->a1 = b;
+        _cb_async_submit(_cb_async_thunk_12, (void*)foo, _cb_args);
+    }
+
+where _cb_async_args_12 and _cb_async_thunk_12 are generated once for each function type used in an async call.
+
+Each worker owns a Chase-Lev deque. Workers push and pop at the bottom of their own deque, and steal
+    from the top of other deques when they run out of work. The thread that starts the pool (normally
+    the main thread) also owns a deque, so submitting from main is lock free as well.
+The pool is started lazily on the first submission. The number of workers is taken from the environment
+    variable CB_THREADS, or the number of processors if not set.
+All tasks are finished before the program exits (_cb_async_join() is registered with atexit).
+The pool needs pthreads. On Windows, each task is run directly by the thread that submits it, and parallel loops
+    run their chunks in order on the calling thread.
+
+Parallel for loops use the same pool. The iteration space is split into chunks, one task per chunk,
+    and the calling thread works on tasks until all of its chunks are done:
+
+    for #parallel (n in r) { ... }
+
+is compiled to (see Abstx_for::generate_code()):
+
+    _cb_pfor_ctx_14 _cb_ctx_14; ...     // captured variables
+    int64_t _cb_n_14 = ...;            // number of iterations
+    int _cb_chunks_14 = _cb_async_chunk_count(_cb_n_14);
+    _cb_async_parallel_for(_cb_n_14, _cb_chunks_14, _cb_pfor_14, &_cb_ctx_14);
+
+Define _CB_ASYNC_IMPLEMENTATION in exactly one translation unit before including this file.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*_cb_async_thunk)(void* fn_ptr, void* args);
+
+// allocates space for the arguments of one task; the memory is freed when the task is done
+void* _cb_async_alloc(size_t args_size);
+void _cb_async_submit(_cb_async_thunk thunk, void* fn_ptr, void* args);
+
+// waits for all submitted tasks (including tasks submitted by tasks) to finish, then stops the workers
+// the calling thread helps out with the remaining tasks
+void _cb_async_join(void);
+
+// waits for all submitted tasks to finish, like _cb_async_join(), but keeps the workers running
+// used by #run statements, whose results must be complete when they return
+void _cb_async_wait(void);
+
+// runs fn(ctx, begin, end, chunk) for n_chunks chunks that together cover [0, n), and waits for all of them
+// chunks are numbered from 0, so each chunk can write its partial results to its own slot
+typedef void (*_cb_async_chunk_fn)(void* ctx, int64_t begin, int64_t end, int chunk);
+void _cb_async_parallel_for(int64_t n, int n_chunks, _cb_async_chunk_fn fn, void* ctx);
+
+// number of chunks to split n iterations into; a few per thread, so uneven chunks can be balanced by stealing
+int _cb_async_chunk_count(int64_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+#ifdef _CB_ASYNC_IMPLEMENTATION
+
+#ifdef _WIN32
+
+#include <stdlib.h>
+
+void* _cb_async_alloc(size_t args_size) { return malloc(args_size); }
+void _cb_async_submit(_cb_async_thunk thunk, void* fn_ptr, void* args) { thunk(fn_ptr, args); free(args); }
+void _cb_async_wait(void) {}
+void _cb_async_join(void) {}
+int _cb_async_chunk_count(int64_t n) { return 1; }
+
+void _cb_async_parallel_for(int64_t n, int n_chunks, _cb_async_chunk_fn fn, void* ctx)
+{
+    if (n <= 0) return;
+    for (int i = 0; i < n_chunks; ++i) fn(ctx, n * i / n_chunks, n * (i+1) / n_chunks, i);
+}
+
+#else
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define _CB_ASYNC_MAX_WORKERS 256
+#define _CB_ASYNC_DEQUE_INITIAL_SIZE 256 // must be a power of 2
+#define _CB_ASYNC_SPIN_COUNT 64 // failed steal rounds before going to sleep
+#define _CB_ASYNC_CHUNKS_PER_THREAD 4
+
+typedef struct _cb_task {
+    _cb_async_thunk thunk;
+    void* fn_ptr;
+    void* args;
+    max_align_t _align[0]; // arguments are stored directly after the task
+} _cb_task;
+
+typedef struct _cb_deque_array {
+    int64_t size;
+    struct _cb_deque_array* retired; // older arrays are kept until join, since thieves might still read them
+    _Atomic(_cb_task*) tasks[];
+} _cb_deque_array;
+
+typedef struct {
+    _Atomic int64_t top;
+    _Atomic int64_t bottom;
+    _Atomic(_cb_deque_array*) array;
+    char _padding[64]; // avoid false sharing between workers
+} _cb_deque;
+
+static struct {
+    pthread_once_t init_once;
+    int n_deques; // workers + the thread that started the pool
+    _cb_deque deques[_CB_ASYNC_MAX_WORKERS+1];
+    pthread_t threads[_CB_ASYNC_MAX_WORKERS];
+
+    _Atomic int64_t pending; // submitted but not finished tasks
+    _Atomic uint64_t epoch; // incremented on each submission; used to avoid lost wakeups
+    _Atomic int sleepers;
+    _Atomic int shutdown;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} _cb_pool = { PTHREAD_ONCE_INIT };
+
+static _Thread_local int _cb_worker_id = -1; // index of the deque owned by this thread
+
+
+
+static _cb_deque_array* _cb_deque_array_new(int64_t size, _cb_deque_array* retired)
+{
+    _cb_deque_array* a = (_cb_deque_array*)malloc(sizeof(_cb_deque_array) + size*sizeof(_Atomic(_cb_task*)));
+    a->size = size;
+    a->retired = retired;
+    return a;
+}
+
+static void _cb_deque_init(_cb_deque* d)
+{
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+    atomic_init(&d->array, _cb_deque_array_new(_CB_ASYNC_DEQUE_INITIAL_SIZE, NULL));
+}
+
+// owner only
+static void _cb_deque_push(_cb_deque* d, _cb_task* task)
+{
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    _cb_deque_array* a = atomic_load_explicit(&d->array, memory_order_relaxed);
+    if (b - t > a->size - 1) {
+        // full -> grow
+        _cb_deque_array* new_a = _cb_deque_array_new(a->size * 2, a);
+        for (int64_t i = t; i < b; ++i) {
+            atomic_store_explicit(&new_a->tasks[i & (new_a->size-1)], atomic_load_explicit(&a->tasks[i & (a->size-1)], memory_order_relaxed), memory_order_relaxed);
+        }
+        atomic_store_explicit(&d->array, new_a, memory_order_release);
+        a = new_a;
+    }
+    atomic_store_explicit(&a->tasks[b & (a->size-1)], task, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b+1, memory_order_release); // publishes the task to thieves
+}
+
+// owner only
+static _cb_task* _cb_deque_pop(_cb_deque* d)
+{
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    _cb_deque_array* a = atomic_load_explicit(&d->array, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    if (t > b) {
+        // empty
+        atomic_store_explicit(&d->bottom, b+1, memory_order_relaxed);
+        return NULL;
+    }
+    _cb_task* task = atomic_load_explicit(&a->tasks[b & (a->size-1)], memory_order_relaxed);
+    if (t == b) {
+        // last task -> race against thieves
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t+1, memory_order_seq_cst, memory_order_relaxed)) task = NULL;
+        atomic_store_explicit(&d->bottom, b+1, memory_order_relaxed);
+    }
+    return task;
+}
+
+// any thread
+static _cb_task* _cb_deque_steal(_cb_deque* d)
+{
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) return NULL;
+    _cb_deque_array* a = atomic_load_explicit(&d->array, memory_order_consume);
+    _cb_task* task = atomic_load_explicit(&a->tasks[t & (a->size-1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t+1, memory_order_seq_cst, memory_order_relaxed)) return NULL;
+    return task;
+}
+
+
+
+static _cb_task* _cb_async_find_task(unsigned* seed)
+{
+    if (_cb_worker_id >= 0) {
+        _cb_task* task = _cb_deque_pop(&_cb_pool.deques[_cb_worker_id]);
+        if (task) return task;
+    }
+    // steal from a random victim, then try all the others
+    *seed = *seed * 1103515245u + 12345u;
+    int start = (int)((*seed >> 16) % (unsigned)_cb_pool.n_deques);
+    for (int i = 0; i < _cb_pool.n_deques; ++i) {
+        int victim = (start + i) % _cb_pool.n_deques;
+        if (victim == _cb_worker_id) continue;
+        _cb_task* task = _cb_deque_steal(&_cb_pool.deques[victim]);
+        if (task) return task;
+    }
+    return NULL;
+}
+
+static void _cb_async_run(_cb_task* task)
+{
+    task->thunk(task->fn_ptr, task->args);
+    free(task);
+    atomic_fetch_sub(&_cb_pool.pending, 1);
+}
+
+static void* _cb_async_worker(void* arg)
+{
+    _cb_worker_id = (int)(intptr_t)arg;
+    unsigned seed = (unsigned)_cb_worker_id * 2654435761u;
+    int idle_rounds = 0;
+    while (!atomic_load(&_cb_pool.shutdown)) {
+        uint64_t epoch = atomic_load(&_cb_pool.epoch);
+        _cb_task* task = _cb_async_find_task(&seed);
+        if (task) {
+            _cb_async_run(task);
+            idle_rounds = 0;
+            continue;
+        }
+        if (++idle_rounds < _CB_ASYNC_SPIN_COUNT) {
+            sched_yield();
+            continue;
+        }
+        // nothing to do -> sleep until something is submitted
+        pthread_mutex_lock(&_cb_pool.mutex);
+        atomic_fetch_add(&_cb_pool.sleepers, 1);
+        if (atomic_load(&_cb_pool.epoch) == epoch && !atomic_load(&_cb_pool.shutdown)) {
+            pthread_cond_wait(&_cb_pool.cond, &_cb_pool.mutex);
+        }
+        atomic_fetch_sub(&_cb_pool.sleepers, 1);
+        pthread_mutex_unlock(&_cb_pool.mutex);
+        idle_rounds = 0;
+    }
+    return NULL;
+}
+
+static void _cb_async_init(void)
+{
+    long n_workers = 0;
+    const char* env = getenv("CB_THREADS");
+    if (env) n_workers = strtol(env, NULL, 10);
+    if (n_workers <= 0) n_workers = sysconf(_SC_NPROCESSORS_ONLN) - 1; // the main thread also runs tasks while joining
+    if (n_workers < 1) n_workers = 1;
+    if (n_workers > _CB_ASYNC_MAX_WORKERS) n_workers = _CB_ASYNC_MAX_WORKERS;
+
+    _cb_pool.n_deques = (int)n_workers + 1;
+    for (int i = 0; i < _cb_pool.n_deques; ++i) _cb_deque_init(&_cb_pool.deques[i]);
+    atomic_init(&_cb_pool.pending, 0);
+    atomic_init(&_cb_pool.epoch, 0);
+    atomic_init(&_cb_pool.sleepers, 0);
+    atomic_init(&_cb_pool.shutdown, 0);
+    pthread_mutex_init(&_cb_pool.mutex, NULL);
+    pthread_cond_init(&_cb_pool.cond, NULL);
+
+    _cb_worker_id = 0; // the starting thread owns deque 0
+    for (long i = 0; i < n_workers; ++i) {
+        pthread_create(&_cb_pool.threads[i], NULL, _cb_async_worker, (void*)(intptr_t)(i+1));
+    }
+    atexit(_cb_async_join);
+}
+
+void* _cb_async_alloc(size_t args_size)
+{
+    _cb_task* task = (_cb_task*)malloc(sizeof(_cb_task) + args_size);
+    task->args = (void*)(task + 1);
+    return task->args;
+}
+
+void _cb_async_submit(_cb_async_thunk thunk, void* fn_ptr, void* args)
+{
+    pthread_once(&_cb_pool.init_once, _cb_async_init);
+    _cb_task* task = (_cb_task*)args - 1;
+    task->thunk = thunk;
+    task->fn_ptr = fn_ptr;
+    atomic_fetch_add(&_cb_pool.pending, 1);
+
+    if (_cb_worker_id >= 0 && !atomic_load(&_cb_pool.shutdown)) {
+        _cb_deque_push(&_cb_pool.deques[_cb_worker_id], task);
+    } else {
+        // threads outside the pool have no deque of their own (and after join there are no workers) -> just run it
+        _cb_async_run(task);
+        return;
+    }
+
+    atomic_fetch_add(&_cb_pool.epoch, 1);
+    if (atomic_load(&_cb_pool.sleepers) > 0) {
+        pthread_mutex_lock(&_cb_pool.mutex);
+        pthread_cond_signal(&_cb_pool.cond);
+        pthread_mutex_unlock(&_cb_pool.mutex);
+    }
+}
+
+void _cb_async_wait(void)
+{
+    if (_cb_pool.n_deques == 0 || atomic_load(&_cb_pool.shutdown)) return; // never started, or everything runs directly
+
+    unsigned seed = 1;
+    while (atomic_load(&_cb_pool.pending) > 0) {
+        _cb_task* task = _cb_async_find_task(&seed);
+        if (task) _cb_async_run(task);
+        else sched_yield();
+    }
+}
+
+void _cb_async_join(void)
+{
+    if (_cb_pool.n_deques == 0 || atomic_load(&_cb_pool.shutdown)) return; // never started or already joined
+
+    _cb_async_wait();
+
+    atomic_store(&_cb_pool.shutdown, 1);
+    pthread_mutex_lock(&_cb_pool.mutex);
+    pthread_cond_broadcast(&_cb_pool.cond);
+    pthread_mutex_unlock(&_cb_pool.mutex);
+    for (int i = 0; i < _cb_pool.n_deques-1; ++i) pthread_join(_cb_pool.threads[i], NULL);
+
+    for (int i = 0; i < _cb_pool.n_deques; ++i) {
+        _cb_deque_array* a = atomic_load(&_cb_pool.deques[i].array);
+        while (a) {
+            _cb_deque_array* retired = a->retired;
+            free(a);
+            a = retired;
+        }
+    }
+}
+
+
+
+typedef struct {
+    _cb_async_chunk_fn fn;
+    void* ctx;
+    int64_t n;
+    int n_chunks;
+    _Atomic int remaining;
+} _cb_parallel_group;
+
+static void _cb_async_run_chunk(_cb_parallel_group* g, int chunk)
+{
+    int64_t begin = g->n * chunk / g->n_chunks;
+    int64_t end = g->n * (chunk+1) / g->n_chunks;
+    g->fn(g->ctx, begin, end, chunk);
+    atomic_fetch_sub_explicit(&g->remaining, 1, memory_order_release);
+}
+
+static void _cb_async_chunk_thunk(void* group, void* args)
+{
+    _cb_async_run_chunk((_cb_parallel_group*)group, *(int*)args);
+}
+
+int _cb_async_chunk_count(int64_t n)
+{
+    pthread_once(&_cb_pool.init_once, _cb_async_init);
+    int64_t n_chunks = (int64_t)_cb_pool.n_deques * _CB_ASYNC_CHUNKS_PER_THREAD;
+    if (n_chunks > n) n_chunks = n;
+    if (n_chunks < 1) n_chunks = 1;
+    return (int)n_chunks;
+}
+
+void _cb_async_parallel_for(int64_t n, int n_chunks, _cb_async_chunk_fn fn, void* ctx)
+{
+    if (n <= 0) return;
+    pthread_once(&_cb_pool.init_once, _cb_async_init);
+
+    _cb_parallel_group g;
+    g.fn = fn;
+    g.ctx = ctx;
+    g.n = n;
+    g.n_chunks = n_chunks;
+    atomic_init(&g.remaining, n_chunks);
+
+    if (_cb_worker_id < 0 || atomic_load(&_cb_pool.shutdown)) {
+        // no deque to push to -> run everything here
+        for (int i = 0; i < n_chunks; ++i) _cb_async_run_chunk(&g, i);
+        return;
+    }
+
+    // the last chunks are pushed first, so the owner pops them in order while thieves take them from the back
+    for (int i = n_chunks-1; i > 0; --i) {
+        int* args = (int*)_cb_async_alloc(sizeof(int));
+        *args = i;
+        _cb_async_submit(_cb_async_chunk_thunk, &g, args);
+    }
+    _cb_async_run_chunk(&g, 0);
+
+    // help out until all chunks are done; g is on the stack so we can't leave before that
+    unsigned seed = (unsigned)(uintptr_t)&g;
+    while (atomic_load_explicit(&g.remaining, memory_order_acquire) > 0) {
+        _cb_task* task = _cb_async_find_task(&seed);
+        if (task) _cb_async_run(task);
+        else sched_yield();
+    }
+}
+
+#endif // _WIN32
+
+#endif // _CB_ASYNC_IMPLEMENTATION
+
+#endif // _CB_ASYNC_H
@@ -0,0 +1,274 @@
+#ifndef _CB_CHANNEL_H
+#define _CB_CHANNEL_H
+
+/*
+Runtime for channels in generated C code.
+
+    c := chan(16) int;      // buffered channel with room for 16 values
+    c <- 5;                 // send (blocks while the buffer is full)
+    a := <- c;              // receive (blocks while the buffer is empty)
+
+A channel is a bounded multi-producer multi-consumer ring buffer (Dmitry Vyukov's algorithm).
+    Each cell has a sequence number that tells if the cell is ready for a send or a receive, so
+    senders and receivers only contend on their own position counter, and never take a lock.
+    The two position counters are on separate cache lines.
+
+Blocking is only done when the buffer is full (send) or empty (receive). The blocked thread sleeps on a
+    futex (on Linux) until the other side has made progress, and is only woken if someone is actually waiting.
+Other platforms yield instead of sleeping.
+
+The ring buffer has a power of 2 size, and at least 2 cells (1 cell doesn't work with the sequence numbers).
+    If the capacity is smaller than the buffer, a send also checks the number of values in the channel,
+    so the channel never holds more than its capacity.
+Unbuffered channels (capacity 0) are implemented as channels with a capacity of 1 value, so a send only
+    blocks until the previous value has been received.
+
+The generated code uses typed wrappers (generated by CB_Channel::generate_typedef()), for example:
+
+    typedef struct _cb_chan* _cb_type_25;
+    static inline void _cb_chan_send_25(_cb_type_25 c, _cb_int v) { ...; _cb_chan_send(c, &v); }
+    static inline _cb_int _cb_chan_recv_25(_cb_type_25 c) { ...; _cb_int v; _cb_chan_recv(c, &v); return v; }
+
+Define _CB_CHANNEL_IMPLEMENTATION in exactly one translation unit before including this file.
+*/
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _cb_chan _cb_chan;
+
+// the channel holds at most capacity values (at least 1)
+_cb_chan* _cb_chan_new(size_t elem_size, size_t capacity);
+void _cb_chan_free(_cb_chan* c);
+
+// blocking; copies elem_size bytes from/to value
+void _cb_chan_send(_cb_chan* c, void const* value);
+void _cb_chan_recv(_cb_chan* c, void* value);
+
+// non-blocking; returns 0 if the channel was full/empty
+int _cb_chan_try_send(_cb_chan* c, void const* value);
+int _cb_chan_try_recv(_cb_chan* c, void* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
+#ifdef _CB_CHANNEL_IMPLEMENTATION
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <limits.h>
+#elif defined(_WIN32)
+#include <windows.h> // SwitchToThread
+#include <malloc.h> // _aligned_malloc
+#else
+#include <sched.h>
+#endif
+
+#define _CB_CHAN_CACHE_LINE 64
+#define _CB_CHAN_SPIN_COUNT 128 // failed attempts before going to sleep
+
+typedef struct {
+    _Atomic size_t seq;
+    // followed by the value, padded to 8 bytes
+} _cb_chan_cell;
+
+struct _cb_chan {
+    _Alignas(_CB_CHAN_CACHE_LINE) _Atomic size_t send_pos;
+    _Alignas(_CB_CHAN_CACHE_LINE) _Atomic size_t recv_pos;
+
+    // futex words; incremented on send/receive when someone is waiting
+    _Alignas(_CB_CHAN_CACHE_LINE) _Atomic uint32_t sent;
+    _Atomic uint32_t send_waiters; // receivers waiting for something to be sent
+    _Alignas(_CB_CHAN_CACHE_LINE) _Atomic uint32_t received;
+    _Atomic uint32_t recv_waiters; // senders waiting for something to be received
+
+    _Alignas(_CB_CHAN_CACHE_LINE) size_t mask;
+    size_t capacity; // <= mask+1; only checked by senders if it's smaller
+    size_t elem_size;
+    size_t cell_size;
+    uint8_t* cells;
+};
+
+
+
+static void _cb_chan_wait(_Atomic uint32_t* word, uint32_t expected)
+{
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#elif defined(_WIN32)
+    (void)word; (void)expected;
+    SwitchToThread();
+#else
+    (void)word; (void)expected;
+    sched_yield();
+#endif
+}
+
+static void _cb_chan_wake(_Atomic uint32_t* word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+static inline _cb_chan_cell* _cb_chan_get_cell(_cb_chan* c, size_t pos)
+{
+    return (_cb_chan_cell*)(c->cells + (pos & c->mask) * c->cell_size);
+}
+
+
+
+_cb_chan* _cb_chan_new(size_t elem_size, size_t capacity)
+{
+    if (capacity < 1) capacity = 1;
+    size_t size = 2; // a buffer of 1 doesn't work with the sequence numbers
+    while (size < capacity) size *= 2;
+
+#ifdef _WIN32
+    _cb_chan* c = (_cb_chan*)_aligned_malloc(sizeof(_cb_chan), _CB_CHAN_CACHE_LINE); // no aligned_alloc
+#else
+    _cb_chan* c = (_cb_chan*)aligned_alloc(_CB_CHAN_CACHE_LINE, sizeof(_cb_chan));
+#endif
+    memset(c, 0, sizeof(_cb_chan));
+    c->mask = size - 1;
+    c->capacity = capacity;
+    c->elem_size = elem_size;
+    c->cell_size = (sizeof(_cb_chan_cell) + elem_size + 7) & ~(size_t)7;
+    c->cells = (uint8_t*)malloc(size * c->cell_size);
+    for (size_t i = 0; i < size; ++i) {
+        atomic_init(&_cb_chan_get_cell(c, i)->seq, i);
+    }
+    atomic_init(&c->send_pos, 0);
+    atomic_init(&c->recv_pos, 0);
+    return c;
+}
+
+void _cb_chan_free(_cb_chan* c)
+{
+    if (!c) return;
+    free(c->cells);
+#ifdef _WIN32
+    _aligned_free(c);
+#else
+    free(c);
+#endif
+}
+
+
+
+int _cb_chan_try_send(_cb_chan* c, void const* value)
+{
+    size_t pos = atomic_load_explicit(&c->send_pos, memory_order_relaxed);
+    for (;;) {
+        _cb_chan_cell* cell = _cb_chan_get_cell(c, pos);
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            // the cell is free, but the channel might already hold capacity values
+            // recv_pos only grows, so an old value only makes the channel look fuller than it is
+            if (c->capacity <= c->mask && pos - atomic_load_explicit(&c->recv_pos, memory_order_acquire) >= c->capacity) return 0;
+            // try to claim the cell
+            if (atomic_compare_exchange_weak_explicit(&c->send_pos, &pos, pos+1, memory_order_relaxed, memory_order_relaxed)) {
+                memcpy(cell+1, value, c->elem_size);
+                atomic_store_explicit(&cell->seq, pos+1, memory_order_release); // publishes the value to receivers
+                return 1;
+            }
+            // pos was updated by the failed cas
+        } else if (diff < 0) {
+            return 0; // full; the cell still holds a value from the previous lap
+        } else {
+            pos = atomic_load_explicit(&c->send_pos, memory_order_relaxed); // someone else claimed it
+        }
+    }
+}
+
+int _cb_chan_try_recv(_cb_chan* c, void* value)
+{
+    size_t pos = atomic_load_explicit(&c->recv_pos, memory_order_relaxed);
+    for (;;) {
+        _cb_chan_cell* cell = _cb_chan_get_cell(c, pos);
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos+1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&c->recv_pos, &pos, pos+1, memory_order_relaxed, memory_order_relaxed)) {
+                memcpy(value, cell+1, c->elem_size);
+                atomic_store_explicit(&cell->seq, pos+c->mask+1, memory_order_release); // free for the next lap
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0; // empty
+        } else {
+            pos = atomic_load_explicit(&c->recv_pos, memory_order_relaxed);
+        }
+    }
+}
+
+
+
+// Blocking is done the same way for both directions:
+//  the waiter reads the futex word, registers itself as a waiter, then tries once more before sleeping.
+//  the other side only touches the futex word (and makes a syscall) if there are waiters, so the shared
+//  counters are never written in the uncontended case.
+// The seq_cst fences make sure that either the waiter sees the progress in its last try,
+//  or the other side sees the waiter. In the second case, the futex word has changed since the waiter read it.
+
+static inline void _cb_chan_notify(_Atomic uint32_t* word, _Atomic uint32_t* waiters)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiters, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(word, 1, memory_order_relaxed);
+        _cb_chan_wake(word);
+    }
+}
+
+void _cb_chan_send(_cb_chan* c, void const* value)
+{
+    assert(c && "send on null channel");
+    for (int spin = 0; !_cb_chan_try_send(c, value); ++spin) {
+        if (spin < _CB_CHAN_SPIN_COUNT) continue;
+        uint32_t seen = atomic_load_explicit(&c->received, memory_order_relaxed);
+        atomic_fetch_add_explicit(&c->recv_waiters, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int done = _cb_chan_try_send(c, value);
+        if (!done) _cb_chan_wait(&c->received, seen);
+        atomic_fetch_sub_explicit(&c->recv_waiters, 1, memory_order_relaxed);
+        if (done) break;
+    }
+    _cb_chan_notify(&c->sent, &c->send_waiters);
+}
+
+void _cb_chan_recv(_cb_chan* c, void* value)
+{
+    assert(c && "receive on null channel");
+    for (int spin = 0; !_cb_chan_try_recv(c, value); ++spin) {
+        if (spin < _CB_CHAN_SPIN_COUNT) continue;
+        uint32_t seen = atomic_load_explicit(&c->sent, memory_order_relaxed);
+        atomic_fetch_add_explicit(&c->send_waiters, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int done = _cb_chan_try_recv(c, value);
+        if (!done) _cb_chan_wait(&c->sent, seen);
+        atomic_fetch_sub_explicit(&c->send_waiters, 1, memory_order_relaxed);
+        if (done) break;
+    }
+    _cb_chan_notify(&c->received, &c->recv_waiters);
+}
+
+#endif // _CB_CHANNEL_IMPLEMENTATION
+
+#endif // _CB_CHANNEL_H
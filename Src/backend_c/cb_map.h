@@ -0,0 +1,258 @@
+#ifndef _CB_MAP_H
+#define _CB_MAP_H
+
+/*
+Runtime for maps in generated C code.
+
+    m : [string] int;           // empty map; no memory is allocated until the first insert (see _cb_map_bind_arena() for #arena scopes)
+    m["a"] = 1;                 // inserts "a" if it's not already in the map
+    for (k, v in m) {}          // iterates over all keys and values, in no particular order
+
+A map is a flat open-addressing hash table in the style of Abseil's Swiss tables:
+    - Keys and values are stored together in one array of slots.
+    - Each slot has one control byte in a separate array. It is either EMPTY, DELETED, or the lowest
+      7 bits of the key's hash (the slot is full).
+    - A lookup compares a whole group of control bytes with the 7 hash bits at once (16 bytes with SSE2,
+      otherwise 8), so keys are only compared for slots that are very likely to match. A group that
+      contains an EMPTY byte ends the probe sequence.
+    - The capacity is always a power of 2, and the table grows by doubling when it's 7/8 full.
+
+The control byte array has GROUP extra bytes at the end, which mirror the first GROUP bytes, so a group
+    can be loaded from any position without wrapping around.
+
+Generic code only knows the size and layout of the slots, and gets hash and compare functions through
+    a _cb_map_info. The generated code uses typed wrappers (generated by CB_Map::generate_typedef()), for example:
+
+    typedef struct { _cb_string key; _cb_int value; } _cb_map_slot_25;
+    typedef _cb_map _cb_type_25;
+    static const _cb_map_info _cb_map_info_25 = { sizeof(_cb_map_slot_25), offsetof(_cb_map_slot_25, value), ... };
+    static inline _cb_int* _cb_map_at_25(_cb_type_25* m, _cb_string k) { ... }
+
+All functions are static inline, so lookups with a constant _cb_map_info can be specialized by the c compiler.
+This file is also included by the compiler, to be able to generate literals of compile time maps.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cb_arena.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define _CB_MAP_GROUP 16
+#else
+#define _CB_MAP_GROUP 8
+#endif
+
+#define _CB_MAP_EMPTY ((int8_t)-128)
+#define _CB_MAP_DELETED ((int8_t)-2)
+// full slots have control bytes 0..127
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _cb_map {
+    int8_t* ctrl;           // capacity + _CB_MAP_GROUP control bytes
+    uint8_t* slots;         // capacity slots
+    uint64_t size;          // number of full slots
+    uint64_t capacity;      // 0 or a power of 2 that is at least _CB_MAP_GROUP
+    uint64_t growth_left;   // number of empty slots that can be filled before the table has to grow
+} _cb_map;
+
+typedef struct {
+    size_t slot_size;       // size of key + value, including padding
+    size_t value_offset;    // the key is always first in the slot
+    uint64_t (*hash)(void const* key);
+    int (*eq)(void const* a, void const* b);
+} _cb_map_info;
+
+
+
+// hash functions for the built in key types
+
+static inline uint64_t _cb_map_hash_u64(uint64_t x)
+{
+    // the finalizer from splitmix64; good enough to spread sequential keys over all groups
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static inline uint64_t _cb_map_hash_f64(double d)
+{
+    if (d == 0) d = 0; // -0.0 == 0.0, so they must have the same hash
+    uint64_t x;
+    memcpy(&x, &d, sizeof(x));
+    return _cb_map_hash_u64(x);
+}
+
+static inline uint64_t _cb_map_hash_bytes(void const* data, uint64_t size)
+{
+    // FNV-1a; the result is mixed since the lowest bits are used as the control byte
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (uint64_t i = 0; i < size; ++i) h = (h ^ ((uint8_t const*)data)[i]) * 0x100000001b3ULL;
+    return _cb_map_hash_u64(h);
+}
+
+
+
+// group matching: returns a bitmask with bit i set if ctrl[i] matches
+
+static inline uint32_t _cb_map_match(int8_t const* ctrl, int8_t h)
+{
+#if _CB_MAP_GROUP == 16
+    __m128i group = _mm_loadu_si128((__m128i const*)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < _CB_MAP_GROUP; ++i) mask |= (uint32_t)(ctrl[i] == h) << i;
+    return mask;
+#endif
+}
+
+// EMPTY or DELETED; both have the highest bit set
+static inline uint32_t _cb_map_match_free(int8_t const* ctrl)
+{
+#if _CB_MAP_GROUP == 16
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((__m128i const*)ctrl));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < _CB_MAP_GROUP; ++i) mask |= (uint32_t)(ctrl[i] < 0) << i;
+    return mask;
+#endif
+}
+
+static inline int _cb_map_ctz(uint32_t mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while (!(mask & 1)) { mask >>= 1; ++i; }
+    return i;
+#endif
+}
+
+static inline void* _cb_map_slot(_cb_map const* m, _cb_map_info const* info, uint64_t index)
+{
+    return m->slots + index * info->slot_size;
+}
+
+static inline void _cb_map_set_ctrl(_cb_map* m, uint64_t index, int8_t h)
+{
+    m->ctrl[index] = h;
+    if (index < _CB_MAP_GROUP) m->ctrl[m->capacity + index] = h; // mirrored byte
+}
+
+
+
+// returns a pointer to the value, or NULL if the key is not in the map
+static inline void* _cb_map_find(_cb_map const* m, _cb_map_info const* info, void const* key)
+{
+    if (m->size == 0) return NULL;
+    uint64_t hash = info->hash(key);
+    int8_t h2 = (int8_t)(hash & 0x7f);
+    uint64_t mask = m->capacity - 1;
+    uint64_t pos = (hash >> 7) & mask;
+    // triangular probing: visits every group exactly once, since the number of groups is a power of 2
+    for (uint64_t stride = _CB_MAP_GROUP;; pos = (pos + stride) & mask, stride += _CB_MAP_GROUP) {
+        int8_t const* group = m->ctrl + pos;
+        for (uint32_t match = _cb_map_match(group, h2); match; match &= match - 1) {
+            uint64_t index = (pos + _cb_map_ctz(match)) & mask;
+            uint8_t* slot = (uint8_t*)_cb_map_slot(m, info, index);
+            if (info->eq(slot, key)) return slot + info->value_offset;
+        }
+        if (_cb_map_match(group, _CB_MAP_EMPTY)) return NULL;
+    }
+}
+
+// first EMPTY or DELETED slot in the probe sequence of hash
+static inline uint64_t _cb_map_find_free(_cb_map const* m, uint64_t hash)
+{
+    uint64_t mask = m->capacity - 1;
+    uint64_t pos = (hash >> 7) & mask;
+    for (uint64_t stride = _CB_MAP_GROUP;; pos = (pos + stride) & mask, stride += _CB_MAP_GROUP) {
+        uint32_t match = _cb_map_match_free(m->ctrl + pos);
+        if (match) return (pos + _cb_map_ctz(match)) & mask;
+    }
+}
+
+static inline void _cb_map_resize(_cb_map* m, _cb_map_info const* info, uint64_t capacity)
+{
+    _cb_map old = *m;
+    m->capacity = capacity;
+    m->ctrl = (int8_t*)_cb_alloc_like(old.ctrl, capacity + _CB_MAP_GROUP); // a map that isn't bound to an arena stays on the heap
+    memset(m->ctrl, _CB_MAP_EMPTY, capacity + _CB_MAP_GROUP);
+    m->slots = (uint8_t*)_cb_alloc_like(old.slots, capacity * info->slot_size);
+    m->growth_left = capacity - capacity/8 - m->size;
+    for (uint64_t i = 0; i < old.capacity; ++i) {
+        if (old.ctrl[i] < 0) continue;
+        void* slot = _cb_map_slot(&old, info, i);
+        uint64_t index = _cb_map_find_free(m, info->hash(slot));
+        _cb_map_set_ctrl(m, index, old.ctrl[i]);
+        memcpy(_cb_map_slot(m, info, index), slot, info->slot_size);
+    }
+    _cb_free(old.ctrl);
+    _cb_free(old.slots);
+}
+
+// returns a pointer to the value of key. If the key wasn't in the map, it's inserted,
+//  *inserted is set to 1, and the caller has to initialize the value.
+static inline void* _cb_map_put(_cb_map* m, _cb_map_info const* info, void const* key, int* inserted)
+{
+    void* value = _cb_map_find(m, info, key);
+    *inserted = value == NULL;
+    if (value) return value;
+
+    uint64_t hash = info->hash(key);
+    uint64_t index = m->capacity ? _cb_map_find_free(m, hash) : 0;
+    if (m->capacity == 0 || (m->growth_left == 0 && m->ctrl[index] == _CB_MAP_EMPTY)) {
+        // full -> double the capacity, unless most of the used slots are deleted
+        uint64_t capacity = m->capacity ? m->capacity : _CB_MAP_GROUP;
+        if (m->size >= capacity/2) capacity *= 2;
+        _cb_map_resize(m, info, capacity);
+        index = _cb_map_find_free(m, hash);
+    }
+    if (m->ctrl[index] == _CB_MAP_EMPTY) m->growth_left--;
+    _cb_map_set_ctrl(m, index, (int8_t)(hash & 0x7f));
+    m->size++;
+    uint8_t* slot = (uint8_t*)_cb_map_slot(m, info, index);
+    memcpy(slot, key, info->value_offset);
+    return slot + info->value_offset;
+}
+
+// returns 1 if the key was removed, 0 if it wasn't in the map
+static inline int _cb_map_remove(_cb_map* m, _cb_map_info const* info, void const* key)
+{
+    uint8_t* value = (uint8_t*)_cb_map_find(m, info, key);
+    if (!value) return 0;
+    uint64_t index = (uint64_t)(value - info->value_offset - m->slots) / info->slot_size;
+    _cb_map_set_ctrl(m, index, _CB_MAP_DELETED); // tombstone, so probe sequences that pass this slot are not cut short
+    m->size--;
+    return 1;
+}
+
+// used for maps declared inside an #arena scope: an empty map gets empty arrays from the arena, so it grows in the arena
+static inline void _cb_map_bind_arena(_cb_map* m, _cb_arena* a)
+{
+    if (m->ctrl) return; // already has memory, which it keeps
+    m->ctrl = (int8_t*)_cb_arena_empty(a);
+    m->slots = (uint8_t*)_cb_arena_empty(a);
+}
+
+static inline void _cb_map_free(_cb_map* m)
+{
+    _cb_free(m->ctrl);
+    _cb_free(m->slots);
+    memset(m, 0, sizeof(_cb_map));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CB_MAP_H
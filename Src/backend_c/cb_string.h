@@ -0,0 +1,136 @@
+#ifndef _CB_STRING_H
+#define _CB_STRING_H
+
+/*
+Runtime for strings in generated C code.
+
+A string is 24 bytes, and stores its size explicitly, so the length is always known without strlen().
+    - Short strings (up to 22 bytes) are stored inline, without any allocation. The last byte holds the size.
+    - Longer strings are stored on the heap. The highest bit of the last byte is set, which can't happen
+      for a short string, since the size is at most 22.
+    - Long string literals point directly to the literal, with capacity 0. They are never freed or written to.
+Allocations go through cb_arena.h. Strings are never bound to an #arena scope, so they are always on the heap.
+The data is always null terminated, so _cb_string_cstr() can be passed to any c function that expects a char*.
+
+    s := "hello";   // _cb_string s = ((_cb_string){ .small = { "hello", 5 } });
+
+The zero initialized string {0} is the empty string.
+
+The layout assumes a little endian machine: the last byte of the small form overlaps the highest byte of
+    the capacity in the large form.
+This file is also included by the compiler, which uses the same representation for compile time strings.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cb_arena.h"
+
+#define _CB_STRING_SMALL_MAX 22
+#define _CB_STRING_LARGE_FLAG ((uint64_t)1 << 63)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _cb_string {
+    union {
+        struct { char data[_CB_STRING_SMALL_MAX+1]; uint8_t size; } small;
+        struct { char* data; uint64_t size; uint64_t capacity; } large; // capacity includes _CB_STRING_LARGE_FLAG
+    };
+} _cb_string;
+
+
+
+static inline int _cb_string_is_large(_cb_string const* s)
+{
+    return (s->small.size & 0x80) != 0;
+}
+
+static inline uint64_t _cb_string_size(_cb_string const* s)
+{
+    return _cb_string_is_large(s) ? s->large.size : s->small.size;
+}
+
+static inline char const* _cb_string_cstr(_cb_string const* s)
+{
+    return _cb_string_is_large(s) ? s->large.data : s->small.data;
+}
+
+// copies size bytes from data; only allocates if size > _CB_STRING_SMALL_MAX
+static inline _cb_string _cb_string_from(char const* data, uint64_t size)
+{
+    _cb_string s;
+    memset(&s, 0, sizeof(s));
+    if (size <= _CB_STRING_SMALL_MAX) {
+        memcpy(s.small.data, data, size);
+        s.small.size = (uint8_t)size;
+    } else {
+        s.large.data = (char*)_cb_alloc(size+1);
+        memcpy(s.large.data, data, size);
+        s.large.data[size] = '\0';
+        s.large.size = size;
+        s.large.capacity = size | _CB_STRING_LARGE_FLAG;
+    }
+    return s;
+}
+
+static inline _cb_string _cb_string_from_cstr(char const* cstr)
+{
+    return _cb_string_from(cstr, cstr ? strlen(cstr) : 0);
+}
+
+static inline _cb_string _cb_string_copy(_cb_string const* s)
+{
+    if (!_cb_string_is_large(s)) return *s;
+    return _cb_string_from(s->large.data, s->large.size);
+}
+
+static inline void _cb_string_append(_cb_string* s, char const* data, uint64_t n)
+{
+    uint64_t size = _cb_string_size(s);
+    uint64_t new_size = size + n;
+    if (new_size <= _CB_STRING_SMALL_MAX) {
+        memcpy(s->small.data + size, data, n);
+        s->small.data[new_size] = '\0';
+        s->small.size = (uint8_t)new_size;
+        return;
+    }
+    uint64_t capacity = _cb_string_is_large(s) ? s->large.capacity & ~_CB_STRING_LARGE_FLAG : 0;
+    if (new_size > capacity) {
+        // grow by doubling; literals (capacity 0) and small strings are copied to the heap
+        uint64_t new_capacity = capacity*2 > new_size ? capacity*2 : new_size;
+        char* p;
+        if (capacity) {
+            p = (char*)_cb_realloc(s->large.data, capacity+1, new_capacity+1);
+        } else {
+            p = (char*)_cb_alloc(new_capacity+1);
+            memcpy(p, _cb_string_cstr(s), size);
+        }
+        s->large.data = p;
+        s->large.capacity = new_capacity | _CB_STRING_LARGE_FLAG;
+    }
+    memcpy(s->large.data + size, data, n);
+    s->large.data[new_size] = '\0';
+    s->large.size = new_size;
+}
+
+static inline int _cb_string_eq(_cb_string const* a, _cb_string const* b)
+{
+    uint64_t size = _cb_string_size(a);
+    return size == _cb_string_size(b) && memcmp(_cb_string_cstr(a), _cb_string_cstr(b), size) == 0;
+}
+
+static inline void _cb_string_free(_cb_string* s)
+{
+    if (_cb_string_is_large(s) && (s->large.capacity & ~_CB_STRING_LARGE_FLAG)) _cb_free(s->large.data);
+    memset(s, 0, sizeof(*s));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CB_STRING_H
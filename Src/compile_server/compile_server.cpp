@@ -0,0 +1,286 @@
+#include "compile_server.h"
+#include "../parser/parser.h"
+#include "../parser/operator_table.h"
+#include "../abstx/abstx_scope.h"
+#include "../abstx/expressions/abstx_function.h"
+#include "../abstx/statements/abstx_for.h"
+#include "../types/cb_function.h"
+#include "../utilities/assert.h"
+#include "../utilities/error_handler.h"
+#include "../utilities/hash.h"
+#include "../utilities/debug.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+// errors is the error count from before the global scope was parsed
+static bool compile_global_scope(Shared<Global_scope> gs, int errors, std::ostream& target)
+{
+    if (gs == nullptr || is_error(gs->status) || error_count() > errors) return false;
+
+    LOG("generating statement code");
+    std::ostringstream statement_code;
+    for (const auto& s : gs->statements) {
+        ASSERT(s); // no statement can be nullpointer here
+        s->generate_code(statement_code);
+    }
+
+    LOG("generating used function code");
+    gs->generate_program(statement_code.str(), target);
+    return true;
+}
+
+bool compile_file(const std::string& file, std::ostream& target)
+{
+    int errors = error_count();
+    return compile_global_scope(parse_file(file), errors, target);
+}
+
+bool compile_string(const std::string& source, const std::string& name, std::ostream& target)
+{
+    int errors = error_count();
+    Token_context context;
+    context.file = name;
+    return compile_global_scope(parse_string(source, name, context), errors, target);
+}
+
+
+
+namespace {
+
+struct Compile_response_header {
+    uint32_t success;
+    uint32_t code_size;
+    uint32_t error_size;
+};
+
+struct File_stamp {
+    int64_t mtime_sec = 0;
+    int64_t mtime_nsec = 0;
+    uint64_t hash = 0;
+};
+
+} // namespace
+
+
+
+#ifdef __WIN32
+
+int serve(const std::string& socket_path)
+{
+    std::cerr << "The compile server is not supported on this platform" << std::endl;
+    return 1;
+}
+
+int request_compile(const std::string& socket_path, const std::string& file, std::ostream& out, std::ostream& err)
+{
+    err << "The compile server is not supported on this platform" << std::endl;
+    return 1;
+}
+
+#else
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <climits> // PATH_MAX
+#include <cstdlib> // realpath
+#include <cstring> // strncpy
+
+static bool write_all(int fd, const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL); // the client might be gone -> don't die from SIGPIPE
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void* data, size_t size)
+{
+    char* p = (char*)data;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// reads until the other end closes the socket for writing
+static std::string read_until_eof(int fd)
+{
+    std::string s;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) s.append(buffer, n);
+    return s;
+}
+
+static bool get_socket_address(const std::string& socket_path, sockaddr_un& addr)
+{
+    if (socket_path.size() >= sizeof(addr.sun_path)) return false;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    return true;
+}
+
+
+// the stamps of all parsed files, from when they were last checked
+static std::map<std::string, File_stamp> file_stamps;
+
+static uint64_t hash_file(const std::string& file)
+{
+    std::ifstream ifs{file, std::ios::binary};
+    std::ostringstream content{};
+    content << ifs.rdbuf();
+    return hash_string(content.str());
+}
+
+// updates the stamp; returns true if the content of the file changed since the stamp was taken
+// only the modification time is checked unless it changed, so unchanged files are never read
+static bool update_stamp(const std::string& file, File_stamp& stamp)
+{
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0) return true; // removed (or not a file at all, e.g. parse_string())
+    if (st.st_mtim.tv_sec == stamp.mtime_sec && st.st_mtim.tv_nsec == stamp.mtime_nsec) return false;
+    stamp.mtime_sec = st.st_mtim.tv_sec;
+    stamp.mtime_nsec = st.st_mtim.tv_nsec;
+    uint64_t hash = hash_file(file);
+    if (hash == stamp.hash) return false; // touched, but not changed
+    stamp.hash = hash;
+    return true;
+}
+
+static void invalidate_changed_files()
+{
+    for (const std::string& file : parsed_files()) {
+        auto it = file_stamps.find(file);
+        if (it == file_stamps.end() || update_stamp(file, it->second)) {
+            LOG("compile server: " << file << " changed");
+            invalidate_file(file);
+        }
+    }
+    // forget the stamps of invalidated files; they are taken again when the files are parsed
+    std::set<std::string> parsed;
+    for (const std::string& file : parsed_files()) parsed.insert(file);
+    for (auto it = file_stamps.begin(); it != file_stamps.end(); ) {
+        if (parsed.count(it->first)) ++it;
+        else it = file_stamps.erase(it);
+    }
+}
+
+static void handle_request(int client)
+{
+    std::string file = read_until_eof(client);
+    invalidate_changed_files();
+    std::vector<std::string> parsed_before = parsed_files();
+
+    // errors are logged to std::cerr -> capture them for the client
+    std::ostringstream code;
+    std::ostringstream errors;
+    std::streambuf* cerr_buf = std::cerr.rdbuf(errors.rdbuf());
+    reset_error_count();
+    reset_infix_operators(); // parse_file() registers the operators of a reused file again
+    bool success = false;
+    try {
+        success = compile_file(file, code);
+    } catch (const Assert_failure&) {
+        // the message is already logged; the files parsed by this request are dropped below, since they might be half parsed
+        code.str("");
+    }
+    std::cerr.rdbuf(cerr_buf);
+
+    std::set<std::string> old_files(parsed_before.begin(), parsed_before.end());
+    for (const std::string& parsed : parsed_files()) {
+        if (old_files.count(parsed)) continue;
+        if (!success) invalidate_file(parsed); // parse it again next time, so that the errors are reported again
+        else update_stamp(parsed, file_stamps[parsed]);
+    }
+    if (!success) invalidate_file(file);
+
+    std::string code_str = success ? code.str() : "";
+    std::string error_str = errors.str();
+    Compile_response_header header;
+    header.success = success;
+    header.code_size = code_str.size();
+    header.error_size = error_str.size();
+    if (write_all(client, &header, sizeof(header)) && write_all(client, code_str.data(), code_str.size())) {
+        write_all(client, error_str.data(), error_str.size());
+    }
+}
+
+int serve(const std::string& socket_path)
+{
+    sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || !get_socket_address(socket_path, addr)) {
+        std::cerr << "Unable to create compile server socket \"" << socket_path << "\"" << std::endl;
+        return 1;
+    }
+    unlink(socket_path.c_str()); // left by an earlier server
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        std::cerr << "Unable to listen on compile server socket \"" << socket_path << "\"" << std::endl;
+        close(fd);
+        return 1;
+    }
+
+    recoverable_asserts() = true; // a failed assert only fails the request (see handle_request())
+
+    // the compiler isn't thread safe -> the requests are handled one at the time, in the order they arrive
+    while (true) {
+        int client = accept(fd, nullptr, nullptr);
+        if (client < 0) continue;
+        handle_request(client);
+        close(client);
+    }
+}
+
+int request_compile(const std::string& socket_path, const std::string& file, std::ostream& out, std::ostream& err)
+{
+    sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || !get_socket_address(socket_path, addr) || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        err << "Unable to connect to compile server at \"" << socket_path << "\"" << std::endl;
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    // the server might run in a different directory
+    char path[PATH_MAX];
+    std::string request = realpath(file.c_str(), path) ? path : file;
+    write_all(fd, request.data(), request.size());
+    shutdown(fd, SHUT_WR);
+
+    Compile_response_header header;
+    std::string code, errors;
+    bool ok = read_all(fd, &header, sizeof(header));
+    if (ok) {
+        code.resize(header.code_size);
+        errors.resize(header.error_size);
+        ok = read_all(fd, &code[0], code.size()) && read_all(fd, &errors[0], errors.size());
+    }
+    close(fd);
+    if (!ok) {
+        err << "Lost connection to compile server at \"" << socket_path << "\"" << std::endl;
+        return 1;
+    }
+    out << code;
+    err << errors;
+    return header.success ? 0 : 1;
+}
+
+#endif
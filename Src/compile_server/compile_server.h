@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <ostream>
+
+/*
+Compile server: keeps the compiler resident between compilations, so that the startup cost is only paid once.
+
+    cube --server <socket>              listens on a local (unix domain) socket and serves compile requests, one at a time
+    cube --connect <socket> <file>      compiles the file with a running server. The generated c code is written to stdout,
+                                        and error messages to stderr. Returns 0 if the compilation succeeded.
+
+Everything that is normally built at startup is kept between requests: the built-in types and their identifiers,
+    all complex types, the dlls compiled for #run statements, and the global scopes of all parsed files (see parse_file()).
+Before each request, the parsed files are checked for changes. A file is parsed again only if its modification time changed
+    and its content hash differs; the files that import it are parsed again as well. Files from a failed request are always
+    parsed again, so that their errors are reported every time.
+User declared infix operators are reset before each request, so a request can only use the operators declared in its own files.
+A failed assert only fails the request: it's reported like an error, and the files parsed by the request are parsed again next time.
+
+Protocol: the client sends the absolute file path and closes its end of the socket for writing.
+    The server answers with a Compile_response_header, followed by the generated c code and the error messages.
+*/
+
+// parses the file and writes the generated c code to target
+// returns false if there were errors; they are logged as usual, and nothing is written
+bool compile_file(const std::string& file, std::ostream& target);
+// same for source code that isn't read from a file, e.g. in tests; name is used as the file name in error messages
+bool compile_string(const std::string& source, const std::string& name, std::ostream& target);
+
+int serve(const std::string& socket_path); // only returns if the server can't be started
+int request_compile(const std::string& socket_path, const std::string& file, std::ostream& out, std::ostream& err);
@@ -1,62 +1,27 @@
 #pragma once
 
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// #ifndef __cplusplus
-
-    #ifndef int_least8_t
-    #define int_least8_t signed char
-    #endif
-
-    #ifndef int_least16_t
-    #define int_least16_t signed short
-    #endif
-
-    #ifndef int_least32_t
-    #define int_least32_t signed long
-    #endif
-
-    #ifndef int_least64_t
-    #define int_least64_t signed long long
-    #endif
-
-    #ifndef uint_least8_t
-    #define uint_least8_t unsigned char
-    #endif
-
-    #ifndef uint_least16_t
-    #define uint_least16_t unsigned short
-    #endif
-
-    #ifndef uint_least32_t
-    #define uint_least32_t unsigned long
-    #endif
-
-    #ifndef uint_least64_t
-    #define uint_least64_t unsigned long long
-    #endif
-
-// #endif
-
-
+    // static inline, since this file is included in the generated c code (see CB_Vector::generate_typedef())
     #define INFIX_OPERATOR(name, op, lhs_type, rhs_type, rval_type)     \
-    void _infix_operator_##name(lhs_type lhs, rhs_type rhs, rval_type* __rval_1) { *__rval_1 = lhs op rhs; }
+    static inline void _infix_operator_##name(lhs_type lhs, rhs_type rhs, rval_type* __rval_1) { *__rval_1 = lhs op rhs; }
 
 
-    #define INFIX_GENERATOR_INT(name, op)                                               \
-    /* int + int */                                                                     \
-    INFIX_OPERATOR(name##_i8_i8, op, int_least8_t, int_least8_t, int_least8_t);         \
-    INFIX_OPERATOR(name##_i16_i16, op, int_least16_t, int_least16_t, int_least16_t);    \
-    INFIX_OPERATOR(name##_i32_i32, op, int_least32_t, int_least32_t, int_least32_t);    \
-    INFIX_OPERATOR(name##_i64_i64, op, int_least64_t, int_least64_t, int_least64_t);    \
-    /* uint + uint */                                                                   \
-    INFIX_OPERATOR(name##_u8_u8, op, uint_least8_t, uint_least8_t, uint_least8_t);      \
-    INFIX_OPERATOR(name##_u16_u16, op, uint_least16_t, uint_least16_t, uint_least16_t); \
-    INFIX_OPERATOR(name##_u32_u32, op, uint_least32_t, uint_least32_t, uint_least32_t); \
-    INFIX_OPERATOR(name##_u64_u64, op, uint_least64_t, uint_least64_t, uint_least64_t);
+    #define INFIX_GENERATOR_INT(name, op)                               \
+    /* int + int */                                                     \
+    INFIX_OPERATOR(name##_i8_i8, op, int8_t, int8_t, int8_t);           \
+    INFIX_OPERATOR(name##_i16_i16, op, int16_t, int16_t, int16_t);      \
+    INFIX_OPERATOR(name##_i32_i32, op, int32_t, int32_t, int32_t);      \
+    INFIX_OPERATOR(name##_i64_i64, op, int64_t, int64_t, int64_t);      \
+    /* uint + uint */                                                   \
+    INFIX_OPERATOR(name##_u8_u8, op, uint8_t, uint8_t, uint8_t);        \
+    INFIX_OPERATOR(name##_u16_u16, op, uint16_t, uint16_t, uint16_t);   \
+    INFIX_OPERATOR(name##_u32_u32, op, uint32_t, uint32_t, uint32_t);   \
+    INFIX_OPERATOR(name##_u64_u64, op, uint64_t, uint64_t, uint64_t);
 
     #define INFIX_GENERATOR_FLOAT(name, op)                             \
     INFIX_OPERATOR(name##_float_float, op, float, float, float);        \
@@ -76,6 +41,69 @@ extern "C" {
 
 
 
+    // SIMD vector types (see types/cb_vector.h), using gcc vector extensions
+    // The _unaligned variants are used to load and store vectors directly in sequences,
+    //   which are only aligned to their element type.
+    #define VECTOR_TYPE(name, lane_type, lanes)                                             \
+    typedef lane_type _cb_##name __attribute__((vector_size(sizeof(lane_type)*lanes)));     \
+    typedef lane_type _cb_##name##_unaligned __attribute__((vector_size(sizeof(lane_type)*lanes), aligned(sizeof(lane_type)), may_alias));
+
+    VECTOR_TYPE(v16i8, int8_t, 16);
+    VECTOR_TYPE(v8i16, int16_t, 8);
+    VECTOR_TYPE(v4i32, int32_t, 4);
+    VECTOR_TYPE(v2i64, int64_t, 2);
+    VECTOR_TYPE(v16u8, uint8_t, 16);
+    VECTOR_TYPE(v8u16, uint16_t, 8);
+    VECTOR_TYPE(v4u32, uint32_t, 4);
+    VECTOR_TYPE(v2u64, uint64_t, 2);
+    VECTOR_TYPE(v4f32, float, 4);
+    VECTOR_TYPE(v2f64, double, 2);
+
+    VECTOR_TYPE(v8i32, int32_t, 8);
+    VECTOR_TYPE(v4i64, int64_t, 4);
+    VECTOR_TYPE(v8u32, uint32_t, 8);
+    VECTOR_TYPE(v4u64, uint64_t, 4);
+    VECTOR_TYPE(v8f32, float, 8);
+    VECTOR_TYPE(v4f64, double, 4);
+
+
+    // all operators work element-wise
+    #define INFIX_OPERATOR_VECTOR(name, op, vector_name) \
+    INFIX_OPERATOR(name##_##vector_name##_##vector_name, op, _cb_##vector_name, _cb_##vector_name, _cb_##vector_name);
+
+    #define INFIX_GENERATOR_VECTOR_INT(name, op)    \
+    INFIX_OPERATOR_VECTOR(name, op, v16i8);         \
+    INFIX_OPERATOR_VECTOR(name, op, v8i16);         \
+    INFIX_OPERATOR_VECTOR(name, op, v4i32);         \
+    INFIX_OPERATOR_VECTOR(name, op, v2i64);         \
+    INFIX_OPERATOR_VECTOR(name, op, v16u8);         \
+    INFIX_OPERATOR_VECTOR(name, op, v8u16);         \
+    INFIX_OPERATOR_VECTOR(name, op, v4u32);         \
+    INFIX_OPERATOR_VECTOR(name, op, v2u64);         \
+    INFIX_OPERATOR_VECTOR(name, op, v8i32);         \
+    INFIX_OPERATOR_VECTOR(name, op, v4i64);         \
+    INFIX_OPERATOR_VECTOR(name, op, v8u32);         \
+    INFIX_OPERATOR_VECTOR(name, op, v4u64);
+
+    #define INFIX_GENERATOR_VECTOR_FLOAT(name, op)  \
+    INFIX_OPERATOR_VECTOR(name, op, v4f32);         \
+    INFIX_OPERATOR_VECTOR(name, op, v2f64);         \
+    INFIX_OPERATOR_VECTOR(name, op, v8f32);         \
+    INFIX_OPERATOR_VECTOR(name, op, v4f64);
+
+    #define INFIX_GENERATOR_VECTOR(name, op)    \
+    INFIX_GENERATOR_VECTOR_FLOAT(name, op)      \
+    INFIX_GENERATOR_VECTOR_INT(name, op)
+
+
+    INFIX_GENERATOR_VECTOR(plus,+);
+    INFIX_GENERATOR_VECTOR(minus,-);
+    INFIX_GENERATOR_VECTOR(mult,*);
+    INFIX_GENERATOR_VECTOR(div,/);
+
+    INFIX_GENERATOR_VECTOR_INT(mod,%);
+
+
 
 
 #ifdef __cplusplus
@@ -0,0 +1,141 @@
+#include "constant_folding.h"
+#include "built_in_operators.h"
+#include "../types/cb_primitives.h"
+#include "../abstx/abstx.h" // alloc_constant_data()
+
+#include <cmath>
+#include <limits>
+
+
+bool is_foldable_type(Shared<const CB_Type> type)
+{
+    if (type == nullptr) return false;
+    for (const auto& t : { CB_Bool::type, CB_Int::type, CB_Uint::type, CB_Float::type,
+                           CB_i8::type, CB_i16::type, CB_i32::type, CB_i64::type,
+                           CB_u8::type, CB_u16::type, CB_u32::type, CB_u64::type, CB_f32::type, CB_f64::type }) {
+        if (*type == *t) return true;
+    }
+    return false;
+}
+
+
+template<typename T>
+static bool is_literal_value(T value, std::true_type /* is_integral */) { return true; }
+
+template<typename T>
+static bool is_literal_value(T value, std::false_type /* is_integral */) { return std::isfinite(value); } // no literals for inf and nan
+
+template<typename T>
+static bool can_divide(T lhs, T rhs) {
+    if (std::is_floating_point<T>::value) return true;
+    if (rhs == 0) return false;
+    return !(std::is_signed<T>::value && lhs == std::numeric_limits<T>::min() && rhs == (T)-1); // overflow traps
+}
+
+template<typename T>
+static bool set_result(Shared<const CB_Type> type, T value, Any& result)
+{
+    if (!is_literal_value(value, std::is_integral<T>())) return false;
+    result.v_type = type;
+    result.v_ptr = alloc_constant_data(sizeof(T));
+    *(T*)result.v_ptr = value;
+    return true;
+}
+
+// comparisons are the same in C and C++, so they don't need built_in_operators.h
+template<typename T>
+static bool fold_comparison(const std::string& op, T a, T b, Any& result)
+{
+    bool r;
+    if (op == "<") r = a < b;
+    else if (op == ">") r = a > b;
+    else if (op == "<=") r = a <= b;
+    else if (op == ">=") r = a >= b;
+    else if (op == "==") r = a == b;
+    else if (op == "!=") r = a != b;
+    else return false;
+    return set_result(CB_Bool::type, r, result);
+}
+
+#define FOLD_INFIX_INT(cb_type, operand)                                                                           \
+    if (*type == *cb_type::type) {                                                                                  \
+        typedef cb_type::c_typedef T;                                                                               \
+        T a = *(const T*)lhs.v_ptr, b = *(const T*)rhs.v_ptr, r;                                                    \
+        if (fold_comparison(op, a, b, result)) return true;                                                         \
+        if (op == "+") _infix_operator_plus_##operand##_##operand(a, b, &r);                                        \
+        else if (op == "-") _infix_operator_minus_##operand##_##operand(a, b, &r);                                  \
+        else if (op == "*") _infix_operator_mult_##operand##_##operand(a, b, &r);                                   \
+        else if (op == "/" && can_divide(a, b)) _infix_operator_div_##operand##_##operand(a, b, &r);                \
+        else if (op == "%" && can_divide(a, b)) _infix_operator_mod_##operand##_##operand(a, b, &r);                \
+        else return false;                                                                                          \
+        return set_result(type, r, result);                                                                         \
+    }
+
+#define FOLD_INFIX_FLOAT(cb_type, operand)                                                                         \
+    if (*type == *cb_type::type) {                                                                                  \
+        typedef cb_type::c_typedef T;                                                                               \
+        T a = *(const T*)lhs.v_ptr, b = *(const T*)rhs.v_ptr, r;                                                    \
+        if (fold_comparison(op, a, b, result)) return true;                                                         \
+        if (op == "+") _infix_operator_plus_##operand##_##operand(a, b, &r);                                        \
+        else if (op == "-") _infix_operator_minus_##operand##_##operand(a, b, &r);                                  \
+        else if (op == "*") _infix_operator_mult_##operand##_##operand(a, b, &r);                                   \
+        else if (op == "/") _infix_operator_div_##operand##_##operand(a, b, &r);                                    \
+        else return false;                                                                                          \
+        return set_result(type, r, result);                                                                         \
+    }
+
+bool fold_infix_operator(const std::string& op, const Any& lhs, const Any& rhs, Any& result)
+{
+    if (lhs.v_ptr == nullptr || rhs.v_ptr == nullptr || lhs.v_type == nullptr || rhs.v_type == nullptr) return false;
+    if (*lhs.v_type != *rhs.v_type) return false;
+    Shared<const CB_Type> type = lhs.v_type;
+    if (*type == *CB_Bool::type) {
+        bool a = *(const bool*)lhs.v_ptr, b = *(const bool*)rhs.v_ptr;
+        if (op == "&&") return set_result(type, a && b, result);
+        if (op == "||") return set_result(type, a || b, result);
+        if (op == "==") return set_result(type, a == b, result);
+        if (op == "!=") return set_result(type, a != b, result);
+        return false;
+    }
+    FOLD_INFIX_INT(CB_Int, i64);
+    FOLD_INFIX_INT(CB_Uint, u64);
+    FOLD_INFIX_INT(CB_i8, i8);
+    FOLD_INFIX_INT(CB_i16, i16);
+    FOLD_INFIX_INT(CB_i32, i32);
+    FOLD_INFIX_INT(CB_i64, i64);
+    FOLD_INFIX_INT(CB_u8, u8);
+    FOLD_INFIX_INT(CB_u16, u16);
+    FOLD_INFIX_INT(CB_u32, u32);
+    FOLD_INFIX_INT(CB_u64, u64);
+    FOLD_INFIX_FLOAT(CB_f32, float);
+    FOLD_INFIX_FLOAT(CB_f64, double);
+    FOLD_INFIX_FLOAT(CB_Float, double);
+    return false; // vectors are not folded
+}
+
+
+// same as the generated code: ((T)-(x))
+#define FOLD_PREFIX(cb_type)                                                                                       \
+    if (*type == *cb_type::type) {                                                                                  \
+        typedef cb_type::c_typedef T;                                                                               \
+        T a = *(const T*)operand.v_ptr;                                                                             \
+        if (std::is_integral<T>::value && a == std::numeric_limits<T>::min()) return false; /* overflow */         \
+        return set_result(type, (T)-(a), result);                                                                   \
+    }
+
+bool fold_prefix_operator(const std::string& op, const Any& operand, Any& result)
+{
+    if (operand.v_ptr == nullptr || operand.v_type == nullptr) return false;
+    Shared<const CB_Type> type = operand.v_type;
+    if (op == "!") return *type == *CB_Bool::type && set_result(type, !*(const bool*)operand.v_ptr, result);
+    if (op != "-") return false;
+    FOLD_PREFIX(CB_Int);
+    FOLD_PREFIX(CB_i8);
+    FOLD_PREFIX(CB_i16);
+    FOLD_PREFIX(CB_i32);
+    FOLD_PREFIX(CB_i64);
+    FOLD_PREFIX(CB_f32);
+    FOLD_PREFIX(CB_f64);
+    FOLD_PREFIX(CB_Float);
+    return false;
+}
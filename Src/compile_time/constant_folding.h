@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../types/cb_any.h"
+
+#include <string>
+
+/*
+Constant folding: built-in operators (see abstx_infix_operator.h and abstx_prefix_operator.h) with constant operands
+    are evaluated when the expression is finalized, and the result is used as the constant value of the expression.
+    That way, folded expressions can be used where a constant is needed, and constants of foldable types are
+    propagated into their uses as literals.
+
+a :: 2;
+b := a * 3 + 1;             // generates: _cb_uint b = 7ULL;
+
+The operators are evaluated with the same functions as the generated code (compile_time/built_in_operators.h),
+    so the result is the same as if the expression was evaluated at runtime.
+Expressions that can't be folded without changing the behaviour of the program (integer division by zero,
+    signed overflow in division, and float results that can't be written as a literal) are left for the runtime.
+*/
+
+// numbers and bools; other constants are not propagated
+bool is_foldable_type(Shared<const CB_Type> type);
+
+// op is the operator symbol: + - * / % < > <= >= == != && || (infix), - ! (prefix)
+// returns false if the expression can't be folded. Otherwise, result is set to the folded value.
+bool fold_infix_operator(const std::string& op, const Any& lhs, const Any& rhs, Any& result);
+bool fold_prefix_operator(const std::string& op, const Any& operand, Any& result);
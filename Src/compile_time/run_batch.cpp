@@ -0,0 +1,518 @@
+#include "run_batch.h"
+#include "run_cache.h"
+#include "../runtime_dll/dll.h"
+#include "../utilities/unique_id.h"
+#include "../utilities/error_handler.h"
+#include "../utilities/hash.h"
+
+#include <set>
+#include <algorithm> // max
+#include <memory>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <cstdlib> // getenv
+#include <cstring> // memcpy
+#include <cstdint> // uintptr_t
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+
+// Results from #run statements are used as constant values for the rest of the compilation.
+// The dlls are kept loaded, since the results might point to data inside them.
+static std::vector<std::unique_ptr<uint8_t[]>> run_frames; // one per wave
+static std::vector<dll::dll_handle> run_dlls;
+
+struct Run_entry
+{
+    Shared<Abstx_function_call> call;
+    std::string entry_point;
+    void(*fn)(void**) = nullptr;
+    Seq<void*> out; // one pointer per out argument
+    size_t frame_offset = 0; // the out arguments are stored in frame[frame_offset, frame_offset+frame_size)
+    size_t frame_size = 0;
+    std::string code; // the call on its own, with everything it uses (see generate_call_code())
+    bool pure = false; // the called code can't see or change anything outside the call (see generate_call_code()) -> can be cached
+    uint64_t cache_key = 0; // 0 if the result can't be cached
+    bool cached = false; // the result was read from the cache -> the entry point is never called
+};
+
+
+static std::string runtime_dir;
+
+void set_runtime_dir(const std::string& dir) { runtime_dir = dir; }
+
+static bool has_runtime_headers(const std::string& dir)
+{
+    return std::ifstream{dir + "backend_c/cb_async.h"}.is_open() && std::ifstream{dir + "compile_time/built_in_operators.h"}.is_open();
+}
+
+static std::string with_slash(std::string dir)
+{
+    if (!dir.empty() && dir.back() != '/' && dir.back() != '\\') dir += "/";
+    return dir;
+}
+
+// The compiler source directory (with a trailing '/'), where the runtime headers are found. Returns "" if it can't be found.
+// __FILE__ is relative when the compiler is built with make.bat, so it's only used as a last resort.
+static std::string runtime_src_dir()
+{
+    std::vector<std::string> candidates;
+    if (!runtime_dir.empty()) candidates.push_back(runtime_dir); // --runtime-dir
+    if (const char* env = getenv("CB_SRC_DIR")) candidates.push_back(env);
+#ifdef CB_SRC_DIR
+    candidates.push_back(CB_SRC_DIR);
+#endif
+    std::string exe_dir = dll::get_executable_dir();
+    if (!exe_dir.empty()) candidates.push_back(exe_dir); // make.bat builds cube.exe in the source directory
+    std::string file = __FILE__;
+    size_t pos = file.rfind("compile_time");
+    if (pos != std::string::npos) candidates.push_back(file.substr(0, pos));
+
+    for (const auto& dir : candidates) {
+        if (has_runtime_headers(with_slash(dir))) return with_slash(dir);
+    }
+    return "";
+}
+
+
+static unsigned run_thread_count = 0;
+
+void set_run_thread_count(unsigned n) { run_thread_count = n; }
+
+
+namespace {
+
+// Worker threads that are kept between waves. They are started when first needed, and stopped when the compiler exits.
+struct Run_pool
+{
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    std::function<void()> work = nullptr; // called once by each worker for each batch
+    uint64_t batch = 0;
+    size_t busy = 0;
+    bool stopping = false;
+
+    ~Run_pool() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        work_ready.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    void worker(uint64_t seen) {
+        while (true) {
+            std::function<void()> w;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                work_ready.wait(lock, [&]() { return stopping || batch != seen; });
+                if (stopping) return;
+                seen = batch;
+                w = work;
+            }
+            w();
+            std::lock_guard<std::mutex> lock{mutex};
+            if (--busy == 0) work_done.notify_one();
+        }
+    }
+
+    // calls fn on the calling thread and on n_workers worker threads, and waits until all calls have returned
+    void run(size_t n_workers, const std::function<void()>& fn) {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            while (threads.size() < n_workers) threads.emplace_back(&Run_pool::worker, this, batch);
+            work = fn;
+            batch++;
+            busy = threads.size();
+        }
+        work_ready.notify_all();
+        fn(); // the calling thread helps out
+        std::unique_lock<std::mutex> lock{mutex};
+        work_done.wait(lock, [&]() { return busy == 0; });
+        work = nullptr;
+    }
+};
+
+Run_pool run_pool;
+
+} // namespace
+
+
+// All entries in a wave share the global variables of the dll. Pure entries don't use any of them, and don't write
+//     anything outside their own results (see generate_call_code()), so they can't see each other and are run in parallel.
+// Other entries are run one at the time in statement order, so that their side effects (changed globals, printing,
+//     file access, ...) happen in the same order every time.
+// Entries without an entry point are cached or failed to compile.
+static void execute_entries(Seq<Run_entry>& wave)
+{
+    Seq<Run_entry*> parallel;
+    for (auto& entry : wave) {
+        if (entry.fn && entry.pure) parallel.add(&entry);
+    }
+
+    size_t n_threads = run_thread_count ? run_thread_count : std::thread::hardware_concurrency();
+    if (n_threads > parallel.size) n_threads = parallel.size;
+    if (n_threads > 1) {
+        // workers grab entries until there are none left
+        std::atomic<uint32_t> next{0};
+        run_pool.run(n_threads - 1, [&]() {
+            for (uint32_t i = next++; i < parallel.size; i = next++) {
+                parallel[i]->fn(parallel[i]->out.v_ptr);
+            }
+        });
+    } else {
+        for (Run_entry* entry : parallel) entry->fn(entry->out.v_ptr);
+    }
+
+    for (auto& entry : wave) {
+        if (entry.fn && !entry.pure) entry.fn(entry.out.v_ptr);
+    }
+}
+
+
+// returns the offset of a value of the given type, placed after offset bytes in a frame
+static size_t aligned_offset(size_t offset, Shared<const CB_Type> type)
+{
+    // the alignment of a type always divides its size, so the default alignment (the size) is safe to round up to
+    size_t alignment = type->alignment(); // the frame itself is aligned to the largest alignment in it (see run_wave())
+    if (alignment == 0) return offset;
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+
+// returns true if the call can be evaluated in the current wave
+// sets the call status to an error if it can never be evaluated
+static bool is_ready(Shared<Abstx_function_call> call)
+{
+    if (!is_codegen_ready(call->status)) return false;
+    if (call->function == nullptr) {
+        log_error("Function in #run statement must be known at compile time", call->context);
+        call->status = Parsing_status::COMPILE_TIME_ERROR;
+        return false;
+    }
+    for (const auto& arg : call->in_args) {
+        if (!arg->has_constant_value()) return false; // might be the result of another #run statement
+    }
+    for (const auto& arg : call->out_args) {
+        if (dynamic_pointer_cast<Abstx_identifier>(arg) == nullptr) {
+            log_error("Out arguments in #run statement must be identifiers", arg->context);
+            call->status = Parsing_status::COMPILE_TIME_ERROR;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static void generate_entry_point(std::ostream& target, const Run_entry& entry)
+{
+    const auto& call = entry.call;
+    target << "void " << entry.entry_point << "(void** _cb_out) {" << std::endl;
+
+    // in arguments are constant -> write them as literals
+    for (uint32_t i = 0; i < call->in_args.size; ++i) {
+        Shared<const CB_Type> type = call->in_args[i]->get_type();
+        type->generate_type(target);
+        target << " _cb_arg_" << i << " = ";
+        type->generate_literal(target, call->in_args[i]->get_constant_value().v_ptr);
+        target << ";" << std::endl;
+    }
+
+    bool returns_value = call->function_type()->returns_value();
+    if (returns_value) {
+        target << "*(";
+        call->out_args[0]->get_type()->generate_type(target);
+        target << "*)_cb_out[0] = ";
+    }
+    call->function->generate_code(target); // also adds the function to used_functions
+    target << "(";
+    for (uint32_t i = 0; i < call->in_args.size; ++i) {
+        if (i) target << ", ";
+        if (!call->in_args[i]->get_type()->is_primitive()) target << "&"; // same calling convention as Abstx_function_call
+        target << "_cb_arg_" << i;
+    }
+    if (call->in_args.size > 0 && call->out_args.size > 0 && !returns_value) target << ", ";
+    for (uint32_t i = 0; i < call->out_args.size && !returns_value; ++i) {
+        if (i) target << ", ";
+        target << "(";
+        call->out_args[i]->get_type()->generate_type(target);
+        target << "*)_cb_out[" << i << "]";
+    }
+    target << ");" << std::endl;
+    target << "_cb_async_wait();" << std::endl; // async calls must be done before the result is used
+    target << "}" << std::endl;
+}
+
+
+// generates the call again on its own, together with all functions and global variables it might use
+// global variables that aren't resolved yet are added to unknown
+// returns true if the call is pure: the result only depends on the generated code. That is not the case if it
+//     reads or writes a global variable (other statements might change it), writes through a pointer,
+//     or contains #c code, which might do anything (see Abstx_function_literal::side_effect)
+static bool generate_call_code(Shared<Global_scope> gs, const Run_entry& entry, std::ostream& code, Seq<Shared<const Abstx_identifier>>& unknown)
+{
+    // the call is generated again for the wave -> the used functions, globals and loops can be restored afterwards
+    std::map<uint64_t, Shared<const Abstx_function_literal>> used_functions;
+    std::map<const Abstx_identifier*, Shared<const Abstx_identifier>> used_globals;
+    Seq<Shared<const Abstx_for>> parallel_loops;
+    std::swap(used_functions, gs->used_functions);
+    std::swap(used_globals, gs->used_globals);
+    std::swap(parallel_loops, gs->parallel_loops);
+    int c_code = gs->generated_c_code;
+
+    Run_entry keyed = entry;
+    keyed.entry_point = "_cb_run"; // the unique id is different in each compilation
+    generate_entry_point(code, keyed);
+    code << gs->generate_used_globals(unknown); // also adds the functions used by the globals
+    gs->generate_functions(code, code);
+
+    std::swap(used_functions, gs->used_functions);
+    std::swap(used_globals, gs->used_globals);
+    std::swap(parallel_loops, gs->parallel_loops);
+
+    if (gs->generated_c_code != c_code) return false;
+    for (const auto& fn : used_functions) {
+        if (fn.second->side_effect) return false; // also covers function literals given as arguments
+    }
+    for (const auto& g : used_globals) {
+        if (!g.second->has_constant_value()) return false; // a variable
+    }
+    return true;
+}
+
+
+// returns true if all global variables used by the call are resolved
+// sets the call status to an error if one of them never will be
+static bool has_known_globals(Shared<Global_scope> gs, Run_entry& entry)
+{
+    Seq<Shared<const Abstx_identifier>> unknown;
+    std::ostringstream code;
+    entry.pure = generate_call_code(gs, entry, code, unknown);
+    entry.code = code.str();
+    for (const auto& id : unknown) {
+        Shared<const Statement> decl = dynamic_pointer_cast<const Statement>(id->owner);
+        if (decl == nullptr || !is_error(decl->status)) continue;
+        log_error("Global variable " + id->name + " used by #run statement has errors", entry.call->context);
+        add_note("Declared here", id->context);
+        entry.call->status = Parsing_status::COMPILE_TIME_ERROR;
+        return false;
+    }
+    return unknown.size == 0; // might be the result of another #run statement
+}
+
+
+// the #include lines of the generated program, without the rest of it
+// the entry points get new names in every compilation, so the whole program can't be part of the cache key
+static std::string get_includes(const std::string& program)
+{
+    std::istringstream lines{program};
+    std::ostringstream includes;
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, 8, "#include") == 0) includes << line << std::endl;
+    }
+    return includes.str();
+}
+
+
+// the key is a hash of the code of the call (see generate_call_code()) and the runtime of the wave
+// runtime_hash covers all type definitions, the runtime headers, the gcc command and the compiler build (see dll::hash_source())
+// returns 0 if the result can't be cached
+static uint64_t get_cache_key(const Run_entry& entry, uint64_t runtime_hash)
+{
+    if (!entry.pure) return 0;
+    for (const auto& arg : entry.call->out_args) {
+        if (!is_cacheable_type(arg->get_type())) return 0;
+    }
+    uint64_t key = hash_string(entry.code, runtime_hash);
+    return key ? key : 1;
+}
+
+
+int run_wave(Shared<Global_scope> gs)
+{
+    ASSERT(gs);
+
+    Seq<Run_entry> wave;
+    Seq<Shared<Abstx_function_call>> remaining;
+    for (const auto& call : gs->run_statements) {
+        Run_entry entry;
+        entry.call = call;
+        entry.entry_point = "_cb_run_" + std::to_string(get_unique_id());
+        if (is_ready(call) && has_known_globals(gs, entry)) {
+            wave.add(entry);
+        } else if (!is_error(call->status)) {
+            remaining.add(call);
+        } else {
+            gs->dependencies.completed(static_pointer_cast<Statement>(call)); // failed; nothing more will happen
+        }
+    }
+    if (wave.size == 0) return 0;
+
+    // the generated code includes the runtime headers in backend_c/ and compile_time/
+    std::string src_dir = runtime_src_dir();
+    if (src_dir.empty()) {
+        log_error("Unable to find the runtime headers needed to evaluate #run statements", wave[0].call->context);
+        add_note("Set the environment variable CB_SRC_DIR, or use the option --runtime-dir, to the Src directory of the compiler");
+        for (const auto& entry : wave) {
+            entry.call->status = Parsing_status::COMPILE_TIME_ERROR;
+            gs->dependencies.completed(static_pointer_cast<Statement>(entry.call));
+        }
+        gs->run_statements = std::move(remaining);
+        return 0;
+    }
+    dll::add_include_dir(src_dir + "backend_c"); // before the cache keys are computed, so that the headers are part of the keys
+    dll::add_include_dir(src_dir + "compile_time");
+
+    // generate entry points first; that fills in used_functions and used_globals
+    // the global variables used by the wave are declared before the entry points; all entries in the wave share them
+    std::ostringstream entry_points;
+    gs->used_globals.clear();
+    for (const auto& entry : wave) generate_entry_point(entry_points, entry);
+    Seq<Shared<const Abstx_identifier>> unknown;
+    std::string globals = gs->generate_used_globals(unknown); // also generates all used functions, which finds their async calls
+    ASSERT(unknown.size == 0); // checked for each entry by has_known_globals()
+    // the entry points are placed before the runtime headers -> cb_async.h is declared first
+    // if nothing in the wave uses the thread pool, it's not included and there is nothing to wait for
+    std::string async_wait = gs->uses_async_runtime() ? "void _cb_async_wait(void);\n" : "static void _cb_async_wait(void) {}\n";
+    std::ostringstream program;
+    gs->generate_program(globals + async_wait + entry_points.str(), program); // the same code as the compiled program, with the entry points instead of the statements
+
+    // all types are known at this point
+    std::ostringstream typedefs;
+    generate_typedefs(typedefs);
+    uint64_t runtime_hash = dll::hash_source(typedefs.str() + get_includes(program.str()));
+
+    // all results in the wave are stored in one frame, instead of allocating each of them separately
+    // the out arguments of each entry are stored next to each other, so that they can be cached together
+    size_t frame_size = 0;
+    size_t frame_alignment = 1;
+    Seq<size_t> offsets;
+    for (auto& entry : wave) {
+        entry.frame_offset = frame_size;
+        for (const auto& arg : entry.call->out_args) {
+            Shared<const CB_Type> type = arg->get_type();
+            size_t alignment = type->alignment();
+            frame_alignment = std::max(frame_alignment, alignment & (~alignment + 1)); // the largest power of two that divides it
+            offsets.add(aligned_offset(frame_size, type));
+            frame_size = offsets[offsets.size-1] + type->cb_sizeof();
+        }
+        entry.frame_size = frame_size - entry.frame_offset;
+    }
+    uint8_t* frame = nullptr;
+    if (frame_size > 0) {
+        // new[] only aligns to max_align_t, but vector types need more -> allocate extra space and round the start up
+        // c alignments are powers of two that divide alignment() -> every value is aligned if the frame is aligned to the largest one
+        run_frames.emplace_back(new uint8_t[frame_size + frame_alignment - 1]());
+        uintptr_t start = (uintptr_t)run_frames.back().get();
+        frame = (uint8_t*)((start + frame_alignment - 1) / frame_alignment * frame_alignment);
+    }
+
+    // pure statements that were evaluated in an earlier compilation are read from the cache instead
+    int out_index = 0;
+    uint32_t cached = 0;
+    for (auto& entry : wave) {
+        for (const auto& arg : entry.call->out_args) {
+            Shared<const CB_Type> type = arg->get_type();
+            uint8_t* out = frame + offsets[out_index++];
+            const Any& default_value = type->default_value();
+            if (default_value.v_ptr) memcpy(out, default_value.v_ptr, type->cb_sizeof());
+            entry.out.add(out);
+        }
+        entry.cache_key = get_cache_key(entry, runtime_hash);
+        entry.cached = entry.cache_key && read_run_result(entry.cache_key, frame + entry.frame_offset, entry.frame_size);
+        if (entry.cached) cached++;
+    }
+
+    if (cached < wave.size) {
+        LOG("compiling #run wave with " << wave.size - cached << " statements (" << cached << " cached)");
+        dll::dll_handle dll = dll::compile_dll({dll::create_src({"stdint.h", "stdbool.h"}, {program.str()})});
+        dll::remove_temp_files(); // the source is only needed by gcc; the dll is kept in the cache
+        if (dll == nullptr) {
+            for (const auto& entry : wave) {
+                if (entry.cached) continue;
+                log_error("Unable to compile #run statement", entry.call->context);
+                entry.call->status = Parsing_status::COMPILE_TIME_ERROR;
+                gs->dependencies.completed(static_pointer_cast<Statement>(entry.call));
+            }
+        } else {
+            run_dlls.push_back(dll);
+
+            // dispatch all calls through the same dll
+            // everything that touches the abstx is done here, on the main thread; the workers only call the entry points
+            for (auto& entry : wave) {
+                if (entry.cached) continue;
+                entry.fn = dll::load_fn<void(*)(void**)>(dll, entry.entry_point);
+                ASSERT(entry.fn, "missing entry point " << entry.entry_point);
+            }
+
+            // pure statements are run in parallel (see execute_entries())
+            execute_entries(wave);
+        }
+    } else {
+        LOG("all " << cached << " #run statements in the wave are cached");
+    }
+
+    int evaluated = 0;
+    for (const auto& entry : wave) {
+        if (!entry.cached && entry.fn == nullptr) continue; // failed to compile
+        if (!entry.cached && entry.cache_key) write_run_result(entry.cache_key, frame + entry.frame_offset, entry.frame_size);
+        for (uint32_t i = 0; i < entry.call->out_args.size; ++i) {
+            Shared<Abstx_identifier> id = dynamic_pointer_cast<Abstx_identifier>(entry.call->out_args[i]);
+            id->value.v_ptr = entry.out[i];
+        }
+        gs->dependencies.completed(static_pointer_cast<Statement>(entry.call)); // queues everything that was waiting for the result
+        evaluated++;
+    }
+
+    gs->run_statements = std::move(remaining);
+    return evaluated;
+}
+
+
+Parsing_status run_all_waves(Shared<Global_scope> gs)
+{
+    ASSERT(gs);
+    Parsing_status status = Parsing_status::FULLY_RESOLVED;
+
+    while (gs->run_statements.size > 0) {
+        // the called functions have to be parsed before they can be generated
+        // (functions referenced by name are already reached; function literals given as arguments are not)
+        for (const auto& call : gs->run_statements) {
+            if (!is_codegen_ready(call->status)) continue;
+            for (const auto& arg : call->in_args) {
+                if (arg->has_constant_value()) gs->reach(arg->get_constant_value());
+            }
+        }
+        Parsing_status fn_status = gs->parse_reached_functions();
+        if (is_error(fn_status)) {
+            status = fn_status;
+            break;
+        }
+        if (run_wave(gs) == 0) break; // nothing new is known -> no point in trying again
+        // only statements waiting for the evaluated #run statements are parsed again
+        // cycles can't be found before everything else is done, and looking for them visits every waiting statement
+        Parsing_status dep_status = gs->dependencies.resolve(false);
+        if (is_error(dep_status)) status = dep_status;
+    }
+
+    // nothing more can be evaluated -> anything that is still waiting is part of a cycle, or waiting for something that failed
+    Parsing_status dep_status = gs->dependencies.resolve(true);
+    if (is_error(dep_status)) status = dep_status;
+
+    for (const auto& rs : gs->run_statements) {
+        if (is_error(rs->status)) continue; // already reported, e.g. as part of a cycle
+        log_error("Unable to resolve #run statement", rs->context);
+        rs->status = Parsing_status::COMPILE_TIME_ERROR;
+        status = rs->status;
+    }
+    gs->run_statements.clear();
+    return status;
+}
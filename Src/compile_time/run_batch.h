@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../abstx/abstx_scope.h"
+#include "../abstx/statements/abstx_function_call.h"
+
+/*
+Evaluation of #run statements.
+
+Compiling a dll means starting gcc, which is slow compared to everything else the compiler does.
+Instead of compiling each #run statement on its own, all #run statements that are ready to be
+    evaluated are collected into a wave and compiled together into one dll.
+
+A #run statement is ready when its function call is fully resolved and all its in arguments
+    have constant values, and all global variables it uses are resolved. The used global variables are declared in the dll,
+    with their compile time values; all statements in a wave share them. Each statement in a wave gets its own exported entry point:
+
+    void _cb_run_<uid>(void** _cb_out);
+
+where _cb_out holds one pointer per out argument. The results of all statements in a wave are stored in one frame,
+    at offsets aligned for their types, and are used as constant values of the out argument identifiers.
+    This might in turn make more #run statements ready.
+Results of pure statements are cached between compilations (see run_cache.h); cached statements are never executed,
+    and if the whole wave is cached, no dll is compiled.
+A new wave is only needed if the previous wave unblocked something.
+
+Example:
+    foo :: fn(a: int)->(r: int) { ... };
+    bar :: fn(a: int)->(r: int, s: int) { ... };
+    #run foo(2);
+    #run bar(2);
+generates C code:
+    int64_t foo_12(int64_t a) { ... } // a single out argument is returned
+    void bar_13(int64_t a, int64_t* r, int64_t* s) { ... }
+    void _cb_run_14(void** _cb_out) {
+        int64_t _cb_arg_0 = 2;
+        *(int64_t*)_cb_out[0] = foo_12(_cb_arg_0);
+        _cb_async_wait();
+    }
+    void _cb_run_15(void** _cb_out) {
+        int64_t _cb_arg_0 = 2;
+        bar_13(_cb_arg_0, (int64_t*)_cb_out[0], (int64_t*)_cb_out[1]);
+        _cb_async_wait();
+    }
+*/
+
+// The #run statements in a wave don't depend on each other's results, but they share the global variables of the dll.
+// Pure statements (see run_cache.h) are executed in parallel on a pool of worker threads that is kept between waves.
+//     The rest are executed one at the time, in order.
+// n = 0 (default) uses one thread per hardware thread, n = 1 executes everything on the calling thread.
+void set_run_thread_count(unsigned n);
+
+// The Src directory of the compiler, where the runtime headers used by the dll are found (backend_c/ and compile_time/).
+// If not set, the environment variable CB_SRC_DIR is used, then the directory of the executable.
+// If the headers can't be found, #run statements fail with an error.
+void set_runtime_dir(const std::string& dir);
+
+// Evaluates all #run statements in the global scope that are ready to be evaluated, in one single dll.
+// Evaluated statements and statements with errors are removed from gs->run_statements.
+// Returns the number of evaluated statements.
+int run_wave(Shared<Global_scope> gs);
+
+// Runs waves until all #run statements are evaluated, or until no more progress can be made.
+// After each wave, statements in the global scope that failed with DEPENDENCIES_NEEDED are parsed again.
+// Logs an error for each #run statement that could not be evaluated.
+Parsing_status run_all_waves(Shared<Global_scope> gs);
@@ -0,0 +1,98 @@
+#include "run_cache.h"
+#include "constant_folding.h" // is_foldable_type()
+#include "../types/all_cb_types.h"
+#include "../runtime_dll/dll.h"
+#include "../utilities/hash.h"
+
+#include <cstring> // memcmp, memcpy
+#include <cstdio> // rename, remove
+#include <fstream>
+#include <vector>
+
+
+namespace {
+
+const char RUN_RESULT_MAGIC[4] = { 'C', 'B', 'R', '\0' };
+const uint32_t RUN_RESULT_VERSION = 1; // increment when the layout or the calling convention changes
+
+struct Run_result_header {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t size;
+};
+
+} // namespace
+
+
+bool is_cacheable_type(Shared<const CB_Type> type)
+{
+    if (type == nullptr) return false;
+    if (is_foldable_type(type) || *type == *CB_Flag::type) return true;
+    if (auto vt = dynamic_pointer_cast<const CB_Vector>(type)) return is_cacheable_type(vt->lane_type());
+    if (auto st = dynamic_pointer_cast<const CB_Struct>(type)) {
+        for (const auto& member : st->members) {
+            if (!is_cacheable_type(member.id->get_type())) return false;
+        }
+        return true;
+    }
+    return false; // pointers, sequences, strings, functions, ...
+}
+
+
+std::string run_result_file_name(uint64_t key)
+{
+    return dll::get_cache_dir() + "/_cb_run_" + hash_to_string(key) + ".cbr";
+}
+
+
+bool read_run_result(uint64_t key, uint8_t* data, size_t size)
+{
+    std::ifstream ifs{run_result_file_name(key), std::ios::binary};
+    if (!ifs.is_open()) return false;
+
+    Run_result_header header;
+    if (!ifs.read((char*)&header, sizeof(header))) return false;
+    if (memcmp(header.magic, RUN_RESULT_MAGIC, sizeof(RUN_RESULT_MAGIC)) != 0
+        || header.version != RUN_RESULT_VERSION
+        || header.key != key
+        || header.size != size) {
+        return false;
+    }
+
+    // read everything before touching data, so that a truncated file doesn't leave a half-written result
+    std::vector<uint8_t> result(size);
+    if (size > 0 && !ifs.read((char*)result.data(), size)) return false;
+    if (ifs.peek() != std::ifstream::traits_type::eof()) return false; // not written by this version
+    if (size > 0) memcpy(data, result.data(), size);
+    return true;
+}
+
+
+void write_run_result(uint64_t key, const uint8_t* data, size_t size)
+{
+    Run_result_header header;
+    memcpy(header.magic, RUN_RESULT_MAGIC, sizeof(RUN_RESULT_MAGIC));
+    header.version = RUN_RESULT_VERSION;
+    header.key = key;
+    header.size = size;
+
+    // write to a temp file first, then move it into place
+    // that way, other compiler instances never read a half-written result
+    std::string file_name = run_result_file_name(key);
+    std::string tmp_file_name = file_name + ".tmp";
+    dll::create_cache_dir();
+    {
+        std::ofstream ofs{tmp_file_name, std::ios::binary};
+        if (!ofs.is_open()) return;
+        ofs.write((const char*)&header, sizeof(header));
+        ofs.write((const char*)data, size);
+        if (!ofs.good()) {
+            ofs.close();
+            std::remove(tmp_file_name.c_str());
+            return;
+        }
+    }
+    std::remove(file_name.c_str()); // rename doesn't overwrite on windows
+    std::rename(tmp_file_name.c_str(), file_name.c_str());
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../types/cb_type.h"
+
+#include <string>
+#include <stdint.h>
+
+/*
+Persistent cache for the results of #run statements.
+
+Most #run statements are pure: the result only depends on the called functions and the arguments.
+    The results of those are stored in the dll cache directory (see dll::get_cache_dir()), and are read
+    back in later compiler invocations instead of executing the statement again.
+
+The cache key is a hash of the generated code for the call (with the arguments as literals), the generated code
+    of all functions that it might call, all type definitions, the included runtime headers, the gcc command and
+    the build of the compiler (see dll::hash_source()). Any change in any of those gives a new key.
+A statement is not cached if it isn't pure: if the called functions read or write global variables, write through pointers,
+    or contain #c code, since that might do anything (file access, printing, ...). The value of a global variable
+    depends on the other statements that changed it before, which the key doesn't cover.
+    Results that contain pointers are not cached either, since they are only valid within one compiler invocation.
+
+Layout of a result file _cb_run_<key>.cbr (native byte order):
+
+    Run_result_header           magic "CBR", version, the key and the size of the result
+    uint8_t[size]               the out arguments of the call, laid out as in the frame of the #run wave (see run_batch.h)
+*/
+
+// numbers, bools, and vectors and structs of them: types that can be stored as raw bytes
+bool is_cacheable_type(Shared<const CB_Type> type);
+
+std::string run_result_file_name(uint64_t key);
+
+// returns true if a result with the given key and size is cached. Otherwise, data is not changed.
+bool read_run_result(uint64_t key, uint8_t* data, size_t size);
+
+// the cache is only a cache -> failing to write it is not an error
+void write_run_result(uint64_t key, const uint8_t* data, size_t size);
@@ -29,7 +29,7 @@ typedef double _cb_float;
 typedef uint8_t _cb_flag;
 typedef struct { _cb_i64 r_start; _cb_i64 r_end; } _cb_i_range;
 typedef struct { _cb_f64 r_start; _cb_f64 r_end; } _cb_f_range;
-typedef char* _cb_string;
+#include "backend_c/cb_string.h" // _cb_string
 
 // complex types
 typedef void(*_cb_type_22)(_cb_int, _cb_int*);
@@ -1,5 +1,6 @@
 #include "lexer.h"
 #include "../parser/token.h"
+#include "../parser/operator_table.h"
 #include "../utilities/error_handler.h"
 #include "../utilities/assert.h"
 #include <regex>
@@ -56,11 +57,11 @@ std::regex compiler_rx(R"(^(\#[a-zA-Z]\w*[\?\!]*)\s*)"); // same as identifier b
 std::regex comment_start_rx(R"(^\s*(\/\/|\/\*|\*\/)\s*)");
 std::regex comment_end_rx(R"(^.*?(\/\/|\/\*|\*\/)\s*)");
 
-std::regex symbol_rx(R"(^(\*|\/|\+|\%|==|<=|>=|<|>|!=|=|:|\_|\(|\)|\[|\]|\{|\}|\;|\,|\.\.\.|\.\.|\.|\->|\-|\$|\?|\!|\&|\#|\')\s*)"); // Pseudo-sorted, long symbols should be first in the rx (e.g. '..' must be before '.')
+std::regex symbol_rx(R"(^(\*|\/|\+|\%|==|<=|>=|<\-|<|>|!=|=|:|\_|\(|\)|\[|\]|\{|\}|\;|\,|\.\.\.|\.\.|\.|\->|\-|\$|\?|\!|\&\&|\|\||\&|\#|\')\s*)"); // Pseudo-sorted, long symbols should be first in the rx (e.g. '..' must be before '.')
 
 // booleans and keywords are subsets of identifiers.
 std::regex bool_rx(R"(^(true|false)$)");
-std::regex keyword_rx(R"(^(for|in|by|if|elsif|else|then|while|fn|return|cast|struct|defer|inline|operator|using)$)");
+std::regex keyword_rx(R"(^(for|in|by|if|elsif|else|then|while|fn|return|cast|struct|defer|inline|operator|using|async|chan)$)");
 // Additional possible keywords: implicit_cast, const
 
 std::regex string_start_rx(R"(^\")");
@@ -91,6 +92,7 @@ bool try_match(std::string& str, Token& t, Seq<Token>& tokens, const std::regex&
         t.token = match[capture_group];
         t.type = type;
         if (t.type == Token_type::COMPILER_COMMAND) std::transform(t.token.begin(), t.token.end(), t.token.begin(), ::tolower);
+        t.symbol = t.type == Token_type::SYMBOL ? intern_symbol(t.token) : 0;
         str = match.suffix();
         tokens.add(t);
         t.context.position += match.length();
@@ -211,6 +213,7 @@ Seq<Token> read_tokens(std::istream& input, Token_context initial_context)
                             sb << std::endl << match[1];
                             t.token = sb.str();
                             t.type = Token_type::STRING;
+                            t.symbol = 0;
                             tokens.add(t); // this still has the old context
                             new_context.position = 1 + match.length();
                             t.context = new_context; // update to the new context
@@ -247,6 +250,7 @@ Seq<Token> read_tokens(std::istream& input, Token_context initial_context)
             } else {
                 t.type = Token_type::IDENTIFIER;
             }
+            t.symbol = t.type == Token_type::BOOL ? 0 : intern_symbol(t.token);
             tokens.add(t);
             t.context.position += match.length();
             current_line = match.suffix();
@@ -381,8 +385,8 @@ void rx_test_suite()
         "here string test", 2);
 
     rx_test(symbol_rx,
-        "*/+-%==<><=>=!==:_()[]{};,...->$?!&#",
-        {"*", "/", "+", "-", "%", "==", "<", ">", "<=", ">=", "!=", "=", ":", "_", "(", ")", "[", "]", "{", "}", ";", ",", "...", "->", "$", "?", "!", "&", "#"},
+        "*/+-%==<><=>=!==:_()[]{};,...->$?!&#<-",
+        {"*", "/", "+", "-", "%", "==", "<", ">", "<=", ">=", "!=", "=", ":", "_", "(", ")", "[", "]", "{", "}", ";", ",", "...", "->", "$", "?", "!", "&", "#", "<-"},
         "symbol test");
 
     rx_test(compiler_rx,
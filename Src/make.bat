@@ -2,8 +2,9 @@
 
 :: static include paths makes the code nicer, but is not worth it because it makes the program compile 50-100% slower
 :: set INCLUDE_PATHS=-Iutilities -Itypes
-set PARSER_SRCS=parser/parser.cpp parser/statement_parser.cpp parser/expression_parser.cpp
-set SRC_FILES=*.cpp lexer/*.cpp utilities/*.cpp types/*.cpp runtime_dll/*.cpp abstx/*.cpp %PARSER_SRCS%
+set PARSER_SRCS=parser/parser.cpp parser/statement_parser.cpp parser/expression_parser.cpp parser/dependency_graph.cpp parser/operator_table.cpp parser/token_cache.cpp
+set COMPILE_TIME_SRCS=compile_time/run_batch.cpp compile_time/constant_folding.cpp compile_time/run_cache.cpp
+set SRC_FILES=*.cpp lexer/*.cpp utilities/*.cpp types/*.cpp runtime_dll/*.cpp abstx/*.cpp compile_server/*.cpp %PARSER_SRCS% %COMPILE_TIME_SRCS%
 :: parser/*.cpp code_gen/*.cpp
 set LIBS32=runtime_dll/dyncall/lib32/libdyncall_s.lib
 set LIBS64=runtime_dll/dyncall/lib64/libdyncall_s.lib
@@ -0,0 +1,16 @@
+#!/bin/sh
+
+# Linux version of make.bat
+# static include paths makes the code nicer, but is not worth it because it makes the program compile 50-100% slower
+# INCLUDE_PATHS="-Iutilities -Itypes"
+PARSER_SRCS="parser/parser.cpp parser/statement_parser.cpp parser/expression_parser.cpp parser/dependency_graph.cpp parser/operator_table.cpp parser/token_cache.cpp"
+COMPILE_TIME_SRCS="compile_time/run_batch.cpp compile_time/constant_folding.cpp compile_time/run_cache.cpp"
+SRC_FILES="*.cpp lexer/*.cpp utilities/*.cpp types/*.cpp runtime_dll/*.cpp abstx/*.cpp compile_server/*.cpp $PARSER_SRCS $COMPILE_TIME_SRCS"
+# the dyncall libraries in runtime_dll/dyncall are built for Windows -> compile without call_fn_dyncall() (see runtime_dll/dll.h)
+FLAGS="-DDLL_NO_DYNCALL"
+LIBS="-ldl -lpthread"
+OUTPUT_NAME=cube
+
+cd "$(dirname "$0")"
+echo "Compiling $OUTPUT_NAME..."
+g++ -std=gnu++14 $FLAGS $INCLUDE_PATHS $SRC_FILES $LIBS -o $OUTPUT_NAME
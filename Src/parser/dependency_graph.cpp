@@ -0,0 +1,235 @@
+#include "dependency_graph.h"
+#include "../utilities/error_handler.h"
+
+
+// graphs that are currently resolving statements (innermost last)
+// resolve_dependency() uses the innermost one
+static Seq<Dependency_graph*> active_graphs;
+
+Parsing_status resolve_dependency(Shared<Statement> dependency)
+{
+    ASSERT(dependency);
+    if (active_graphs.size > 0) return active_graphs[active_graphs.size-1]->require(dependency);
+    return dependency->fully_parse();
+}
+
+
+
+uint32_t Dependency_graph::get_node(Shared<Statement> statement)
+{
+    ASSERT(statement);
+    auto it = node_index.find(statement.v);
+    if (it != node_index.end()) return it->second;
+
+    uint32_t index = nodes.size;
+    Node node;
+    node.statement = statement;
+    nodes.add(std::move(node));
+    node_index[statement.v] = index;
+    n_waiting++;
+    if (is_error(statement->status)) set_state(index, Node_state::DONE); // nothing more to do
+    check_error(index);
+    return index;
+}
+
+void Dependency_graph::set_state(uint32_t index, Node_state state)
+{
+    if (nodes[index].state == Node_state::WAITING) n_waiting--;
+    if (state == Node_state::WAITING) n_waiting++;
+    nodes[index].state = state;
+}
+
+void Dependency_graph::check_error(uint32_t index)
+{
+    Parsing_status status = nodes[index].statement->status;
+    if (is_error(status) && !is_error(first_error)) first_error = status;
+}
+
+void Dependency_graph::add_node(Shared<Statement> statement, bool external_completion)
+{
+    uint32_t index = get_node(statement);
+    if (external_completion) nodes[index].external_completion = true; // the statement might be added again by its scope
+    if (nodes[index].state == Node_state::WAITING && nodes[index].n_unresolved == 0) {
+        set_state(index, Node_state::QUEUED);
+        ready.push_back(index);
+    }
+}
+
+bool Dependency_graph::is_done(Shared<Statement> statement) const
+{
+    auto it = node_index.find(statement.v);
+    return it != node_index.end() && nodes[it->second].state == Node_state::DONE;
+}
+
+
+void Dependency_graph::mark_done(uint32_t index)
+{
+    set_state(index, Node_state::DONE);
+    check_error(index);
+    n_completed++;
+    for (uint32_t dependent : nodes[index].dependents) {
+        ASSERT(nodes[dependent].n_unresolved > 0);
+        if (--nodes[dependent].n_unresolved == 0 && nodes[dependent].state == Node_state::WAITING) {
+            set_state(dependent, Node_state::QUEUED);
+            ready.push_back(dependent);
+        }
+    }
+}
+
+void Dependency_graph::completed(Shared<Statement> statement)
+{
+    uint32_t index = get_node(statement);
+    if (nodes[index].state != Node_state::DONE) mark_done(index);
+    check_error(index); // the evaluator might have failed
+}
+
+
+void Dependency_graph::run_node(uint32_t index)
+{
+    Shared<Statement> statement = nodes[index].statement;
+    set_state(index, Node_state::IN_PROGRESS);
+    stack.add(index);
+    uint64_t n_completed_before = n_completed;
+
+    // restart statements that gave up earlier
+    if (statement->status == Parsing_status::DEPENDENCIES_NEEDED) statement->status = Parsing_status::PARTIALLY_PARSED;
+    Parsing_status status = statement->fully_parse();
+
+    stack.remove_last();
+    if (status == Parsing_status::DEPENDENCIES_NEEDED) {
+        set_state(index, Node_state::WAITING);
+        if (nodes[index].n_unresolved == 0 && n_completed != n_completed_before) {
+            // the dependency that blocked us might have completed while we were still parsing -> try again
+            // if nothing completed, it's waiting for something outside the graph
+            set_state(index, Node_state::QUEUED);
+            ready.push_back(index);
+        }
+    } else if (nodes[index].external_completion && !is_error(status)) {
+        set_state(index, Node_state::PARSED); // not done until completed() is called
+    } else {
+        mark_done(index);
+    }
+}
+
+
+Parsing_status Dependency_graph::require(Shared<Statement> dependency)
+{
+    uint32_t index = get_node(dependency);
+    if (nodes[index].state == Node_state::WAITING || nodes[index].state == Node_state::QUEUED) {
+        // not started yet -> resolve it now
+        // if it was queued it will just be skipped when it's popped from the ready queue
+        run_node(index);
+    }
+    if (nodes[index].state == Node_state::DONE) return dependency->status;
+
+    // still not done -> whoever asked has to wait
+    if (stack.size > 0) {
+        uint32_t current = stack[stack.size-1];
+        for (uint32_t dep : nodes[current].dependencies) {
+            if (dep == index) return Parsing_status::DEPENDENCIES_NEEDED; // already waiting
+        }
+        nodes[current].dependencies.add(index);
+        nodes[index].dependents.add(current);
+        nodes[current].n_unresolved++;
+    }
+    return Parsing_status::DEPENDENCIES_NEEDED;
+}
+
+
+Parsing_status Dependency_graph::resolve(bool report)
+{
+    active_graphs.add(this);
+    while (!ready.empty()) {
+        uint32_t index = ready.front();
+        ready.pop_front();
+        if (nodes[index].state != Node_state::QUEUED) continue; // already resolved through require()
+        run_node(index);
+    }
+    active_graphs.remove_last();
+
+    if (report && n_waiting > 0) report_cycles();
+
+    if (is_error(first_error)) return first_error;
+    return n_waiting > 0 ? Parsing_status::DEPENDENCIES_NEEDED : Parsing_status::FULLY_RESOLVED;
+}
+
+
+// Tarjan's strongly connected components, restricted to nodes that are still waiting
+// iterative, since #run chains can be long
+void Dependency_graph::report_cycles()
+{
+    const uint32_t UNVISITED = (uint32_t)-1;
+    Seq<uint32_t> order;
+    Seq<uint32_t> low;
+    Seq<bool> on_stack;
+    order.resize(nodes.size, true, UNVISITED);
+    low.resize(nodes.size, true, 0);
+    on_stack.resize(nodes.size, true, false);
+
+    Seq<uint32_t> scc_stack;
+    Seq<std::pair<uint32_t, uint32_t>> call_stack; // node, next dependency to visit
+    uint32_t counter = 0;
+    Seq<uint32_t> failed;
+
+    auto waiting = [&](uint32_t i) { return nodes[i].state == Node_state::WAITING; };
+
+    for (uint32_t root = 0; root < nodes.size; ++root) {
+        if (!waiting(root) || order[root] != UNVISITED) continue;
+        call_stack.add({root, 0});
+        order[root] = low[root] = counter++;
+        scc_stack.add(root);
+        on_stack[root] = true;
+
+        while (call_stack.size > 0) {
+            auto& frame = call_stack[call_stack.size-1];
+            uint32_t v = frame.first;
+            if (frame.second < nodes[v].dependencies.size) {
+                uint32_t w = nodes[v].dependencies[frame.second++];
+                if (!waiting(w)) continue;
+                if (order[w] == UNVISITED) {
+                    order[w] = low[w] = counter++;
+                    scc_stack.add(w);
+                    on_stack[w] = true;
+                    call_stack.add({w, 0});
+                } else if (on_stack[w] && order[w] < low[v]) {
+                    low[v] = order[w];
+                }
+                continue;
+            }
+
+            // all dependencies visited
+            call_stack.remove_last();
+            if (call_stack.size > 0) {
+                uint32_t parent = call_stack[call_stack.size-1].first;
+                if (low[v] < low[parent]) low[parent] = low[v];
+            }
+            if (low[v] != order[v]) continue;
+
+            // v is the root of a strongly connected component
+            Seq<uint32_t> scc;
+            uint32_t w;
+            do {
+                w = scc_stack[scc_stack.size-1];
+                scc_stack.remove_last();
+                on_stack[w] = false;
+                scc.add(w);
+            } while (w != v);
+
+            bool self_loop = false;
+            for (uint32_t dep : nodes[v].dependencies) if (dep == v) self_loop = true;
+            if (scc.size == 1 && !self_loop) continue;
+
+            log_error("Cyclic dependency", nodes[v].statement->context);
+            for (uint32_t i : scc) {
+                add_note("Part of the cycle: " + nodes[i].statement->toS(), nodes[i].statement->context);
+                nodes[i].statement->status = Parsing_status::CYCLIC_DEPENDENCY;
+                failed.add(i);
+            }
+        }
+    }
+
+    // the statements in the cycles are done (with errors) -> everything waiting for them is released
+    // they will fail on their own, with a more specific error message if needed
+    for (uint32_t i : failed) mark_done(i);
+    if (failed.size > 0) resolve(false);
+}
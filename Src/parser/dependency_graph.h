@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../abstx/statements/abstx_statement.h"
+#include "../utilities/sequence.h"
+#include "../utilities/pointers.h"
+
+#include <map>
+#include <deque>
+
+/*
+Dependency graph for statements in static scopes (declarations, using statements and #run statements).
+
+Static scopes can declare identifiers in any order, so a statement might need another statement to be
+    resolved before it can be resolved itself. Each statement is a node in the graph, and an edge
+    A -> B means that A is waiting for B.
+
+Edges are added while parsing: when a statement needs another statement (for example when an identifier
+    needs the type from its declaration), it calls resolve_dependency(). If the dependency hasn't been
+    started yet, it is resolved immediately (depth first). If it can't be resolved right now, the edge is
+    kept and the waiting statement is put back on the ready queue when the dependency is done.
+Statements are never re-parsed by rescanning the scope; only when one of its dependencies completes.
+
+A statement that returns DEPENDENCIES_NEEDED will be parsed again from start_token_index, so fully_parse()
+    must be able to restart.
+
+#run statements are done when they have been evaluated, not when they have been parsed.
+    The #run evaluator calls completed() when the result is known.
+
+Anything left when the ready queue is empty is either part of a cycle, waiting for a cycle, or waiting
+    for something outside of the graph (such as a #run statement that isn't evaluated yet). Cycles are found with
+    Tarjan's algorithm (linear time) and are reported as CYCLIC_DEPENDENCY. That is only done when nothing else can
+    make progress, since it has to visit every waiting node; resolving the ready queue only costs the nodes in it.
+*/
+
+struct Dependency_graph
+{
+    // external_completion is sticky: adding a node again without it doesn't clear it
+    void add_node(Shared<Statement> statement, bool external_completion = false);
+
+    // Resolves all nodes that are ready, until the ready queue is empty.
+    // Reports cycles if report_cycles is true; that should only be done when nothing else can make progress.
+    // Returns the first error found, or DEPENDENCIES_NEEDED if some nodes are still waiting.
+    Parsing_status resolve(bool report_cycles = true);
+
+    // Requires dependency to be resolved before the statement currently being resolved.
+    // Returns the status of the dependency.
+    Parsing_status require(Shared<Statement> dependency);
+
+    // Marks a node with external_completion as done, and queues everything that was waiting for it.
+    void completed(Shared<Statement> statement);
+
+    bool is_done(Shared<Statement> statement) const;
+
+private:
+    enum struct Node_state : uint8_t { WAITING, QUEUED, IN_PROGRESS, PARSED, DONE };
+
+    struct Node
+    {
+        Shared<Statement> statement;
+        Seq<uint32_t> dependencies; // nodes that this node is waiting for
+        Seq<uint32_t> dependents; // nodes that are waiting for this node
+        uint32_t n_unresolved = 0; // number of dependencies that are not done
+        Node_state state = Node_state::WAITING;
+        bool external_completion = false;
+    };
+
+    Seq<Node> nodes;
+    std::map<const Statement*, uint32_t> node_index;
+    std::deque<uint32_t> ready;
+    Seq<uint32_t> stack; // nodes currently being resolved (innermost last)
+    uint64_t n_completed = 0; // number of nodes marked as done so far
+    uint32_t n_waiting = 0; // number of nodes in the WAITING state
+    Parsing_status first_error = Parsing_status::FULLY_RESOLVED;
+
+    uint32_t get_node(Shared<Statement> statement);
+    void set_state(uint32_t index, Node_state state); // keeps n_waiting up to date
+    void check_error(uint32_t index);
+    void run_node(uint32_t index);
+    void mark_done(uint32_t index);
+    void report_cycles();
+};
+
+
+// Resolves the dependency through the dependency graph that is currently resolving statements, if any.
+// Otherwise, the dependency is just parsed directly.
+Parsing_status resolve_dependency(Shared<Statement> dependency);
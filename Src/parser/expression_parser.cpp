@@ -1,4 +1,5 @@
 #include "parser.h"
+#include "operator_table.h"
 #include "../abstx/abstx_scope.h"
 #include "../abstx/expressions/value_expression.h"
 #include "../abstx/expressions/variable_expression.h"
@@ -9,6 +10,13 @@
 #include "../abstx/expressions/abstx_struct_getter.h"
 #include "../abstx/expressions/abstx_simple_literal.h"
 #include "../abstx/expressions/abstx_struct_literal.h"
+#include "../abstx/expressions/abstx_channel.h"
+#include "../abstx/expressions/abstx_map.h"
+#include "../abstx/expressions/abstx_sequence_literal.h"
+#include "../abstx/expressions/abstx_infix_operator.h"
+#include "../abstx/expressions/abstx_prefix_operator.h"
+#include "../abstx/expressions/abstx_vector.h"
+#include "../abstx/expressions/abstx_seq_index.h"
 
 #include "../abstx/statements/abstx_function_call.h"
 #include "../abstx/statements/abstx_declaration.h"
@@ -17,6 +25,8 @@
 #include "../utilities/pointers.h"
 
 #include "../types/all_cb_types.h"
+
+#include <set>
 // #include "../compile_time/compile_time.h"
 
 
@@ -33,30 +43,38 @@
 
 
 
-// Part 1:
-// if token is '(' read value expression with reset operator prio
-// else if token is '[' read Seq literal
+// Expressions are read with a Pratt parser, which dispatches on the operator table (see operator_table.h).
+// Each token is looked up once, by its interned symbol.
+
+// Part 1: prefix operators and operands
+// '(' read value expression with reset operator prio, then expect ')'
+// '[' read Seq literal
+// '<-', fn, struct, chan: read the corresponding expression
+// other prefix operators: read value expression (with min_prio = op.prio), then construct prefix operator node
 // else if token is integer, float, bool or string literal, construct appropriate literal node
-// else if token is symbol or identifier, check if it's a prefix operator
-//      if it is, read value expression (with min_prio = op.prio), then construct prefix operator node
 // else if token is identifier, check if the identifier exists. If not, log error undeclared variable
 // if none of those applies, log error unexpected token
 
-// Part 2: suffix operators:
+// Part 2: suffix and infix operators
 // '(' function operator
 // '[' indexing operator
 // '.' getter operator
-// other identifier or symbol token: check if it's an infix operator with prio > min_prio
-//      if it is, read value expression (with min_prio = op.prio), then construct infix operator node
+// infix operator with prio > min_prio (or == min_prio if right associative):
+//      read value expression (with min_prio = op.prio), then construct infix operator node
+// anything else ends the expression
 
 // If unable to read expression, nullpointer is returned
+static Owned<Value_expression> read_operators(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& expr, int min_operator_prio);
+
 Owned<Value_expression> read_value_expression(Token_iterator& it, Shared<Abstx_node> owner, int min_operator_prio)
 {
     Owned<Value_expression> expr = nullptr;
 
     ASSERT(!it->is_eof()); // this should have already been checked before
 
-    if (it->type == Token_type::SYMBOL && it->token == "(") {
+    const Operator_entry& prefix = get_operator(it->symbol).prefix;
+    switch (prefix.parser) {
+    case Operator_parser::PAREN: {
         // eat the token, then read new value expression, then expect closing paren
         it.eat_token();
         expr = read_value_expression(it, owner);
@@ -65,31 +83,26 @@ Owned<Value_expression> read_value_expression(Token_iterator& it, Shared<Abstx_n
             add_note("In paren enclosed value expression that started here", expr->context);
             expr->status = Parsing_status::FATAL_ERROR; // mismatched parens -> fatal error
         }
+        break;
+    }
+    case Operator_parser::SEQUENCE_LITERAL: expr = read_sequence_literal(it, owner); break;
+    case Operator_parser::FN_LITERAL: expr = read_fn_literal(it, owner); break;
+    case Operator_parser::STRUCT_LITERAL: expr = read_struct_literal(it, owner); break;
+    case Operator_parser::CHANNEL_LITERAL: expr = read_channel_literal(it, owner); break;
+    case Operator_parser::CHANNEL_RECEIVE: expr = read_channel_receive(it, owner); break;
+    case Operator_parser::BUILT_IN_PREFIX: expr = read_prefix_operator(it, owner, prefix.prio); break;
 
-    } else if (it->type == Token_type::SYMBOL && it->token == "[") {
-        expr = read_sequence_literal(it, owner);
-
-    } else if (it->type == Token_type::KEYWORD && it->token == "fn") {
-        expr = read_fn_literal(it, owner);
-
-    } else if (it->type == Token_type::KEYWORD && it->token == "struct") {
-        expr = read_struct_literal(it, owner);
-
-    } else if (it->type == Token_type::INTEGER || it->type == Token_type::FLOAT || it->type == Token_type::STRING || it->type == Token_type::BOOL) {
-        expr = read_simple_literal(it, owner);
-
-    } else if (it->type == Token_type::IDENTIFIER) {
-        expr = read_identifier_reference(it, owner);
-
-        // This can be either a variable identifier or an infix operator.
+    default:
+        if (it->type == Token_type::INTEGER || it->type == Token_type::FLOAT || it->type == Token_type::STRING || it->type == Token_type::BOOL) {
+            expr = read_simple_literal(it, owner);
 
-        // @TODO: (operators) find the type of the identifier
-        //      if prefix operator type, check if there are a next identifier to read
-        //      if so, create a function call expression instead
+        } else if (it->type == Token_type::IDENTIFIER) {
+            expr = read_identifier_reference(it, owner);
 
-    } else {
-        log_error("Unable to parse expression",it->context);
-        return nullptr;
+        } else {
+            log_error("Unable to parse expression",it->context);
+            return nullptr;
+        }
     }
 
     if (expr == nullptr) return expr;
@@ -101,56 +114,62 @@ Owned<Value_expression> read_value_expression(Token_iterator& it, Shared<Abstx_n
     }
     ASSERT(is_error(expr->status) || expr->status == Parsing_status::FULLY_RESOLVED || expr->status == Parsing_status::DEPENDENCIES_NEEDED);
 
-    // Part 2: chained suffix operators
-    // expr = compile_chained_suffixes(it, expr);
-    while (true) {
-        if (it->type == Token_type::SYMBOL && it->token == "(") {
-            // @TODO: find a way to pass LHS all the way from declaration statement to here
+    // Part 2: chained suffix and infix operators
+    return read_operators(it, owner, std::move(expr), min_operator_prio);
+}
 
-            Owned<Variable_expression> variable_expr = owned_dynamic_cast<Variable_expression>(std::move(expr));
 
-            if (variable_expr == nullptr) {
-                ASSERT(expr != nullptr);
-                log_error("Trying to call non-variable expression as a function!", it->context);
-                expr->status = Parsing_status::FATAL_ERROR;
+// Part 2 of read_value_expression(): applies suffix and infix operators to expr, as long as they bind tighter than min_operator_prio
+static Owned<Value_expression> read_operators(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& expr, int min_operator_prio)
+{
+    while (expr->status != Parsing_status::FATAL_ERROR) {
+        const Operator& op = get_operator(it->symbol);
+
+        if (op.suffix.binds(min_operator_prio)) {
+            switch (op.suffix.parser) {
+            case Operator_parser::FUNCTION_CALL:
+                if (expr->status == Parsing_status::FULLY_RESOLVED && *expr->get_type() == *CB_Type::type
+                        && expr->has_constant_value() && dynamic_pointer_cast<const CB_Vector>(parse_type(expr->get_constant_value())) != nullptr) {
+                    expr = read_vector_constructor(it, owner, std::move(expr));
+                } else {
+                    // @TODO: find a way to pass LHS all the way from declaration statement to here
+                    Owned<Variable_expression> variable_expr = owned_dynamic_cast<Variable_expression>(std::move(expr));
+                    if (variable_expr == nullptr) {
+                        ASSERT(expr != nullptr);
+                        log_error("Trying to call non-variable expression as a function!", it->context);
+                        expr->status = Parsing_status::FATAL_ERROR;
+                    } else {
+                        expr = owned_static_cast<Value_expression>(read_function_call(it, owner, std::move(variable_expr), {}));
+                    }
+                }
                 break;
-            } else {
-                expr = owned_static_cast<Value_expression>(read_function_call(it, owner, std::move(variable_expr), {}));
+
+            case Operator_parser::INDEX:
+                if (expr->status == Parsing_status::FULLY_RESOLVED && dynamic_pointer_cast<const CB_Map>(expr->get_type()) != nullptr) {
+                    expr = read_map_index(it, owner, std::move(expr));
+                } else {
+                    // sequences of all kinds; Abstx_seq_index::finalize() reports anything else
+                    expr = read_seq_index(it, owner, std::move(expr));
+                }
+                break;
+
+            case Operator_parser::GETTER:
+                expr = read_getter(it, owner, std::move(expr));
+                break;
+
+            default:
+                ASSERT(false, "Unknown suffix operator parser");
             }
 
-        } else if (it->type == Token_type::SYMBOL && it->token == "[") {
-            ASSERT(false, "indexing NYI");
-            // expr = compile_seq_indexing(it, expr);
-
-        } else if (it->type == Token_type::SYMBOL && it->token == ".") {
-            expr = read_getter(it, owner, std::move(expr));
-
-        } else if (it->type == Token_type::SYMBOL || it->type == Token_type::IDENTIFIER) {
-            // could be an infix opreator. Check if it is.
-            // If it isn't, break.
-            break; // @TODO: (operators) add support for operators here
-
-            /*
-            // Otherwise:
-            int op_prio = 0; // FIXME: set correctly
-            bool right_associative = false; // FIXME: set correctly
-            if (op_prio > min_operator_prio || right_associative && op_prio == min_operator_prio) {
-                auto i_expr = Shared<Infix_expr>(new Infix_expr());
-                i_expr->owner = owner;
-                i_expr->start_token_index = it.current_index;
-                i_expr->context = it->context;
-                it.eat_token();
-
-                i_expr->lhs = expr;
-                i_expr->rhs = compile_value_expression(it, owner, op_prio);
-                // FIXME: check for fatal error
-                i_expr->rhs->owner = i_expr;
-                expr->owner = i_expr;
-                expr = std::static_pointer_cast<Value_expression>(i_expr);
+        } else if (op.infix.binds(min_operator_prio)) {
+            if (op.infix.parser == Operator_parser::USER_DECLARED) {
+                expr = read_user_infix_operator(it, owner, std::move(expr), op.infix.prio);
+            } else if (op.infix.parser == Operator_parser::LESS_THAN_NEGATIVE) {
+                expr = read_less_than_negative(it, owner, std::move(expr), op.infix.prio);
             } else {
-                break;
+                ASSERT(op.infix.parser == Operator_parser::BUILT_IN);
+                expr = read_infix_operator(it, owner, std::move(expr), op.infix.prio);
             }
-            */
 
         } else {
             break;
@@ -163,7 +182,7 @@ Owned<Value_expression> read_value_expression(Token_iterator& it, Shared<Abstx_n
 
     // LOG("read literal " << expr->toS() << " with status " << expr->status << " at " << expr->context.toS());
 
-    return expr;
+    return std::move(expr);
 }
 
 
@@ -185,6 +204,7 @@ Owned<Variable_expression> read_variable_expression(Token_iterator& it, Shared<A
     struct {
         a, b : int = 2;
     }
+    struct #packed_reorder { ... } // the members are reordered to minimize padding
 */
 Owned<Value_expression> read_struct_literal(Token_iterator& it, Shared<Abstx_node> owner) {
     Owned<Abstx_struct_literal> o = alloc(Abstx_struct_literal());
@@ -193,6 +213,7 @@ Owned<Value_expression> read_struct_literal(Token_iterator& it, Shared<Abstx_nod
     o->start_token_index = it.current_index;
 
     it.assert(Token_type::KEYWORD, "struct");
+    bool packed_reorder = it.eat_conditonal(Token_type::COMPILER_COMMAND, "#packed_reorder");
     it.expect(Token_type::SYMBOL, "{");
     if (it.expect_failed()) {
         add_note("In struct definition here", o->context);
@@ -208,7 +229,7 @@ Owned<Value_expression> read_struct_literal(Token_iterator& it, Shared<Abstx_nod
     Seq<size_t> using_indeces;
 
     // read declaration statments until }
-    for (size_t decl_index; !it.compare(Token_type::SYMBOL, "}"); ++decl_index)
+    for (size_t decl_index = 0; !it.compare(Token_type::SYMBOL, "}"); ++decl_index)
     {
         if (it.compare(Token_type::KEYWORD, "using")) {
             it.eat_token();
@@ -239,11 +260,11 @@ Owned<Value_expression> read_struct_literal(Token_iterator& it, Shared<Abstx_nod
 
     // import identifiers from scope
     size_t using_index_index = 0;
-    for (int i = 0; i < o->struct_scope->statements.size; ++i) {
+    for (uint32_t i = 0; i < o->struct_scope->statements.size; ++i) {
         Shared<Abstx_declaration> decl = dynamic_pointer_cast<Abstx_declaration>(o->struct_scope->statements[i]);
         ASSERT(decl && !is_error(decl->status)); // if not, we should have stopped earlier
 
-        bool is_using(using_indeces[using_index_index] == i);
+        bool is_using(using_index_index < using_indeces.size && using_indeces[using_index_index] == i);
         if (is_using) ++using_index_index;
         for (const auto& id : decl->identifiers) {
             struct_type->add_member(Shared<Abstx_identifier>(id), is_using);
@@ -252,7 +273,15 @@ Owned<Value_expression> read_struct_literal(Token_iterator& it, Shared<Abstx_nod
     }
 
     ASSERT(struct_type);
+    struct_type->packed_reorder = packed_reorder;
     struct_type->finalize();
+    if (packed_reorder) {
+        std::ostringstream order;
+        for (uint32_t i = 0; i < struct_type->members.size; ++i) order << (i ? ", " : "") << struct_type->members[i].id->name;
+        log_info("Struct members reordered: " + std::to_string(struct_type->declared_size) + " -> " + std::to_string(struct_type->cb_sizeof())
+                 + " bytes (" + std::to_string(struct_type->bytes_saved()) + " bytes saved)", o->context);
+        add_note("Memory order: " + order.str());
+    }
     o->struct_type = add_complex_cb_type(owned_static_cast<CB_Type>(std::move(struct_type)));
     o->finalize();
     o->struct_scope->status = o->status; // @check if this shouldn't be inside o->finalize()
@@ -375,12 +404,18 @@ Owned<Value_expression> read_simple_literal(Token_iterator& it, Shared<Abstx_nod
             o->value.v_ptr = alloc_constant_data(CB_Bool::type->cb_sizeof());
             *(CB_Bool::c_typedef*)o->value.v_ptr = (t.token == "true");
             break;
-        case Token_type::STRING:
+        case Token_type::STRING: {
             // string literal
             o->value.v_type = CB_String::type;
             o->value.v_ptr = alloc_constant_data(CB_String::type->cb_sizeof());
-            *(CB_String::c_typedef*)o->value.v_ptr = (CB_String::c_typedef)t.token.c_str(); // valid as long as the list of tokens is alive @warning potentially dangerous
+            std::string bad_escape;
+            // long strings are allocated, and live as long as the constant data
+            if (!CB_String::from_token(t.token, *(CB_String::c_typedef*)o->value.v_ptr, bad_escape)) {
+                log_error("Unknown escape sequence " + bad_escape + " in string literal", t.context);
+                o->status = Parsing_status::SYNTAX_ERROR;
+            }
             break;
+        }
         default:
             ASSERT(false); // any other type of token cannot be a simple literal
     }
@@ -400,7 +435,108 @@ Owned<Value_expression> read_sequence_literal(Token_iterator& it, Shared<Abstx_n
     //   [] // type error: unable to determine type of sequence
     //   [int:] // ok
 
-    // @todo
+    //   [..] T // sequence type
+    //   [..] #soa T // sequence of structs, stored as one array per member
+    //   [K] V // map type
+    //   [key->value, key->value] // map literal; the first pair determines the type
+    //   [K->V: ] // empty map literal
+
+    if (it.look_ahead(1).type == Token_type::SYMBOL && it.look_ahead(1).token == "..") {
+        Owned<Abstx_sequence_type> o = alloc(Abstx_sequence_type());
+        o->owner = owner;
+        o->context = it->context;
+        o->start_token_index = it.current_index;
+        it.assert(Token_type::SYMBOL, "[");
+        it.assert(Token_type::SYMBOL, "..");
+        it.expect(Token_type::SYMBOL, "]");
+        if (it.expect_failed()) {
+            add_note("In sequence type here", o->context);
+            o->status = Parsing_status::FATAL_ERROR;
+            return owned_static_cast<Value_expression>(std::move(o));
+        }
+        o->soa = it.eat_conditonal(Token_type::COMPILER_COMMAND, "#soa");
+        o->value_type_expr = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+        if (o->value_type_expr == nullptr) {
+            o->status = Parsing_status::SYNTAX_ERROR;
+            return owned_static_cast<Value_expression>(std::move(o));
+        }
+        o->finalize();
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+
+    Owned<Abstx_map_literal> o = alloc(Abstx_map_literal());
+    o->owner = owner;
+    o->context = it->context;
+    o->start_token_index = it.current_index;
+    it.assert(Token_type::SYMBOL, "[");
+
+    Owned<Value_expression> first = nullptr;
+    if (!it.compare(Token_type::SYMBOL, "]")) first = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+    if (first == nullptr) {
+        ASSERT(false, "seq literal NYI");
+        return nullptr;
+    }
+    if (is_fatal(first->status)) {
+        o->status = first->status;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+
+    if (it.eat_conditonal(Token_type::SYMBOL, "->")) {
+        // map literal
+        o->is_type = false;
+        Owned<Value_expression> second = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+        if (second == nullptr) {
+            o->status = Parsing_status::SYNTAX_ERROR;
+            return owned_static_cast<Value_expression>(std::move(o));
+        }
+        if (it.eat_conditonal(Token_type::SYMBOL, ":")) {
+            o->key_type_expr = std::move(first);
+            o->value_type_expr = std::move(second);
+        } else {
+            o->keys.add(std::move(first));
+            o->values.add(std::move(second));
+            if (!it.eat_conditonal(Token_type::SYMBOL, ",")) goto end_of_pairs;
+        }
+        while (!it.compare(Token_type::SYMBOL, "]") && !it->is_eof()) {
+            Owned<Value_expression> key = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+            it.expect(Token_type::SYMBOL, "->");
+            Owned<Value_expression> value = it.expect_failed() ? nullptr : read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+            if (key == nullptr || value == nullptr) {
+                add_note("In map literal here", o->context);
+                o->status = Parsing_status::FATAL_ERROR;
+                return owned_static_cast<Value_expression>(std::move(o));
+            }
+            o->keys.add(std::move(key));
+            o->values.add(std::move(value));
+            if (!it.eat_conditonal(Token_type::SYMBOL, ",")) break;
+        }
+    end_of_pairs:
+        it.expect(Token_type::SYMBOL, "]");
+        if (it.expect_failed()) {
+            add_note("In map literal here", o->context);
+            o->status = Parsing_status::FATAL_ERROR;
+            return owned_static_cast<Value_expression>(std::move(o));
+        }
+
+    } else if (it.compare(Token_type::SYMBOL, "]") && !is_error(first->status) && first->status != Parsing_status::DEPENDENCIES_NEEDED
+               && *first->get_type() == *CB_Type::type) {
+        // map type
+        it.eat_token();
+        o->key_type_expr = std::move(first);
+        o->value_type_expr = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+        if (o->value_type_expr == nullptr) {
+            o->status = Parsing_status::SYNTAX_ERROR;
+            return owned_static_cast<Value_expression>(std::move(o));
+        }
+
+    } else {
+        // @todo sequence literals and sequence types
+        ASSERT(false, "seq literal NYI");
+        return nullptr;
+    }
+
+    o->finalize();
+    return owned_static_cast<Value_expression>(std::move(o));
 
 /*
     Parsing_status fully_parse() override {
@@ -438,9 +574,409 @@ Owned<Value_expression> read_sequence_literal(Token_iterator& it, Shared<Abstx_n
         return status;
     }
 */
+}
 
-    ASSERT(false, "seq literal NYI");
-    return nullptr;
+
+void Abstx_map_literal::finalize() {
+    if (is_error(status) || is_codegen_ready(status)) return;
+
+    // find the key and value types
+    Shared<const CB_Type> k_type = nullptr;
+    Shared<const CB_Type> v_type = nullptr;
+    if (key_type_expr) {
+        ASSERT(value_type_expr);
+        for (auto* e : { &key_type_expr, &value_type_expr }) {
+            (*e)->finalize();
+            if (is_error((*e)->status) || (*e)->status == Parsing_status::DEPENDENCIES_NEEDED) {
+                status = (*e)->status;
+                return;
+            }
+            if (*(*e)->get_type() != *CB_Type::type || !(*e)->has_constant_value()) {
+                log_error("Map key and value types must be types known at compile time", (*e)->context);
+                status = Parsing_status::TYPE_ERROR;
+                return;
+            }
+        }
+        k_type = parse_type(key_type_expr->get_constant_value());
+        v_type = parse_type(value_type_expr->get_constant_value());
+    }
+    for (uint32_t i = 0; i < keys.size; ++i) {
+        for (auto* e : { &keys[i], &values[i] }) {
+            (*e)->finalize();
+            if (is_error((*e)->status) || (*e)->status == Parsing_status::DEPENDENCIES_NEEDED) {
+                status = (*e)->status;
+                return;
+            }
+        }
+        if (i == 0 && k_type == nullptr) {
+            k_type = keys[0]->get_type();
+            v_type = values[0]->get_type();
+        }
+        if (*keys[i]->get_type() != *k_type || *values[i]->get_type() != *v_type) {
+            log_error("Map literal pair has the wrong type", keys[i]->context);
+            add_note("Expected " + k_type->toS() + "->" + v_type->toS() + " but found " + keys[i]->get_type()->toS() + "->" + values[i]->get_type()->toS());
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+    }
+    ASSERT(k_type && v_type);
+
+    if (!CB_Map::is_valid_key_type(k_type)) {
+        log_error("Invalid map key type " + k_type->toS(), key_type_expr ? key_type_expr->context : keys[0]->context);
+        add_note("Map keys must be numbers, bools or strings");
+        status = Parsing_status::TYPE_ERROR;
+        return;
+    }
+    map_type = CB_Map::get_map_type(k_type, v_type);
+    status = Parsing_status::FULLY_RESOLVED;
+}
+
+
+void Abstx_sequence_type::finalize() {
+    if (is_error(status) || is_codegen_ready(status)) return;
+    ASSERT(value_type_expr);
+    value_type_expr->finalize();
+    if (is_error(value_type_expr->status) || value_type_expr->status == Parsing_status::DEPENDENCIES_NEEDED) {
+        status = value_type_expr->status;
+        return;
+    }
+    if (*value_type_expr->get_type() != *CB_Type::type || !value_type_expr->has_constant_value()) {
+        log_error("Sequence member type must be a type known at compile time", value_type_expr->context);
+        status = Parsing_status::TYPE_ERROR;
+        return;
+    }
+    Shared<const CB_Type> v_type = parse_type(value_type_expr->get_constant_value());
+    if (soa) {
+        Shared<const CB_Struct> struct_type = dynamic_pointer_cast<const CB_Struct>(v_type);
+        if (struct_type == nullptr) {
+            log_error("#soa sequence of non-struct type " + v_type->toS(), value_type_expr->context);
+            add_note("Only sequences of structs can be stored as struct of arrays");
+            status = Parsing_status::TYPE_ERROR;
+            return;
+        }
+        seq_type = CB_Soa_seq::get_soa_seq_type(struct_type);
+    } else {
+        seq_type = CB_Seq::get_seq_type(v_type);
+    }
+    status = Parsing_status::FULLY_RESOLVED;
+}
+
+
+// m[k]
+Owned<Value_expression> read_map_index(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& map) {
+    Owned<Abstx_map_index> o = alloc(Abstx_map_index());
+    o->owner = owner;
+    o->context = map->context;
+    o->start_token_index = it.current_index;
+    it.assert(Token_type::SYMBOL, "[");
+
+    map->owner = static_pointer_cast<Abstx_node>(o);
+    o->map = std::move(map);
+    o->key = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+    if (o->key == nullptr) {
+        o->status = Parsing_status::SYNTAX_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+    it.expect(Token_type::SYMBOL, "]");
+    if (it.expect_failed()) {
+        add_note("In map index here", o->context);
+        o->status = Parsing_status::FATAL_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+
+    o->finalize();
+    return owned_static_cast<Value_expression>(std::move(o));
+}
+
+
+// s[i]
+Owned<Value_expression> read_seq_index(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& seq) {
+    Owned<Abstx_seq_index> o = alloc(Abstx_seq_index());
+    o->owner = owner;
+    o->context = seq->context;
+    o->start_token_index = it.current_index;
+    it.assert(Token_type::SYMBOL, "[");
+
+    seq->owner = static_pointer_cast<Abstx_node>(o);
+    o->seq = std::move(seq);
+    o->index = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+    if (o->index == nullptr) {
+        o->status = Parsing_status::SYNTAX_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+    it.expect(Token_type::SYMBOL, "]");
+    if (it.expect_failed()) {
+        add_note("In sequence index here", o->context);
+        o->status = Parsing_status::FATAL_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+
+    o->finalize();
+    return owned_static_cast<Value_expression>(std::move(o));
+}
+
+
+static void add_tmp_out_args(Shared<Abstx_function_call> o, Shared<const CB_Function> fn_type, Shared<Abstx_node> owner);
+static Owned<Variable_expression> add_function_call_statement(Owned<Abstx_function_call>&& o, Shared<Abstx_node> owner);
+
+// lhs op rhs; lhs is already read. The rhs is read with the priority of the operator, so that operators
+//   with higher priority are grouped into the rhs, and operators with lower priority are left to the caller.
+Owned<Value_expression> read_infix_operator(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& lhs, int op_prio) {
+    Owned<Abstx_infix_operator> o = alloc(Abstx_infix_operator());
+    o->owner = owner;
+    o->context = it->context; // the operator token
+    o->start_token_index = lhs->start_token_index;
+    o->op = it.eat_token().token;
+
+    lhs->owner = static_pointer_cast<Abstx_node>(o);
+    o->lhs = std::move(lhs);
+    if (it->is_eof()) {
+        log_error("Missing right hand side of operator " + o->op, o->context);
+        o->status = Parsing_status::FATAL_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+    o->rhs = read_value_expression(it, static_pointer_cast<Abstx_node>(o), op_prio);
+    if (o->rhs == nullptr) {
+        add_note("In right hand side of operator " + o->op, o->context);
+        o->status = Parsing_status::SYNTAX_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+    if (is_fatal(o->rhs->status)) {
+        o->status = o->rhs->status;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+
+    o->finalize();
+    return owned_static_cast<Value_expression>(std::move(o));
+}
+
+
+// op expr; the operand is read with the priority of the operator, so that only suffix operators are grouped into it
+Owned<Value_expression> read_prefix_operator(Token_iterator& it, Shared<Abstx_node> owner, int op_prio) {
+    Owned<Abstx_prefix_operator> o = alloc(Abstx_prefix_operator());
+    o->owner = owner;
+    o->context = it->context; // the operator token
+    o->start_token_index = it.current_index;
+    o->op = it.eat_token().token;
+
+    if (it->is_eof()) {
+        log_error("Missing operand of operator " + o->op, o->context);
+        o->status = Parsing_status::FATAL_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+    o->operand = read_value_expression(it, static_pointer_cast<Abstx_node>(o), op_prio);
+    if (o->operand == nullptr) {
+        add_note("In operand of operator " + o->op, o->context);
+        o->status = Parsing_status::SYNTAX_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+    if (is_fatal(o->operand->status)) {
+        o->status = o->operand->status;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+
+    o->finalize();
+    return owned_static_cast<Value_expression>(std::move(o));
+}
+
+
+// a<-1 is lexed as a <- 1. After an operand, it can't be a channel receive, so it's read as a < -1.
+// A channel send statement is not an expression; it's found by read_statement() before the expression is read.
+Owned<Value_expression> read_less_than_negative(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& lhs, int op_prio) {
+    Owned<Abstx_infix_operator> o = alloc(Abstx_infix_operator());
+    o->owner = owner;
+    o->context = it->context; // the operator token
+    o->start_token_index = lhs->start_token_index;
+    o->op = "<";
+
+    int op_index = it.current_index;
+    it.assert(Token_type::SYMBOL, "<-");
+
+    lhs->owner = static_pointer_cast<Abstx_node>(o);
+    o->lhs = std::move(lhs);
+    if (it->is_eof()) {
+        log_error("Missing right hand side of operator <", o->context);
+        o->status = Parsing_status::FATAL_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+
+    Owned<Value_expression> negated = nullptr;
+    if ((it->type == Token_type::INTEGER || it->type == Token_type::FLOAT) && it->token[0] != '-') {
+        // the minus is part of the literal, the same way the lexer reads a < -1 -> -1 is an int literal, not a negated uint
+        Token t = *it;
+        t.token = "-" + t.token;
+        t.context = o->context;
+        Seq<Token> tokens;
+        tokens.add(t);
+        tokens.add(it.tokens[it.tokens.size-1]); // eof
+        Token_iterator literal_it{tokens};
+        negated = read_simple_literal(literal_it, static_pointer_cast<Abstx_node>(o));
+        negated->start_token_index = op_index;
+        it.eat_token();
+        if (is_fatal(negated->status)) {
+            o->status = negated->status;
+            return owned_static_cast<Value_expression>(std::move(o));
+        }
+    } else {
+        Owned<Abstx_prefix_operator> negation = alloc(Abstx_prefix_operator());
+        negation->owner = static_pointer_cast<Abstx_node>(o);
+        negation->context = o->context;
+        negation->start_token_index = op_index;
+        negation->op = "-";
+        negation->operand = read_value_expression(it, static_pointer_cast<Abstx_node>(negation), get_operator(intern_symbol("-")).prefix.prio);
+        if (negation->operand == nullptr) {
+            add_note("In right hand side of operator <", o->context);
+            o->status = Parsing_status::SYNTAX_ERROR;
+            return owned_static_cast<Value_expression>(std::move(o));
+        }
+        if (is_fatal(negation->operand->status)) {
+            o->status = negation->operand->status;
+            return owned_static_cast<Value_expression>(std::move(o));
+        }
+        negation->finalize();
+        negated = owned_static_cast<Value_expression>(std::move(negation));
+    }
+
+    // the rest of the right hand side, e.g. a<-1+b is a < (-1 + b)
+    o->rhs = read_operators(it, static_pointer_cast<Abstx_node>(o), std::move(negated), op_prio);
+    if (is_fatal(o->rhs->status)) {
+        o->status = o->rhs->status;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+
+    o->finalize();
+    return owned_static_cast<Value_expression>(std::move(o));
+}
+
+
+// lhs op rhs, where op is declared with infix_operator; it's read like read_infix_operator(),
+//   then called as the function _cb_infix_operator_N(lhs, rhs) (see operator_table.h)
+Owned<Value_expression> read_user_infix_operator(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& lhs, int op_prio) {
+    Owned<Abstx_identifier_reference> fn_id = alloc(Abstx_identifier_reference());
+    fn_id->owner = owner;
+    fn_id->context = it->context; // the operator token
+    fn_id->start_token_index = it.current_index;
+    fn_id->name = infix_operator_name(it->symbol);
+    std::string op = it.eat_token().token;
+    fn_id->finalize();
+
+    if (it->is_eof()) {
+        log_error("Missing right hand side of operator " + op, fn_id->context);
+        fn_id->status = Parsing_status::FATAL_ERROR;
+        return owned_static_cast<Value_expression>(std::move(fn_id));
+    }
+
+    Owned<Abstx_function_call> o = alloc(Abstx_function_call());
+    o->owner = owner; // temporary
+    o->context = fn_id->context;
+    o->start_token_index = lhs->start_token_index;
+
+    // the function must be known before the temporary return values can be declared
+    Shared<const CB_Function> fn_type = nullptr;
+    if (fn_id->status == Parsing_status::FULLY_RESOLVED) {
+        fn_type = dynamic_pointer_cast<const CB_Function>(fn_id->get_type());
+        if (fn_type == nullptr || fn_type->in_types.size != 2) {
+            log_error("Operator " + op + " must be declared as a function with two arguments", fn_id->context);
+            add_note("Declared here", fn_id->id->context);
+            o->status = Parsing_status::TYPE_ERROR;
+        } else {
+            if (fn_id->has_constant_value()) o->function = (Abstx_function_literal*)fn_id->get_constant_value().v_ptr;
+            add_tmp_out_args(o, fn_type, owner);
+        }
+    } else {
+        o->status = fn_id->status;
+    }
+    o->function_pointer = owned_static_cast<Variable_expression>(std::move(fn_id));
+
+    lhs->set_owner(o);
+    o->in_args.add(std::move(lhs));
+    Owned<Value_expression> rhs = read_value_expression(it, owner, op_prio);
+    if (rhs == nullptr) {
+        add_note("In right hand side of operator " + op, o->context);
+        o->status = Parsing_status::SYNTAX_ERROR;
+    } else {
+        rhs->set_owner(o);
+        if (is_error(rhs->status) || rhs->status == Parsing_status::DEPENDENCIES_NEEDED) o->status = rhs->status;
+        o->in_args.add(std::move(rhs));
+    }
+
+    // perform type checking (if no parsing error)
+    if (!is_error(o->status) && o->status != Parsing_status::DEPENDENCIES_NEEDED) {
+        for (const auto& arg : o->in_args) {
+            if (is_error(arg->status) || arg->status == Parsing_status::DEPENDENCIES_NEEDED) {
+                o->status = arg->status;
+                break;
+            }
+        }
+    }
+    if (!is_error(o->status) && o->status != Parsing_status::DEPENDENCIES_NEEDED) {
+        for (int i = 0; i < 2; ++i) {
+            if (*o->in_args[i]->get_type() != *fn_type->in_types[i]) {
+                log_error("Mismatched types for operator " + op + "; unable to convert from type "+o->in_args[i]->get_type()->toS()+" to "+fn_type->in_types[i]->toS(), o->in_args[i]->context);
+                o->status = Parsing_status::TYPE_ERROR;
+            }
+        }
+        if (!is_error(o->status)) o->status = Parsing_status::FULLY_RESOLVED;
+    }
+
+    return owned_static_cast<Value_expression>(add_function_call_statement(std::move(o), owner));
+}
+
+
+// T(x) or T(seq, index), where T is a vector type
+Owned<Value_expression> read_vector_constructor(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& type_expr) {
+    Shared<const CB_Vector> vector_type = dynamic_pointer_cast<const CB_Vector>(parse_type(type_expr->get_constant_value()));
+    ASSERT(vector_type); // checked by the caller
+    const Token_context& context = type_expr->context;
+    int start_token_index = type_expr->start_token_index;
+    it.assert(Token_type::SYMBOL, "(");
+
+    Seq<Owned<Value_expression>> args;
+    bool fatal = false;
+    while (!it.compare(Token_type::SYMBOL, ")") && !it->is_eof()) {
+        Owned<Value_expression> arg = read_value_expression(it, owner);
+        if (arg == nullptr || is_fatal(arg->status)) { fatal = true; break; }
+        args.add(std::move(arg));
+        if (!it.eat_conditonal(Token_type::SYMBOL, ",")) break;
+    }
+    if (!fatal) {
+        it.expect(Token_type::SYMBOL, ")");
+        fatal = it.expect_failed();
+    }
+
+    if (args.size == 2) {
+        Owned<Abstx_vector_view> o = alloc(Abstx_vector_view());
+        o->owner = owner;
+        o->context = context;
+        o->start_token_index = start_token_index;
+        o->vector_type = vector_type;
+        args[0]->owner = static_pointer_cast<Abstx_node>(o);
+        args[1]->owner = static_pointer_cast<Abstx_node>(o);
+        o->seq = std::move(args[0]);
+        o->index = std::move(args[1]);
+        if (fatal) o->status = Parsing_status::FATAL_ERROR;
+        o->finalize();
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+
+    Owned<Abstx_vector_splat> o = alloc(Abstx_vector_splat());
+    o->owner = owner;
+    o->context = context;
+    o->start_token_index = start_token_index;
+    o->vector_type = vector_type;
+    if (fatal) {
+        add_note("In " + vector_type->toS() + " constructor here", context);
+        o->status = Parsing_status::FATAL_ERROR;
+    } else if (args.size != 1) {
+        log_error("Wrong number of arguments to " + vector_type->toS(), context);
+        add_note("Expected either a number, or a sequence and an index, but found " + std::to_string(args.size) + " arguments");
+        o->status = Parsing_status::SYNTAX_ERROR;
+    } else {
+        args[0]->owner = static_pointer_cast<Abstx_node>(o);
+        o->value = std::move(args[0]);
+        o->finalize();
+    }
+    return owned_static_cast<Value_expression>(std::move(o));
 }
 
 
@@ -483,7 +1019,15 @@ Owned<Variable_expression> read_function_call(Token_iterator& it, Shared<Abstx_n
     Shared<const CB_Type> t = fn_id->get_type();
     ASSERT(t != nullptr); // type must be known
     Shared<const CB_Function> fn_type = dynamic_pointer_cast<const CB_Function>(t);
-    if (fn_type == nullptr) {
+    Shared<Abstx_function_literal> generic = nullptr; // the function type is decided by the arguments
+    if (*t == *CB_Generic_function::type) {
+        if (!fn_id->has_constant_value()) {
+            log_error("Generic function must be known at compile time", o->context);
+            o->status = Parsing_status::COMPILE_TIME_ERROR;
+        } else {
+            generic = (Abstx_function_literal*)fn_id->get_constant_value().v_ptr;
+        }
+    } else if (fn_type == nullptr) {
         log_error("Non-function expression used as a function", o->context);
         o->status = Parsing_status::SYNTAX_ERROR;
     } else if (fn_id->has_constant_value()) {
@@ -493,27 +1037,7 @@ Owned<Variable_expression> read_function_call(Token_iterator& it, Shared<Abstx_n
 
     // Check out_args
     if (lhs.size > 0) o->out_args = lhs;
-    else if (fn_type != nullptr && fn_type->out_types.size > 0) {
-        // create declaration statement with tmp variables; push it to scope
-        // add its temporary variables as out_args
-        Owned<Abstx_declaration> tmp_decl = alloc(Abstx_declaration());
-        tmp_decl->owner = owner;
-        for (const auto& type : fn_type->out_types) {
-            // create tmp identifier; add to declaration statement
-            Owned<Abstx_identifier> tmp_id = alloc(Abstx_identifier());
-            tmp_id->set_owner(Shared<Abstx_declaration>(tmp_decl));
-            tmp_id->context = it->context;
-            // tmp_id->start_token_index = ---; // no start token index since the token doesn't really exist
-            tmp_id->name = "_cb_tmp_" + std::to_string(get_unique_id());
-            tmp_id->value.v_type = type;
-            tmp_id->finalize();
-
-            o->out_args.add(static_pointer_cast<Variable_expression>(tmp_id));
-            tmp_decl->identifiers.add(std::move(tmp_id));
-        }
-        tmp_decl->status = Parsing_status::FULLY_RESOLVED; // mark as resolved @check if some errors should be reported here
-        o->parent_scope()->statements.add(owned_static_cast<Statement>(std::move(tmp_decl)));
-    }
+    else if (fn_type != nullptr) add_tmp_out_args(o, fn_type, owner);
 
     it.assert(Token_type::SYMBOL, "("); // this should already have been checked
 
@@ -541,15 +1065,13 @@ Owned<Variable_expression> read_function_call(Token_iterator& it, Shared<Abstx_n
         Shared<Abstx_function_call_expression> fc = dynamic_pointer_cast<Abstx_function_call_expression>(arg);
         if (fc != nullptr) {
             ASSERT(fc->function_call != nullptr);
-            if (fc->function_call->out_args.size == 0) {
-                for (const Shared<Variable_expression>& out_arg : fc->function_call->out_args) {
-                    Owned<Variable_expression_reference> id_ref = alloc(Variable_expression_reference());
-                    id_ref->set_owner(o);
-                    id_ref->context = fc->context;
-                    id_ref->start_token_index = fc->start_token_index;
-                    id_ref->expr = out_arg;
-                    o->in_args.add(owned_static_cast<Value_expression>(std::move(id_ref)));
-                }
+            for (const Shared<Variable_expression>& out_arg : fc->function_call->out_args) {
+                Owned<Variable_expression_reference> id_ref = alloc(Variable_expression_reference());
+                id_ref->set_owner(o);
+                id_ref->context = fc->context;
+                id_ref->start_token_index = fc->start_token_index;
+                id_ref->expr = out_arg;
+                o->in_args.add(owned_static_cast<Value_expression>(std::move(id_ref)));
             }
         } else {
             // not a function call -> just add the argument directly
@@ -573,8 +1095,26 @@ Owned<Variable_expression> read_function_call(Token_iterator& it, Shared<Abstx_n
         if (it.expect_failed()) o->status = Parsing_status::FATAL_ERROR;
     }
 
+    // the arguments decide which specialization to call
+    if (generic && !is_error(o->status)) {
+        for (const auto& arg : o->in_args) {
+            if (arg->status == Parsing_status::DEPENDENCIES_NEEDED) o->status = Parsing_status::DEPENDENCIES_NEEDED;
+        }
+    }
+    if (generic && !is_error(o->status) && o->status != Parsing_status::DEPENDENCIES_NEEDED) {
+        o->function = get_specialization(generic, o->in_args, o->context);
+        if (o->function == nullptr) {
+            o->status = Parsing_status::TYPE_ERROR;
+        } else if (is_error(o->function->status)) {
+            o->status = o->function->status;
+        } else {
+            fn_type = dynamic_pointer_cast<const CB_Function>(o->function->get_type());
+            if (lhs.size == 0) add_tmp_out_args(o, fn_type, owner);
+        }
+    }
+
     // perform type checking (if no parsing error)
-    if (!is_error(o->status)) {
+    if (!is_error(o->status) && (fn_type || !generic)) {
         ASSERT(fn_type);
         // compare in_args with fn_type->in_types
         for (int i = 0; i < fn_type->in_types.size; ++i) {
@@ -623,6 +1163,49 @@ Owned<Variable_expression> read_function_call(Token_iterator& it, Shared<Abstx_n
     if (it.expect_failed()) o->status = Parsing_status::FATAL_ERROR;
     if (!is_error(o->status) && o->status != Parsing_status::DEPENDENCIES_NEEDED) o->status = Parsing_status::FULLY_RESOLVED;
 
+    return add_function_call_statement(std::move(o), owner);
+}
+
+
+// creates a declaration statement with temporary variables for the return values of the function call, and adds them as out_args
+static void add_tmp_out_args(Shared<Abstx_function_call> o, Shared<const CB_Function> fn_type, Shared<Abstx_node> owner) {
+    if (fn_type->out_types.size == 0) return;
+    // create declaration statement with tmp variables; push it to scope
+    // add its temporary variables as out_args
+    Owned<Abstx_declaration> tmp_decl = alloc(Abstx_declaration());
+    tmp_decl->owner = owner;
+    for (const auto& type : fn_type->out_types) {
+        // create tmp identifier; add to declaration statement
+        Owned<Abstx_identifier> tmp_id = alloc(Abstx_identifier());
+        tmp_id->set_owner(Shared<Abstx_declaration>(tmp_decl));
+        tmp_id->context = o->context;
+        // tmp_id->start_token_index = ---; // no start token index since the token doesn't really exist
+        tmp_id->name = "_cb_tmp_" + std::to_string(get_unique_id());
+        tmp_id->value.v_type = type;
+        tmp_id->finalize();
+
+        o->out_args.add(static_pointer_cast<Variable_expression>(tmp_id));
+        tmp_decl->identifiers.add(std::move(tmp_id));
+    }
+    tmp_decl->status = Parsing_status::FULLY_RESOLVED; // mark as resolved @check if some errors should be reported here
+    o->parent_scope()->statements.add(owned_static_cast<Statement>(std::move(tmp_decl)));
+}
+
+
+// adds the function call as a separate statement in the parent scope, and returns an expression that references it
+static Owned<Variable_expression> add_function_call_statement(Owned<Abstx_function_call>&& o, Shared<Abstx_node> owner) {
+    // the call might change global variables and its out arguments, so loops around it have to check their indices
+    for (const auto& arg : o->out_args) {
+        if (!check_shared_write(arg, static_pointer_cast<Abstx_node>(o))) o->status = Parsing_status::TYPE_ERROR;
+        Shared<Abstx_identifier_reference> ref = dynamic_pointer_cast<Abstx_identifier_reference>(arg);
+        if (ref) invalidate_loop_bounds(ref->id, static_pointer_cast<Abstx_node>(o));
+    }
+    invalidate_loop_bounds(nullptr, static_pointer_cast<Abstx_node>(o), true);
+    // the side effects of the called function are only known when it's parsed (see Global_scope::parse_reached_functions())
+    if (!o->compile_time && enclosing_parallel_loop(static_pointer_cast<Abstx_node>(o))) {
+        o->global_scope()->parallel_calls.add(Shared<Abstx_function_call>(o));
+    }
+
     // create a function call expression to reference the function call statement
     Owned<Abstx_function_call_expression> expr = alloc(Abstx_function_call_expression());
     expr->owner = owner;
@@ -739,8 +1322,11 @@ Parsing_status Abstx_function::finalize() {
 
 
 
-void read_function_arguments(Token_iterator& it, Shared<Abstx_function_literal> fn, bool in, bool allow_multiple_args) {
+// if bindings is set, the function is a specialization of a generic function (see get_specialization())
+void read_function_arguments(Token_iterator& it, Shared<Abstx_function_literal> fn, bool in, bool allow_multiple_args, const Abstx_function_literal::Generic_bindings* bindings) {
     ASSERT(fn);
+    // in a specialization, the types are read in the function scope, where the generic type names are declared
+    Shared<Abstx_node> type_owner = bindings ? static_pointer_cast<Abstx_node>(Shared<Abstx_function_scope>(&fn->scope)) : static_pointer_cast<Abstx_node>(fn);
 
     while(1) {
         Abstx_function_literal::Function_arg arg{};
@@ -766,14 +1352,15 @@ void read_function_arguments(Token_iterator& it, Shared<Abstx_function_literal>
         }
 
         if (it.compare(Token_type::SYMBOL, "$")) {
+            ASSERT(bindings); // generic functions are read with read_generic_function_arguments()
             arg.generic_type = true;
             it.eat_token();
-            const Token& type_token = it.expect(Token_type::IDENTIFIER);
-            // @todo what to do with this type name?
-            ASSERT(false, "generic types NYI");
+            arg.generic_type_name = it.expect(Token_type::IDENTIFIER).token;
+            if (it.expect_failed()) break; // syntax error
+            id->value.v_type = bindings->types.at(arg.generic_type_name);
         } else {
             // read regular type expression
-            Owned<Value_expression> type_expr = read_value_expression(it, static_pointer_cast<Abstx_node>(fn));
+            Owned<Value_expression> type_expr = read_value_expression(it, type_owner);
             ASSERT(type_expr);
             if (is_error(type_expr->status) || type_expr->status == Parsing_status::DEPENDENCIES_NEEDED) {
                 id->status = type_expr->status;
@@ -794,6 +1381,9 @@ void read_function_arguments(Token_iterator& it, Shared<Abstx_function_literal>
             break;
         }
 
+        // the value of a $a argument is a part of the specialization
+        if (arg.generic_id && bindings) id->value.v_ptr = bindings->values.at(id->name).v_ptr;
+
         // add the identifier and arg to the function
         arg.identifier = id;
         fn->scope.fn_identifiers[id->name] = std::move(id);
@@ -818,7 +1408,155 @@ void read_function_arguments(Token_iterator& it, Shared<Abstx_function_literal>
 }
 
 
-Owned<Value_expression> read_function_literal(Token_iterator& it, Shared<Abstx_node> owner)
+// returns true if there is a '$' in the in arguments; the iterator should point to the token after '('
+static bool has_generic_arguments(Token_iterator& it) {
+    int end = it.find_matching_paren(it.current_index-1);
+    if (it.expect_failed()) return false; // logged later
+    for (int i = it.current_index; i < end; ++i) {
+        if (it.look_at(i).type == Token_type::SYMBOL && it.look_at(i).token == "$") return true;
+    }
+    return false;
+}
+
+
+// eats the current token, or everything up to the matching closing paren/bracket/brace
+static void skip_enclosed_tokens(Token_iterator& it) {
+    int end = it.current_index;
+    if (it.compare(Token_type::SYMBOL, "(")) end = it.find_matching_paren();
+    else if (it.compare(Token_type::SYMBOL, "[")) end = it.find_matching_bracket();
+    else if (it.compare(Token_type::SYMBOL, "{")) end = it.find_matching_brace();
+    if (end < 0) end = it.tokens.size-1; // eof; the error is already logged
+    it.current_index = end;
+    it.eat_token();
+}
+
+
+// fn(a: $T, $b: int, c: T)->(r: T) { ... }
+// Only the names and $ markers of the in arguments are read; the types might depend on the generic types, so they are
+//   read for each specialization instead. The iterator should point to the token after '('.
+static void read_generic_function(Token_iterator& it, Shared<Abstx_function_literal> fn) {
+    fn->generic = true;
+    while (!it.compare(Token_type::SYMBOL, ")")) {
+        Abstx_function_literal::Function_arg arg{};
+        Owned<Abstx_identifier> id = alloc(Abstx_identifier());
+        id->set_owner(Shared<Abstx_node>(&fn->scope));
+        id->context = it->context;
+        id->start_token_index = it.current_index;
+
+        arg.generic_id = it.eat_conditonal(Token_type::SYMBOL, "$");
+        id->name = it.expect(Token_type::IDENTIFIER).token;
+        if (it.expect_failed()) break;
+        it.expect(Token_type::SYMBOL, ":");
+        if (it.expect_failed()) break;
+        if (it.eat_conditonal(Token_type::SYMBOL, "$")) {
+            arg.generic_type = true;
+            arg.generic_type_name = it.expect(Token_type::IDENTIFIER).token;
+            if (it.expect_failed()) break;
+        }
+
+        // skip the rest of the type expression
+        while (!it.compare(Token_type::SYMBOL, ",") && !it.compare(Token_type::SYMBOL, ")") && !it->is_eof()) {
+            skip_enclosed_tokens(it);
+        }
+
+        arg.identifier = id;
+        fn->scope.fn_identifiers[id->name] = std::move(id);
+        fn->in_args.add(std::move(arg));
+        if (!it.eat_conditonal(Token_type::SYMBOL, ",")) break;
+    }
+    it.expect(Token_type::SYMBOL, ")");
+
+    // skip the out arguments
+    while (!it.compare(Token_type::SYMBOL, "{") && !it.compare(Token_type::SYMBOL, ";") && !it->is_eof()) {
+        if (it.compare(Token_type::SYMBOL, "(") || it.compare(Token_type::SYMBOL, "[")) skip_enclosed_tokens(it);
+        else it.eat_token();
+    }
+
+    it.expect_current(Token_type::SYMBOL, "{");
+    if (!it.expect_failed()) it.current_index = it.find_matching_brace() + 1;
+    if (it.expect_failed()) {
+        add_note("In generic function literal here", fn->context);
+        fn->status = Parsing_status::FATAL_ERROR;
+        return;
+    }
+
+    fn->function_identifier.value.v_type = CB_Generic_function::type;
+    fn->function_identifier.value.v_ptr = fn.v;
+    fn->function_identifier.status = Parsing_status::FULLY_RESOLVED;
+    fn->status = Parsing_status::FULLY_RESOLVED;
+}
+
+
+// reads the statements of a reached function, and updates the function status if that fails
+static void parse_function_scope(Shared<Abstx_function_literal> fn) {
+    ASSERT(fn->reached);
+    Parsing_status status = fn->scope.fully_parse();
+    if (is_error(status) && !is_fatal(fn->status)) fn->status = status;
+}
+
+
+// Returns the specialization of the generic function for the given arguments, or nullpointer if the types can't be inferred.
+// The specialization is read from the tokens of the generic function, with the inferred types and values bound to the
+//   generic names. It's created once for each key, and shared by all calls.
+Shared<Abstx_function_literal> get_specialization(Shared<Abstx_function_literal> generic, const Seq<Owned<Value_expression>>& in_args, const Token_context& context) {
+    ASSERT(generic && generic->generic);
+    if (in_args.size != generic->in_args.size) {
+        log_error("Wrong number of arguments to generic function; expected " + std::to_string(generic->in_args.size) + " arguments but found " + std::to_string(in_args.size), context);
+        add_note("Generic function defined here", generic->context);
+        return nullptr;
+    }
+
+    // infer types and values
+    Abstx_function_literal::Specialization_key key;
+    Abstx_function_literal::Generic_bindings bindings;
+    for (uint32_t i = 0; i < in_args.size; ++i) {
+        const auto& arg = generic->in_args[i];
+        Shared<const CB_Type> type = in_args[i]->get_type();
+        if (arg.generic_type) {
+            auto bound = bindings.types.find(arg.generic_type_name);
+            if (bound == bindings.types.end()) {
+                bindings.types[arg.generic_type_name] = type;
+                key.types.push_back(type->uid);
+            } else if (*bound->second != *type) {
+                log_error("Conflicting types for $" + arg.generic_type_name + ": " + bound->second->toS() + " and " + type->toS(), in_args[i]->context);
+                add_note("Generic function defined here", generic->context);
+                return nullptr;
+            }
+        }
+        if (arg.generic_id) {
+            if (!in_args[i]->has_constant_value()) {
+                log_error("Non-constant value supplied for function argument that must be constant", in_args[i]->context);
+                add_note("Argument marked as constant here", arg.identifier->context);
+                return nullptr;
+            }
+            const Any& value = in_args[i]->get_constant_value();
+            bindings.values[arg.identifier->name] = value;
+            key.values.push_back(value.toS());
+        }
+    }
+
+    auto it = generic->specializations.find(key);
+    if (it != generic->specializations.end()) return it->second;
+
+    // read the function again, this time with the generic names bound
+    Token_iterator token_it = generic->global_scope()->iterator(generic->start_token_index);
+    Owned<Abstx_function_literal> o = owned_static_cast<Abstx_function_literal>(read_function_literal(token_it, generic->owner, &bindings));
+    o->specialization_of = generic;
+    Shared<Abstx_function_literal> fn = o;
+    generic->specializations[key] = std::move(o); // before the body is read, so that recursive calls finds it
+
+    // specializations are only created by calls in reached scopes -> read the function body now, so that errors can refer to the call
+    fn->finalize();
+    if (!is_error(fn->status) && fn->status != Parsing_status::DEPENDENCIES_NEEDED) {
+        fn->reached = true;
+        parse_function_scope(fn);
+    }
+    if (is_error(fn->status)) add_note("In specialization of generic function that was called here", context);
+    return fn;
+}
+
+
+Owned<Value_expression> read_function_literal(Token_iterator& it, Shared<Abstx_node> owner, const Abstx_function_literal::Generic_bindings* bindings)
 {
     Owned<Abstx_function_literal> o = alloc(Abstx_function_literal());
     o->owner = owner;
@@ -833,6 +1571,7 @@ Owned<Value_expression> read_function_literal(Token_iterator& it, Shared<Abstx_n
     o->function_identifier.start_token_index = it.current_index;
     o->function_identifier.status = Parsing_status::NOT_PARSED;
 
+    o->is_inline = it.eat_conditonal(Token_type::KEYWORD, "inline"); // read again for each specialization, since they start from the same token
     it.assert(Token_type::KEYWORD, "fn"); // eat the "fn" token
     it.expect(Token_type::SYMBOL, "(");
     if (it.expect_failed()) {
@@ -840,9 +1579,29 @@ Owned<Value_expression> read_function_literal(Token_iterator& it, Shared<Abstx_n
         return owned_static_cast<Value_expression>(std::move(o));
     }
 
+    if (bindings == nullptr && has_generic_arguments(it)) {
+        read_generic_function(it, o);
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+
+    if (bindings) {
+        // declare the inferred types in the function scope, so that they can be used in the arguments and in the function body
+        o->scope.set_owner(o);
+        for (const auto& type : bindings->types) {
+            Owned<Abstx_identifier> id = alloc(Abstx_identifier());
+            id->set_owner(Shared<Abstx_node>(&o->scope));
+            id->context = o->context;
+            id->name = type.first;
+            id->value.v_type = CB_Type::type;
+            id->value.v_ptr = &type.second->uid;
+            id->status = Parsing_status::FULLY_RESOLVED;
+            o->scope.fn_identifiers[id->name] = std::move(id);
+        }
+    }
+
     if (!it.compare(Token_type::SYMBOL, ")")) {
         // read in arguments
-        read_function_arguments(it, o, true, true); // in arguments
+        read_function_arguments(it, o, true, true, bindings); // in arguments
 
         // check for errors
         if (it.expect_failed()) {
@@ -861,7 +1620,7 @@ Owned<Value_expression> read_function_literal(Token_iterator& it, Shared<Abstx_n
             it.eat_token();
             parens = true;
         }
-        read_function_arguments(it, o, false, parens); // in arguments
+        read_function_arguments(it, o, false, parens, bindings); // out arguments
 
         if (parens) {
             it.expect(Token_type::SYMBOL, ")");
@@ -879,7 +1638,7 @@ Owned<Value_expression> read_function_literal(Token_iterator& it, Shared<Abstx_n
     o->scope.flags += SCOPE_DYNAMIC;
     o->scope.context = it->context;
     o->scope.start_token_index = it.current_index;
-    o->scope.status == Parsing_status::PARTIALLY_PARSED;
+    o->scope.status = Parsing_status::PARTIALLY_PARSED; // the statements are read when the function is reached
 
     it.expect_current(Token_type::SYMBOL, "{");
     if (it.expect_failed()) {
@@ -899,26 +1658,26 @@ Owned<Value_expression> read_function_literal(Token_iterator& it, Shared<Abstx_n
     // @todo: (recursive functions) this function must return first so the value expression can be used
     o->finalize();
 
+    // a literal that is used directly in a reached scope (e.g. as a function argument) is reached as well
+    // literals in declarations are reached through the declared identifier instead (see Abstx_declaration::fully_parse())
+    if (bindings == nullptr && owner->parent_scope()->dynamic() && dynamic_pointer_cast<Abstx_declaration>(owner) == nullptr) {
+        o->global_scope()->reach(Shared<Abstx_function_literal>(o), owner);
+    }
+
     return owned_static_cast<Value_expression>(std::move(o));
 }
 
 void Abstx_function_literal::finalize()
 {
     if (is_error(status)) return;
+    if (generic) return; // resolved when it was read; the specializations are finalized by get_specialization()
 
     // note: function scope doesn't need to be fully parsed for the function literal to be (this is necessary for recursive functions to work)
     // all types will be finalized as a part of reading the literal, but at that point no statements are actually read yet
-    // only when that is done, we can try to finalize the scope as well.
+    // the scope is parsed later, if the function is reached (see Global_scope::reach())
     if (is_codegen_ready(function_identifier.status)) {
-        if (is_codegen_ready(scope.status)) {
-            ASSERT(is_codegen_ready(status));
-            return;
-        }
-        else {
-            scope.fully_parse();
-            if (is_error(scope.status) && !is_fatal(status)) status = scope.status;
-            return; // don't need to check types again
-        }
+        ASSERT(is_codegen_ready(status));
+        return; // don't need to check types again
     }
 
     // This should only be done once (during reading of literal)
@@ -938,6 +1697,7 @@ void Abstx_function_literal::finalize()
             Shared<const CB_Type> type = arg.identifier->get_type();
             ASSERT(type);
             fn_type->in_types.add(type);
+            if (!type->is_primitive()) arg.identifier->by_pointer = true; // passed by const pointer (see generate_declaration())
         }
 
         for (const auto& arg : out_args) {
@@ -956,6 +1716,11 @@ void Abstx_function_literal::finalize()
         function_identifier.value.v_type = static_pointer_cast<const CB_Type>(add_complex_type(std::move(fn_type)));
     }
     ASSERT(function_identifier.value.v_type); // if type creation failed we should have already returned
+
+    // a single out argument is a local variable that is returned; otherwise the out arguments are pointers (see generate_declaration())
+    if (out_args.size == 1) scope.return_value = out_args[0].identifier;
+    else for (const auto& arg : out_args) arg.identifier->by_pointer = true;
+
     function_identifier.value.v_ptr = this;
     function_identifier.status = Parsing_status::FULLY_RESOLVED;
 
@@ -967,6 +1732,104 @@ void Abstx_function_literal::finalize()
 
 
 
+void Global_scope::reach(const Any& fn_value, Shared<Abstx_node> from)
+{
+    if (fn_value.v_ptr == nullptr || dynamic_pointer_cast<const CB_Function>(fn_value.v_type) == nullptr) return;
+    reach(Shared<Abstx_function_literal>((Abstx_function_literal*)fn_value.v_ptr), from); // the value of a function identifier is its literal
+}
+
+void Global_scope::reach(Shared<Abstx_function_literal> fn, Shared<Abstx_node> from)
+{
+    ASSERT(fn);
+    if (fn->generic || is_error(fn->status)) return;
+    Shared<Abstx_function_literal> caller = from ? from->parent_function() : nullptr;
+    if (caller != nullptr) {
+        bool known = false;
+        for (const auto& f : caller->referenced_functions) known = known || f.v == fn.v;
+        if (!known) caller->referenced_functions.add(fn);
+    }
+    if (fn->reached) return;
+    fn->reached = true;
+    reached_functions.add(fn);
+}
+
+// true if target can be reached from the scope of fn; path gets the functions in between
+static bool reaches(Shared<Abstx_function_literal> fn, Shared<Abstx_function_literal> target, std::set<Abstx_function_literal*>& visited, Seq<Shared<Abstx_function_literal>>& path)
+{
+    for (const auto& f : fn->referenced_functions) {
+        if (f.v == target.v) return true;
+        if (!visited.insert(f.v).second) continue;
+        path.add(f);
+        if (reaches(f, target, visited, path)) return true;
+        path.remove_last();
+    }
+    return false;
+}
+
+// visited gets all functions that have been searched
+static Shared<Abstx_node> find_side_effect(Shared<const Abstx_function_literal> fn, std::set<const Abstx_function_literal*>& visited)
+{
+    if (fn->side_effect) return fn->side_effect;
+    for (const auto& f : fn->referenced_functions) {
+        if (!visited.insert(f.v).second) continue;
+        Shared<Abstx_node> effect = find_side_effect(f, visited);
+        if (effect) return effect;
+    }
+    return nullptr;
+}
+
+Shared<Abstx_node> Abstx_function_literal::find_side_effect() const
+{
+    std::set<const Abstx_function_literal*> visited{this};
+    return ::find_side_effect(this, visited);
+}
+
+Parsing_status Global_scope::parse_reached_functions()
+{
+    Parsing_status status = Parsing_status::FULLY_RESOLVED;
+    int first = parsed_functions;
+    // parsing a function scope might reach more functions -> the list can grow while looping
+    for (; parsed_functions < reached_functions.size; ++parsed_functions) {
+        Shared<Abstx_function_literal> fn = reached_functions[parsed_functions];
+        parse_function_scope(fn);
+        if (is_error(fn->status)) status = fn->status;
+    }
+
+    // everything that the new functions can reach is parsed now
+    for (uint32_t i = first; i < reached_functions.size; ++i) {
+        Shared<Abstx_function_literal> fn = reached_functions[i];
+        if (!fn->is_inline || is_error(fn->status)) continue;
+        std::set<Abstx_function_literal*> visited;
+        Seq<Shared<Abstx_function_literal>> path;
+        if (!reaches(fn, fn, visited, path)) continue;
+        log_error("Inline function can't be recursive", fn->context);
+        for (const auto& f : path) add_note("Reaches itself through this function", f->context);
+        fn->status = Parsing_status::TYPE_ERROR;
+        status = fn->status;
+    }
+
+    // the chunks of a parallel for loop run at the same time -> the functions they call can't write to anything shared
+    for (; checked_parallel_calls < parallel_calls.size; ++checked_parallel_calls) {
+        Shared<Abstx_function_call> call = parallel_calls[checked_parallel_calls];
+        if (is_error(call->status) || (call->function && is_error(call->function->status))) continue;
+        Shared<Abstx_node> effect = call->function ? call->function->find_side_effect() : nullptr;
+        if (call->function && effect == nullptr) continue;
+        if (call->function == nullptr) {
+            log_error("Function called in parallel for loop must be known at compile time", call->context);
+            add_note("Its side effects can't be checked");
+        } else {
+            log_error("Call to function with side effects in parallel for loop", call->context);
+            add_note("Side effect here", effect->context);
+        }
+        add_note("In parallel for loop here", enclosing_parallel_loop(static_pointer_cast<Abstx_node>(call))->context);
+        call->status = Parsing_status::TYPE_ERROR;
+        status = call->status;
+    }
+    return status;
+}
+
+
+
 Owned<Value_expression> read_function_type(Token_iterator& it, Shared<Abstx_node> owner)
 {
     it.assert(Token_type::KEYWORD, "fn"); // eat the "fn" token
@@ -974,6 +1837,72 @@ Owned<Value_expression> read_function_type(Token_iterator& it, Shared<Abstx_node
 }
 
 
+
+// chan int
+// chan(16) int
+Owned<Value_expression> read_channel_literal(Token_iterator& it, Shared<Abstx_node> owner)
+{
+    Owned<Abstx_channel_literal> o = alloc(Abstx_channel_literal());
+    o->owner = owner;
+    o->context = it->context;
+    o->start_token_index = it.current_index;
+    it.assert(Token_type::KEYWORD, "chan");
+
+    if (it.eat_conditonal(Token_type::SYMBOL, "(")) {
+        // capacity -> create a new channel
+        o->is_type = false;
+        Owned<Value_expression> capacity = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+        if (capacity == nullptr) {
+            o->status = Parsing_status::SYNTAX_ERROR;
+        } else if (is_error(capacity->status) || capacity->status == Parsing_status::DEPENDENCIES_NEEDED) {
+            o->status = capacity->status;
+        } else if (*capacity->get_type() != *CB_Uint::type || !capacity->has_constant_value()) {
+            log_error("Channel capacity must be a positive integer known at compile time", capacity->context);
+            o->status = Parsing_status::TYPE_ERROR;
+        } else {
+            o->capacity = *(CB_Uint::c_typedef*)capacity->get_constant_value().v_ptr;
+        }
+        it.expect(Token_type::SYMBOL, ")");
+        if (it.expect_failed()) {
+            add_note("In channel literal here", o->context);
+            o->status = Parsing_status::FATAL_ERROR;
+            return owned_static_cast<Value_expression>(std::move(o));
+        }
+    }
+
+    o->member_type_expr = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+    if (o->member_type_expr == nullptr) {
+        o->status = Parsing_status::SYNTAX_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+    if (is_fatal(o->member_type_expr->status)) o->status = o->member_type_expr->status;
+
+    o->finalize();
+    return owned_static_cast<Value_expression>(std::move(o));
+}
+
+
+// <- c
+Owned<Value_expression> read_channel_receive(Token_iterator& it, Shared<Abstx_node> owner)
+{
+    Owned<Abstx_channel_receive> o = alloc(Abstx_channel_receive());
+    o->owner = owner;
+    o->context = it->context;
+    o->start_token_index = it.current_index;
+    it.assert(Token_type::SYMBOL, "<-");
+
+    o->channel = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+    if (o->channel == nullptr) {
+        o->status = Parsing_status::SYNTAX_ERROR;
+        return owned_static_cast<Value_expression>(std::move(o));
+    }
+    if (is_fatal(o->channel->status)) o->status = o->channel->status;
+
+    o->finalize();
+    return owned_static_cast<Value_expression>(std::move(o));
+}
+
+
 // fn() {}
 // fn() {}
 // fn()->() {}
@@ -982,6 +1911,7 @@ Owned<Value_expression> read_function_type(Token_iterator& it, Shared<Abstx_node
 Owned<Value_expression> read_fn_literal(Token_iterator& it, Shared<Abstx_node> owner)
 {
     int start_index = it.current_index; // save this for later
+    bool is_inline = it.eat_conditonal(Token_type::KEYWORD, "inline");
     it.assert(Token_type::KEYWORD, "fn"); // eat the "fn" token
 
     // first: find if the function has {}
@@ -995,8 +1925,15 @@ Owned<Value_expression> read_fn_literal(Token_iterator& it, Shared<Abstx_node> o
 
             if (t.token == ";") {
                 // end of statement without finding a function scope -> its just a type literal
-                it.current_index = start_index;
-                return read_function_type(it, owner);
+                if (!is_inline) {
+                    it.current_index = start_index;
+                    return read_function_type(it, owner);
+                }
+                log_error("Only function literals can be inline", it.look_at(start_index).context);
+                it.current_index = start_index + 1; // skip the "inline" token
+                Owned<Value_expression> type = read_function_type(it, owner);
+                if (!is_error(type->status)) type->status = Parsing_status::SYNTAX_ERROR;
+                return type;
             }
 
             else if (t.token == "{") {
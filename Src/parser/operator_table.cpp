@@ -0,0 +1,129 @@
+#include "operator_table.h"
+#include "../utilities/assert.h"
+
+#include <cctype>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Operator_table {
+    std::unordered_map<std::string, int> symbols;
+    std::vector<std::string> names;
+    std::vector<Operator> operators;
+
+    Operator_table() {
+        // symbol 0 is reserved for tokens that aren't interned
+        names.push_back("");
+        operators.push_back(Operator());
+
+        set_prefix("(", Operator_parser::PAREN);
+        set_prefix("[", Operator_parser::SEQUENCE_LITERAL);
+        set_prefix("<-", Operator_parser::CHANNEL_RECEIVE);
+        set_prefix("fn", Operator_parser::FN_LITERAL);
+        set_prefix("inline", Operator_parser::FN_LITERAL);
+        set_prefix("struct", Operator_parser::STRUCT_LITERAL);
+        set_prefix("chan", Operator_parser::CHANNEL_LITERAL);
+        set_prefix("-", Operator_parser::BUILT_IN_PREFIX, 900);
+        set_prefix("!", Operator_parser::BUILT_IN_PREFIX, 900);
+
+        set_suffix("(", Operator_parser::FUNCTION_CALL, 1000);
+        set_suffix("[", Operator_parser::INDEX, 1000);
+        set_suffix(".", Operator_parser::GETTER, 1000);
+
+        for (const char* op : { "*", "/", "%" }) set_infix(op, Operator_parser::BUILT_IN, 700);
+        for (const char* op : { "+", "-" }) set_infix(op, Operator_parser::BUILT_IN, 600);
+        for (const char* op : { "<", ">", "<=", ">=" }) set_infix(op, Operator_parser::BUILT_IN, 500);
+        for (const char* op : { "==", "!=" }) set_infix(op, Operator_parser::BUILT_IN, 400);
+        set_infix("<-", Operator_parser::LESS_THAN_NEGATIVE, 500); // a<-1 is a < -1
+        set_infix("&&", Operator_parser::BUILT_IN, 200);
+        set_infix("||", Operator_parser::BUILT_IN, 100);
+
+        for (const char* token : { "(", ")", "[", "]", "{", "}", "->", ",", ".", "...", "#", ":", "=", "$", ";", "?", "'", "_", "<-" }) {
+            operators[intern(token)].reserved = true;
+        }
+    }
+
+    int intern(const std::string& token) {
+        auto it = symbols.find(token);
+        if (it != symbols.end()) return it->second;
+        int symbol = names.size();
+        symbols[token] = symbol;
+        names.push_back(token);
+        operators.push_back(Operator());
+        return symbol;
+    }
+
+    void set_prefix(const std::string& token, Operator_parser parser, int prio = 0) {
+        Operator_entry& e = operators[intern(token)].prefix;
+        e.parser = parser;
+        e.prio = prio;
+    }
+
+    void set_suffix(const std::string& token, Operator_parser parser, int prio) {
+        Operator_entry& e = operators[intern(token)].suffix;
+        e.parser = parser;
+        e.prio = prio;
+    }
+
+    void set_infix(const std::string& token, Operator_parser parser, int prio) {
+        Operator_entry& e = operators[intern(token)].infix;
+        e.parser = parser;
+        e.prio = prio;
+    }
+};
+
+Operator_table& table() {
+    static Operator_table t;
+    return t;
+}
+
+bool is_identifier(const std::string& token) {
+    return !token.empty() && (isalpha(token[0]) || token[0] == '_') && token != "_";
+}
+
+// the priority given to a user declared infix operator
+int user_infix_prio(const std::string& token) {
+    if (is_identifier(token)) return 0;
+    return 300;
+}
+
+} // namespace
+
+
+
+int intern_symbol(const std::string& token) {
+    return table().intern(token);
+}
+
+const std::string& symbol_name(int symbol) {
+    ASSERT(symbol >= 0 && symbol < (int)table().names.size());
+    return table().names[symbol];
+}
+
+const Operator& get_operator(int symbol) {
+    ASSERT(symbol >= 0 && symbol < (int)table().operators.size());
+    return table().operators[symbol];
+}
+
+bool register_infix_operator(int symbol) {
+    ASSERT(symbol > 0 && symbol < (int)table().operators.size());
+    Operator& op = table().operators[symbol];
+    if (op.reserved || op.infix.parser == Operator_parser::BUILT_IN) return false;
+    op.infix.parser = Operator_parser::USER_DECLARED;
+    op.infix.prio = user_infix_prio(symbol_name(symbol));
+    return true;
+}
+
+void reset_infix_operators() {
+    for (auto& op : table().operators) {
+        if (op.infix.parser != Operator_parser::USER_DECLARED) continue;
+        op.infix.parser = Operator_parser::NONE;
+        op.infix.prio = 0;
+    }
+}
+
+std::string infix_operator_name(int symbol) {
+    return "_cb_infix_operator_" + std::to_string(symbol);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+
+/*
+Operator table: the prefix, suffix and infix operators known by the expression parser (see read_value_expression()).
+
+The lexer interns all SYMBOL, IDENTIFIER and KEYWORD tokens, and stores the index in Token::symbol.
+The expression parser looks up the current token in the table once, then dispatches on the operator entry.
+Tokens that aren't interned (literals, eof) have symbol 0, which has no operators.
+
+Priorities follow the specification; higher priority binds tighter:
+
+    () [] .             1000    suffix (function call, indexing, getter)
+    - !                 900     prefix, built-in (unary minus, logical not)
+    * / %               700     infix, built-in
+    + -                 600     infix, built-in
+    < > <= >=           500     infix, built-in
+    == !=               400     infix, built-in
+    other symbols       300     infix, user declared
+    &&                  200     infix, built-in
+    ||                  100     infix, built-in
+    identifiers         0       infix, user declared
+
+"(", "[", "<-", "fn", "struct" and "chan" are prefix entries without priority: they start a new expression.
+"<-" is also an infix entry: after an operand, it can't be a channel receive, so a<-1 is read as a < -1.
+    Channel send statements (c <- 1;) are found before the expression is read, and the channel is read with priority 500.
+
+User declared infix operators are registered when their declaration statement is read:
+
+    infix_operator .. :: fn(low: int, high: int)->(r: range) { ... };
+    r := 1 .. 10;       // r = _cb_infix_operator_N(1, 10), where N is the interned symbol of ".."
+
+The operators declared in a file are stored in its global scope, and registered again when the parsed file is reused (see parse_file()).
+*/
+
+enum struct Operator_parser {
+    NONE,
+
+    // prefix
+    PAREN,              // ( expr )
+    SEQUENCE_LITERAL,   // [ ... ]
+    CHANNEL_RECEIVE,    // <- expr
+    FN_LITERAL,         // fn ...
+    STRUCT_LITERAL,     // struct { ... }
+    CHANNEL_LITERAL,    // chan ...
+    BUILT_IN_PREFIX,    // op expr, see Abstx_prefix_operator
+
+    // suffix
+    FUNCTION_CALL,      // expr ( ... )
+    INDEX,              // expr [ ... ]
+    GETTER,             // expr . id
+
+    // infix
+    BUILT_IN,           // expr op expr, see Abstx_infix_operator
+    USER_DECLARED,      // expr op expr, calls the function declared with infix_operator
+    LESS_THAN_NEGATIVE, // expr <- expr, read as expr < -expr
+};
+
+struct Operator_entry {
+    Operator_parser parser = Operator_parser::NONE;
+    int prio = 0;
+    bool right_associative = false;
+
+    // returns true if the operator should be applied to an expression that was read with min_prio
+    bool binds(int min_prio) const {
+        return parser != Operator_parser::NONE && (prio > min_prio || (right_associative && prio == min_prio));
+    }
+};
+
+struct Operator {
+    Operator_entry prefix;
+    Operator_entry suffix;
+    Operator_entry infix;
+    bool reserved = false; // part of the syntax; can't be declared as an infix operator
+};
+
+int intern_symbol(const std::string& token); // returns a unique index > 0 for each token string
+const std::string& symbol_name(int symbol);
+const Operator& get_operator(int symbol);
+
+// registers a user declared infix operator; returns false (without logging an error) if the symbol is reserved or already a built-in operator
+bool register_infix_operator(int symbol);
+
+// removes all user declared infix operators; the symbols stay interned
+// used by the compile server, so that operators declared in one request can't be used in the next
+void reset_infix_operators();
+
+// the name of the function identifier that a user declared infix operator calls
+std::string infix_operator_name(int symbol);
@@ -2,16 +2,20 @@
 #include "../lexer/lexer.h"
 #include "parsing_status.h"
 #include "token_iterator.h"
+#include "token_cache.h"
+#include "operator_table.h"
 
 #include "../abstx/abstx_scope.h"
 
 #include <map>
 #include <string>
+#include <vector>
 
 
 
 
 std::map<std::string, Owned<Global_scope>> global_scopes;
+Seq<Owned<Global_scope>> invalidated_scopes; // never freed: the type table (e.g. struct members) still refers to their nodes
 
 
 
@@ -19,8 +23,12 @@ std::map<std::string, Owned<Global_scope>> global_scopes;
 // If the name already has a global scope, return that instead.
 Shared<Global_scope> parse_file(const std::string& file)
 {
-    if (global_scopes[file] != nullptr) return global_scopes[file]; // do this before get_tokens_from_file()
-    return parse_tokens(get_tokens_from_file(file), file);
+    if (global_scopes[file] != nullptr) {
+        // the compile server resets the operators between requests, so the file's own operators might be gone
+        for (int symbol : global_scopes[file]->infix_operators) register_infix_operator(symbol);
+        return global_scopes[file]; // do this before get_cached_tokens()
+    }
+    return parse_tokens(get_cached_tokens(file), file); // loads the tokens from the token cache, if it's up to date
 }
 
 Shared<Global_scope> parse_string(const std::string& string, const std::string& name, const Token_context& context)
@@ -28,7 +36,8 @@ Shared<Global_scope> parse_string(const std::string& string, const std::string&
     ASSERT(string != "");
     ASSERT(name != "");
     if (global_scopes[name] != nullptr) return global_scopes[name]; // do this before get_tokens_from_string()
-    Shared<Global_scope> gs = parse_tokens(get_tokens_from_string(string), name);
+    Shared<Global_scope> gs = read_global_scope(get_tokens_from_string(string), name);
+    if (gs == nullptr) return nullptr;
     gs->context = context;
     gs->fully_parse(); // read statements
     return gs;
@@ -65,6 +74,37 @@ Shared<Global_scope> read_global_scope(Seq<Token>&& tokens, const std::string& n
 
 
 
+std::vector<std::string> parsed_files()
+{
+    std::vector<std::string> names;
+    for (const auto& gs : global_scopes) {
+        if (gs.second != nullptr) names.push_back(gs.first); // parse_file() adds empty entries
+    }
+    return names;
+}
+
+void invalidate_file(const std::string& name)
+{
+    auto it = global_scopes.find(name);
+    if (it == global_scopes.end() || it->second == nullptr) return;
+    Shared<Global_scope> invalid = it->second;
+
+    // files that imports this file refers to its identifiers -> they have to be parsed again as well
+    std::vector<std::string> importers;
+    for (const auto& gs : global_scopes) {
+        if (gs.second == nullptr || gs.second.v == invalid.v) continue;
+        for (const auto& scope : gs.second->imported_scopes) {
+            if (scope->global_scope().v == invalid.v) importers.push_back(gs.first);
+        }
+    }
+
+    invalidated_scopes.add(std::move(it->second));
+    global_scopes.erase(it);
+    for (const auto& importer : importers) invalidate_file(importer);
+}
+
+
+
 
 
 
@@ -1,11 +1,13 @@
 #pragma once
 
 #include "../abstx/abstx_scope.h"
+#include "../abstx/expressions/abstx_function.h" // Abstx_function_literal::Generic_bindings
 // #include "../abstx/statements/abstx_function_call.h"
 #include "token.h"
 #include "token_iterator.h"
 
 #include <string>
+#include <vector>
 
 #include "../utilities/sequence.h"
 #include "../utilities/pointers.h"
@@ -43,6 +45,9 @@ Step 2: Statement::fully_parse(), read_value_expression, read_variable_expressio
         If a statement cannot be resolved with DEPENDENCIES_NEEDED, add it to the list and try to resolve the next statement.
     For dynamic scopes, statments must be resolved in order. If parsing fails with DEPENDENCIES_NEEDED, return and try again from the beginning later
 
+    Function scopes are not read in this step. They stay PARTIALLY_PARSED until the function is reached from main or a #run statement,
+        and are then read by Global_scope::parse_reached_functions()
+
 
 */
 
@@ -65,6 +70,8 @@ Shared<Global_scope> parse_file(const std::string& file_name);
 Shared<Global_scope> parse_string(const std::string& string, const std::string& string_name, const Token_context& context);
 Shared<Global_scope> parse_tokens(Seq<Token>&& tokens, const std::string& name);
 Shared<Global_scope> read_global_scope(Seq<Token>&& tokens, const std::string& name);
+std::vector<std::string> parsed_files(); // the names of all stored global scopes
+void invalidate_file(const std::string& name); // removes the stored global scope, and the global scopes of all files that imports it. They are kept in memory, but never reused.
 
 
 // temporary variable names should be named _cb_tmp_uid, so we can be sure that they won't nameclash with other things
@@ -78,7 +85,7 @@ Parsing_status read_statement(Token_iterator& it, Shared<Abstx_scope> parent_sco
 // read as many statements as possible in the current scope
 Parsing_status read_scope_statements(Token_iterator& it, Shared<Abstx_scope> scope);
 
-Parsing_status read_anonymous_scope(Token_iterator& it, Shared<Abstx_scope> parent_scope);
+Parsing_status read_anonymous_scope(Token_iterator& it, Shared<Abstx_scope> parent_scope, bool arena = false);
 Parsing_status read_if_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
 Parsing_status read_for_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
 Parsing_status read_while_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
@@ -86,29 +93,48 @@ Parsing_status read_return_statement(Token_iterator& it, Shared<Abstx_scope> par
 Parsing_status read_defer_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
 Parsing_status read_using_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
 Parsing_status read_c_code_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
+Parsing_status read_async_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
 Parsing_status read_declaration_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
 Parsing_status read_assignment_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
 Parsing_status read_value_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
+Parsing_status read_channel_send_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
+Parsing_status read_channel_receive_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope);
 
 // maybe should this also return only Parsing_status?
 Shared<Abstx_function_call> read_run_expression(Token_iterator& it, Shared<Abstx_scope> parent_scope);
 
-#define DEFAULT_OPERATOR_PRIO 1000
+#define DEFAULT_OPERATOR_PRIO -1 // lower than all operators (see operator_table.h); higher priority binds tighter
 
 // standalone expressions
 Owned<Value_expression> read_value_expression(Token_iterator& it, Shared<Abstx_node> owner, int min_operator_prio = DEFAULT_OPERATOR_PRIO);
 Owned<Variable_expression> read_variable_expression(Token_iterator& it, Shared<Abstx_node> owner, int min_operator_prio = DEFAULT_OPERATOR_PRIO);
-Owned<Value_expression> read_sequence_literal(Token_iterator& it, Shared<Abstx_node> owner); // starts with "["
+Owned<Value_expression> read_sequence_literal(Token_iterator& it, Shared<Abstx_node> owner); // starts with "["; also reads map types and literals
 Owned<Value_expression> read_simple_literal(Token_iterator& it, Shared<Abstx_node> owner); // a single INTEGER/FLOAT/STRING/BOOL token
 Owned<Value_expression> read_struct_literal(Token_iterator& it, Shared<Abstx_node> owner); // starts with "struct"
 Owned<Value_expression> read_identifier_reference(Token_iterator& it, Shared<Abstx_node> owner); // a single IDENTIFIER token
 Owned<Value_expression> read_fn_literal(Token_iterator& it, Shared<Abstx_node> owner); // starts with "fn"
-Owned<Value_expression> read_function_literal(Token_iterator& it, Shared<Abstx_node> owner); // function literal with named variables and function scope (called from read_fn_literal)
+Owned<Value_expression> read_function_literal(Token_iterator& it, Shared<Abstx_node> owner, const Abstx_function_literal::Generic_bindings* bindings = nullptr); // function literal with named variables and function scope (called from read_fn_literal)
 Owned<Value_expression> read_function_type(Token_iterator& it, Shared<Abstx_node> owner); // function type literal with only type expressions (called from read_fn_literal)
+Owned<Value_expression> read_channel_literal(Token_iterator& it, Shared<Abstx_node> owner); // starts with "chan"
+Owned<Value_expression> read_channel_receive(Token_iterator& it, Shared<Abstx_node> owner); // starts with "<-"
+
+// the specialization of a generic function for the given arguments; created once and shared by all calls (see CB_Generic_function)
+Shared<Abstx_function_literal> get_specialization(Shared<Abstx_function_literal> generic, const Seq<Owned<Value_expression>>& in_args, const Token_context& context);
 
 // suffix expressions
 Owned<Variable_expression> read_function_call(Token_iterator& it, Shared<Abstx_node> owner, Owned<Variable_expression>&& fn_id, const Seq<Shared<Variable_expression>>& lhs = {}, Owned<Value_expression>&& first_arg = nullptr); // suffix "()"
 Owned<Value_expression> read_getter(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& id); // suffix '.'
+Owned<Value_expression> read_map_index(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& map); // suffix "[]" on a map
+Owned<Value_expression> read_seq_index(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& seq); // suffix "[]" on a sequence
+Owned<Value_expression> read_vector_constructor(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& type_expr); // suffix "()" on a vector type
+
+// prefix expressions
+Owned<Value_expression> read_prefix_operator(Token_iterator& it, Shared<Abstx_node> owner, int op_prio); // built-in prefix operator, e.g. "-"
+
+// infix expressions
+Owned<Value_expression> read_infix_operator(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& lhs, int op_prio); // built-in infix operator
+Owned<Value_expression> read_user_infix_operator(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& lhs, int op_prio); // infix operator declared with infix_operator
+Owned<Value_expression> read_less_than_negative(Token_iterator& it, Shared<Abstx_node> owner, Owned<Value_expression>&& lhs, int op_prio); // "<-" after an operand: lhs < -rhs
 // Owned<Value_expression> read_indexing(Token_iterator& it, Shared<Abstx_scope> parent_scope, Owned<Value_expression>&& id); // suffix "[]" // @todo
 
 /*
@@ -1,7 +1,9 @@
 #include "parser.h"
+#include "operator_table.h"
 // all types of statements are needed for static casts
 #include "../abstx/statements/abstx_assignment.h"
 #include "../abstx/statements/abstx_c_code.h"
+#include "../abstx/statements/abstx_channel_send.h"
 #include "../abstx/statements/abstx_declaration.h"
 #include "../abstx/statements/abstx_defer.h"
 #include "../abstx/statements/abstx_for.h"
@@ -10,6 +12,12 @@
 #include "../abstx/statements/abstx_return.h"
 #include "../abstx/statements/abstx_using.h"
 #include "../abstx/statements/abstx_while.h"
+#include "../abstx/expressions/abstx_identifier_reference.h"
+#include "../abstx/expressions/abstx_struct_getter.h"
+#include "../abstx/expressions/abstx_map.h"
+#include "../abstx/expressions/abstx_vector.h"
+#include "../abstx/expressions/abstx_seq_index.h"
+#include "../abstx/expressions/abstx_pointer_dereference.h"
 #include "../abstx/abstx_scope.h"
 
 
@@ -46,6 +54,15 @@ Parsing_status read_statement(Token_iterator& it, Shared<Abstx_scope> parent_sco
         // nested scope
         return read_anonymous_scope(it, parent_scope);
 
+    } else if (it.compare(Token_type::COMPILER_COMMAND, "#arena")) {
+        // nested scope with arena allocation
+        it.eat_token(); // eat the #arena token
+        if (!it.compare(Token_type::SYMBOL, "{")) {
+            log_error("Expected a scope after #arena", it->context);
+            return Parsing_status::SYNTAX_ERROR;
+        }
+        return read_anonymous_scope(it, parent_scope, true);
+
     } else if (it.compare(Token_type::KEYWORD, "if")) {
         // if statement
         return read_if_statement(it, parent_scope);
@@ -70,6 +87,10 @@ Parsing_status read_statement(Token_iterator& it, Shared<Abstx_scope> parent_sco
         // using statement
         return read_using_statement(it, parent_scope);
 
+    } else if (it.compare(Token_type::KEYWORD, "async")) {
+        // async function call
+        return read_async_statement(it, parent_scope);
+
     } else if (it.compare(Token_type::COMPILER_COMMAND, "#c")) {
         // c code statement
         return read_c_code_statement(it, parent_scope);
@@ -77,13 +98,15 @@ Parsing_status read_statement(Token_iterator& it, Shared<Abstx_scope> parent_sco
     } else if (it.compare(Token_type::COMPILER_COMMAND, "#run")) {
         // the next token must be the start of a function call expression
         auto s = read_run_expression(it, parent_scope);
-        if (s != nullptr) {
-            it.expect_end_of_statement();
-            if (it.expect_failed()) {
-                add_note("In #run statement that started here", s->context);
-                s->status = Parsing_status::FATAL_ERROR;
-            }
+        if (s == nullptr) return Parsing_status::FATAL_ERROR; // the tokens of the expression are already eaten
+        it.expect_end_of_statement();
+        if (it.expect_failed()) {
+            add_note("In #run statement that started here", s->context);
+            s->status = Parsing_status::FATAL_ERROR;
         }
+        // other errors are kept in the statement, which is then never evaluated (see run_wave())
+        //   static scopes only stop reading at fatal errors, and report the rest when the statements are resolved
+        if (!parent_scope->dynamic() && !is_fatal(s->status)) return Parsing_status::PARTIALLY_PARSED;
         return s->status;
 
     } else {
@@ -118,6 +141,12 @@ Parsing_status read_statement(Token_iterator& it, Shared<Abstx_scope> parent_sco
                     return read_value_statement(it, parent_scope);
                 }
 
+                else if (t.token == "<-" && it.current_index-1 != start_index) {
+                    // channel send statement (if it's the first token, it's a receive)
+                    it.current_index = start_index;
+                    return read_channel_send_statement(it, parent_scope);
+                }
+
                 else if (t.token == "(") it.current_index = it.find_matching_paren(it.current_index-1) + 1; // go back to the previous "(" and search from there
                 else if (t.token == "[") it.current_index = it.find_matching_bracket(it.current_index-1) + 1;
                 else if (t.token == "{") it.current_index = it.find_matching_brace(it.current_index-1) + 1;
@@ -188,7 +217,8 @@ Parsing_status read_scope_statements(Token_iterator& it, Shared<Abstx_scope> sco
 
 // syntax:
 // { }
-Owned<Abstx_scope> read_scope(Token_iterator& it, Shared<Abstx_scope> parent_scope) {
+// if arena is set, the scope begins a new arena (see backend_c/cb_arena.h)
+Owned<Abstx_scope> read_scope(Token_iterator& it, Shared<Abstx_scope> parent_scope, bool arena = false) {
     // @todo: if dynamic: fully resolve statements immediately
     // @todo: write function continue_parse_scope() that can finish parsing a scope that is not fully parsed
 
@@ -199,9 +229,14 @@ Owned<Abstx_scope> read_scope(Token_iterator& it, Shared<Abstx_scope> parent_sco
     scope->set_owner(parent_scope);
     scope->context = it->context;
     scope->start_token_index = it.current_index;
+    if (arena) {
+        // set before the statements are read, so inner scopes inherits the flag
+        scope->flags += SCOPE_ARENA;
+        scope->arena_uid = get_unique_id();
+    }
 
     if (scope->dynamic()) {
-        // parse and resolve all statements in the scope
+        // parse and resolve all statements in the scope; this also sets the status
         read_scope_statements(it, scope);
     } else {
         // just find closing brace / don't read statements
@@ -209,10 +244,9 @@ Owned<Abstx_scope> read_scope(Token_iterator& it, Shared<Abstx_scope> parent_sco
         if (it.expect_failed()) {
             scope->status = Parsing_status::FATAL_ERROR;
         }
+        if (!is_error(scope->status)) scope->status = Parsing_status::PARTIALLY_PARSED;
     }
 
-    if (!is_error(scope->status)) scope->status = Parsing_status::PARTIALLY_PARSED;
-
     return scope;
 }
 
@@ -220,7 +254,8 @@ Owned<Abstx_scope> read_scope(Token_iterator& it, Shared<Abstx_scope> parent_sco
 
 // syntax (dynamic scope only):
 // { }
-Parsing_status read_anonymous_scope(Token_iterator& it, Shared<Abstx_scope> parent_scope) {
+// #arena { }       // arena is set; the #arena token is already eaten
+Parsing_status read_anonymous_scope(Token_iterator& it, Shared<Abstx_scope> parent_scope, bool arena) {
     it.assert_current(Token_type::SYMBOL, "{"); // checked previously
 
     Owned<Abstx_anonymous_scope> o = alloc(Abstx_anonymous_scope()); // owned pointer, this will be destroyed when we move it into the scopes list of statments
@@ -238,7 +273,7 @@ Parsing_status read_anonymous_scope(Token_iterator& it, Shared<Abstx_scope> pare
 
     } else {
         // read scope
-        s->scope = read_scope(it, parent_scope);
+        s->scope = read_scope(it, parent_scope, arena);
         ASSERT(s->scope != nullptr);
         // s->scope->set_owner(s); // no need to update owner; parent_scope is good enough
         ASSERT(is_error(s->scope->status) || s->scope->status == Parsing_status::DEPENDENCIES_NEEDED || s->scope->status == Parsing_status::FULLY_RESOLVED);
@@ -312,7 +347,8 @@ Parsing_status read_declaration_statement(Token_iterator& it, Shared<Abstx_scope
     // expect ':' token
     // find end of statement (';')
 
-    // @todo operator declaration - they have a different identifier syntax
+    // infix_operator declarations have a different identifier syntax (see operator_table.h)
+    // @todo prefix and suffix operator declarations
 
     // LOG("reading declaration statement at " << it->context.toS());
 
@@ -343,13 +379,33 @@ Parsing_status read_declaration_statement(Token_iterator& it, Shared<Abstx_scope
             log_error("Operator overloading is not implemented yet!", it->context);
         }
 
-        const Token& t = it.expect(Token_type::IDENTIFIER);
-        if (it.expect_failed()) {
-            s->status = Parsing_status::SYNTAX_ERROR;
-            break;
+        if (it.compare(Token_type::IDENTIFIER, "infix_operator") && s->identifiers.size == 0) {
+            // infix_operator op :: fn(lhs: T1, rhs: T2)->(r: T3) { ... };
+            // the operator is registered immediately, so that it can be used in all statements that are parsed after this one
+            it.eat_token();
+            const Token& op = it.eat_token();
+            if ((op.type != Token_type::SYMBOL && op.type != Token_type::IDENTIFIER) || !register_infix_operator(op.symbol)) {
+                log_error("Unable to declare " + op.token + " as an infix operator", op.context);
+                if (op.type == Token_type::SYMBOL) add_note("Reserved symbols and built-in operators can't be declared as operators");
+                s->status = Parsing_status::SYNTAX_ERROR;
+                break;
+            }
+            parent_scope->global_scope()->infix_operators.add(op.symbol);
+            id->name = infix_operator_name(op.symbol);
+            if (!it.compare(Token_type::SYMBOL, ":")) {
+                log_error("An infix operator must be declared on its own", it->context);
+                s->status = Parsing_status::SYNTAX_ERROR;
+                break;
+            }
+        } else {
+            const Token& t = it.expect(Token_type::IDENTIFIER);
+            if (it.expect_failed()) {
+                s->status = Parsing_status::SYNTAX_ERROR;
+                break;
+            }
+            id->name = t.token;
         }
 
-        id->name = t.token;
         // check if there is another id with the same name in the current local scope (not allowed)
         auto old_id = parent_scope->get_identifier(id->name, false);
         if (old_id != nullptr) {
@@ -411,6 +467,11 @@ Parsing_status Abstx_declaration::fully_parse() {
     ASSERT(identifiers.size != 0);
     Token_iterator it = global_scope()->iterator(start_token_index); // starting with the first value after the ':' token
 
+    // the dependency graph restarts the statement if it failed with DEPENDENCIES_NEEDED
+    type_expressions.clear();
+    value_expressions.clear();
+    for (const auto& id : identifiers) id->value_expression = nullptr;
+
     // LOG("fully parsing declaration statement starting with token " << it->toS() << " at index " << it.current_index);
 
     // @todo: allow constant function calls as type identifiers
@@ -492,8 +553,9 @@ Parsing_status Abstx_declaration::fully_parse() {
         }
     }
 
+    bool constant = false;
     if (it.compare(Token_type::SYMBOL, "=") || it.compare(Token_type::SYMBOL, ":")) {
-        bool constant = it.compare(Token_type::SYMBOL, ":");
+        constant = it.compare(Token_type::SYMBOL, ":");
         it.eat_token(); // eat the ':'/'=' token
 
         // LOG("reading " << (constant?"constant":"non-constant") << " values in declaration");
@@ -504,6 +566,7 @@ Parsing_status Abstx_declaration::fully_parse() {
             status = rhs_status;
             return status;
         }
+        if (rhs_status == Parsing_status::DEPENDENCIES_NEEDED && !is_error(status)) status = rhs_status;
 
         // LOG("assigning " << (constant?"constant":"non-constant") << " values");
 
@@ -519,7 +582,7 @@ Parsing_status Abstx_declaration::fully_parse() {
             for (const auto& id : identifiers) {
                 // @todo (operators) the operator should already have a type - a function type with in arguments defined. Check that the types match and assign out argument types!
                 Shared<Value_expression> value_expr = value_expressions[index];
-                if (constant) {
+                if (constant && value_expr->status != Parsing_status::DEPENDENCIES_NEEDED) {
                     id->value_expression = value_expr;
                     // if not constant, then we cant be sure that the value_expr is the actual value used later (it might be overwritten)
                 }
@@ -567,6 +630,15 @@ Parsing_status Abstx_declaration::fully_parse() {
             ASSERT(id->status == Parsing_status::FULLY_RESOLVED);
         }
         status = Parsing_status::FULLY_RESOLVED;
+
+        // a function stored in a variable might be called from anywhere; constants are only reached if referenced
+        if (!constant) {
+            for (const auto& value_expr : value_expressions) {
+                if (dynamic_pointer_cast<const CB_Function>(value_expr->get_type()) && value_expr->has_constant_value()) {
+                    global_scope()->reach(value_expr->get_constant_value(), this);
+                }
+            }
+        }
     }
 
     return status;
@@ -663,6 +735,10 @@ Parsing_status Abstx_assignment::fully_parse() {
             ASSERT(value_expr); // can't be nullptr
             id->finalize();
             value_expr->finalize();
+            if (!is_error(id->status) && !check_shared_write((Shared<Variable_expression>)id, this)) status = Parsing_status::TYPE_ERROR;
+            if (Shared<Abstx_identifier_reference> ref = dynamic_pointer_cast<Abstx_identifier_reference>((Shared<Variable_expression>)id)) {
+                invalidate_loop_bounds(ref->id, this);
+            }
 
             // check that types match
             Shared<const CB_Type> lhs_type = id->get_type();
@@ -671,6 +747,10 @@ Parsing_status Abstx_assignment::fully_parse() {
             if (lhs_type == nullptr) {
                 ASSERT(is_error(id->status) || id->status == Parsing_status::DEPENDENCIES_NEEDED);
                 if (!is_error(status)) status = id->status;
+            } else if (is_codegen_ready(id->status) && id->has_constant_value()) {
+                // constants are propagated into their uses (see compile_time/constant_folding.h) -> they must never change
+                log_error("Unable to assign a value to a constant", id->context);
+                status = Parsing_status::TYPE_ERROR;
             } else if (rhs_type == nullptr) {
                 ASSERT(is_error(id->status) || id->status == Parsing_status::DEPENDENCIES_NEEDED);
                 if (!is_error(status)) status = id->status;
@@ -762,6 +842,7 @@ Parsing_status read_if_statement(Token_iterator& it, Shared<Abstx_scope> parent_
 
     if (!is_error(o->status)) {
         o->status = Parsing_status::PARTIALLY_PARSED;
+        if (parent_scope->dynamic()) o->fully_parse(); // the scopes are already resolved; this finalizes the conditions
     }
 
     LOG("Read if statement with status " << o->status << " at " << o->context.toS());
@@ -772,7 +853,9 @@ Parsing_status read_if_statement(Token_iterator& it, Shared<Abstx_scope> parent_
     return status;
 }
 
-// temporary implementations, TODO: implement these
+// syntax:
+// for (n in range, step=2, reverse) { }
+// for #parallel (n in range, reduce(+: sum)) { }
 Parsing_status read_for_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope) {
     it.assert(Token_type::KEYWORD, "for");
 
@@ -780,12 +863,118 @@ Parsing_status read_for_statement(Token_iterator& it, Shared<Abstx_scope> parent
     o->set_owner(parent_scope);
     o->context = it->context;
     o->start_token_index = it.current_index;
+    o->uid = get_unique_id();
 
-    // it.expect(Token_type::SYMBOL, "(");
+    o->parallel = it.eat_conditonal(Token_type::COMPILER_COMMAND, "#parallel");
 
-    log_error("For statement not yet implemented!", o->context);
-    o->status = Parsing_status::SYNTAX_ERROR;
-    it.eat_token(); // eat token for now to ensure we don't get stuck in an infinite loop
+    int header_end = it.find_matching_paren();
+    if (it.expect_failed()) {
+        o->status = Parsing_status::FATAL_ERROR;
+        return o->status;
+    }
+
+    if (!parent_scope->dynamic()) {
+        log_error("For statement used in static scope", o->context);
+        o->status = Parsing_status::SYNTAX_ERROR;
+    } else {
+        it.expect(Token_type::SYMBOL, "(");
+
+        // the iterator variable, declared in the loop scope
+        o->it = alloc(Abstx_identifier());
+        o->it->context = it->context;
+        o->it->start_token_index = it.current_index;
+        o->it->name = it.expect(Token_type::IDENTIFIER).token;
+        if (!it.expect_failed() && it.eat_conditonal(Token_type::SYMBOL, ",")) {
+            // for (key, value in map)
+            o->key = std::move(o->it);
+            o->it = alloc(Abstx_identifier());
+            o->it->context = it->context;
+            o->it->start_token_index = it.current_index;
+            o->it->name = it.expect(Token_type::IDENTIFIER).token;
+        }
+        it.expect(Token_type::KEYWORD, "in");
+
+        if (!it.expect_failed()) o->range = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+
+        while (!it.expect_failed() && it.eat_conditonal(Token_type::SYMBOL, ",")) {
+            const Token& t = it.expect(Token_type::IDENTIFIER);
+            if (it.expect_failed()) break;
+
+            if (t.token == "reverse") {
+                o->reverse = true;
+
+            } else if (t.token == "step") {
+                it.expect(Token_type::SYMBOL, "=");
+                const Token& st = it.expect(Token_type::INTEGER);
+                if (it.expect_failed()) break;
+                if (st.token[0] == '-' || std::stoull(st.token) == 0) {
+                    log_error("For loop step must be positive", st.context);
+                    o->status = Parsing_status::SYNTAX_ERROR;
+                } else {
+                    o->step = std::stoull(st.token);
+                }
+
+            } else if (t.token == "reduce") {
+                Abstx_for::Reduction r;
+                r.context = t.context;
+                it.expect(Token_type::SYMBOL, "(");
+                const Token& op = it.eat_token();
+                if (op.token == "+" || op.token == "*" || op.token == "min" || op.token == "max") {
+                    r.op = op.token;
+                } else {
+                    log_error("Unknown reduction operator \""+op.token+"\"", op.context);
+                    add_note("Expected one of + * min max");
+                    o->status = Parsing_status::SYNTAX_ERROR;
+                }
+                it.expect(Token_type::SYMBOL, ":");
+                const Token& id_token = it.expect(Token_type::IDENTIFIER);
+                it.expect(Token_type::SYMBOL, ")");
+                if (it.expect_failed()) break;
+                r.id = parent_scope->get_identifier(id_token.token);
+                if (r.id == nullptr) {
+                    log_error("Use of undeclared identifier "+id_token.token+" in reduction", id_token.context);
+                    o->status = Parsing_status::UNDECLARED_IDENTIFIER;
+                } else if (!o->parallel) {
+                    log_error("Reductions are only allowed in parallel for loops", r.context);
+                    o->status = Parsing_status::SYNTAX_ERROR;
+                } else {
+                    o->reductions.add(r);
+                }
+
+            } else {
+                log_error("Unknown for loop option \""+t.token+"\"", t.context);
+                add_note("Expected step=N, reverse or reduce(op: identifier)");
+                o->status = Parsing_status::SYNTAX_ERROR;
+            }
+        }
+
+        if (!it.expect_failed()) it.expect(Token_type::SYMBOL, ")");
+        if (it.expect_failed() && !is_error(o->status)) o->status = Parsing_status::SYNTAX_ERROR;
+    }
+    it.current_index = header_end + 1; // also recovers from syntax errors in the header
+
+    // the loop scope is read in fully_parse(), after the type of the iterator is known
+    it.expect_current(Token_type::SYMBOL, "{");
+    if (it.expect_failed()) {
+        add_note("In for statement here", o->context);
+        o->status = Parsing_status::FATAL_ERROR;
+        return o->status;
+    }
+    o->scope = alloc(Abstx_for_scope(parent_scope->flags));
+    o->scope->set_owner(static_pointer_cast<Abstx_node>(o));
+    o->scope->context = it->context;
+    o->scope->start_token_index = it.current_index;
+    o->scope->status = Parsing_status::PARTIALLY_PARSED;
+    if (o->it) o->it->set_owner(static_pointer_cast<Abstx_node>(o->scope));
+    if (o->key) o->key->set_owner(static_pointer_cast<Abstx_node>(o->scope));
+
+    it.current_index = it.find_matching_brace() + 1;
+    if (it.expect_failed()) o->status = Parsing_status::FATAL_ERROR;
+
+    if (!is_error(o->status)) {
+        o->status = Parsing_status::PARTIALLY_PARSED;
+        o->fully_parse();
+    }
 
     Parsing_status status = o->status;
     parent_scope->statements.add(std::move(owned_static_cast<Statement>(std::move(o))));
@@ -901,6 +1090,9 @@ Parsing_status read_c_code_statement(Token_iterator& it, Shared<Abstx_scope> par
     }
 
     if (!is_error(o->status)) o->status = Parsing_status::FULLY_RESOLVED;
+    invalidate_loop_bounds(nullptr, static_pointer_cast<Abstx_node>(o)); // the c code can do anything
+    Shared<Abstx_function_literal> fn = o->parent_function();
+    if (fn && fn->side_effect == nullptr) fn->side_effect = static_pointer_cast<Abstx_node>(o);
     Parsing_status status = o->status;
     parent_scope->statements.add(owned_static_cast<Statement>(std::move(o)));
     return status;
@@ -925,6 +1117,8 @@ Parsing_status Abstx_c_code::fully_parse() {
 
 
 Parsing_status read_value_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope) {
+    if (it.compare(Token_type::SYMBOL, "<-")) return read_channel_receive_statement(it, parent_scope);
+
     Owned<Value_expression> expr = read_value_expression(it, static_pointer_cast<Abstx_node>(parent_scope));
     Shared<Abstx_function_call_expression> fc = dynamic_pointer_cast<Abstx_function_call_expression>(expr);
     if (expr != nullptr && fc == nullptr) {
@@ -942,10 +1136,160 @@ Parsing_status read_value_statement(Token_iterator& it, Shared<Abstx_scope> pare
 }
 
 
+Parsing_status read_channel_send_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope) {
+    if (!parent_scope->dynamic()) {
+        log_error("Channel send statements are not allowed in static scopes", it->context);
+        it.current_index = it.find_matching_semicolon()+1;
+        if (it.expect_failed()) return Parsing_status::FATAL_ERROR;
+        else return Parsing_status::NOT_PARSED;
+    }
+
+    Owned<Abstx_channel_send> o = alloc(Abstx_channel_send());
+    o->set_owner(parent_scope);
+    o->context = it->context;
+    o->start_token_index = it.current_index;
+
+    o->channel = read_value_expression(it, static_pointer_cast<Abstx_node>(o), get_operator(intern_symbol("<-")).infix.prio); // stop before "<-"
+    it.expect(Token_type::SYMBOL, "<-");
+    if (o->channel == nullptr || it.expect_failed()) {
+        o->status = Parsing_status::SYNTAX_ERROR;
+    }
+    if (!is_error(o->status)) {
+        o->value = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+        if (o->value == nullptr) o->status = Parsing_status::SYNTAX_ERROR;
+    }
+
+    it.expect_end_of_statement();
+    if (it.expect_failed()) {
+        add_note("In channel send statement here", o->context);
+        if (!is_fatal(o->status)) o->status = Parsing_status::SYNTAX_ERROR;
+    }
+
+    // perform type checking
+    o->fully_parse();
+
+    Parsing_status status = o->status;
+    parent_scope->statements.add(owned_static_cast<Statement>(std::move(o)));
+    return status;
+}
+
+Parsing_status read_channel_receive_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope) {
+    if (!parent_scope->dynamic()) {
+        log_error("Channel receive statements are not allowed in static scopes", it->context);
+        it.current_index = it.find_matching_semicolon()+1;
+        if (it.expect_failed()) return Parsing_status::FATAL_ERROR;
+        else return Parsing_status::NOT_PARSED;
+    }
+
+    Owned<Abstx_channel_receive_statement> o = alloc(Abstx_channel_receive_statement());
+    o->set_owner(parent_scope);
+    o->context = it->context;
+    o->start_token_index = it.current_index;
+
+    o->receive = read_value_expression(it, static_pointer_cast<Abstx_node>(o));
+    if (o->receive == nullptr) o->status = Parsing_status::SYNTAX_ERROR;
+
+    it.expect_end_of_statement();
+    if (it.expect_failed()) {
+        add_note("In channel receive statement here", o->context);
+        if (!is_fatal(o->status)) o->status = Parsing_status::SYNTAX_ERROR;
+    }
+
+    o->fully_parse();
+
+    Parsing_status status = o->status;
+    parent_scope->statements.add(owned_static_cast<Statement>(std::move(o)));
+    return status;
+}
+
+Parsing_status Abstx_channel_send::fully_parse() {
+    if (is_error(status) || is_codegen_ready(status)) return status;
+    ASSERT(channel);
+    ASSERT(value);
+
+    channel->finalize();
+    value->finalize();
+    for (const auto& expr : { channel.v, value.v }) {
+        if (is_error(expr->status) || expr->status == Parsing_status::DEPENDENCIES_NEEDED) {
+            status = expr->status;
+            return status;
+        }
+    }
+
+    Shared<const CB_Channel> ct = dynamic_pointer_cast<const CB_Channel>(channel->get_type());
+    if (ct == nullptr) {
+        log_error("Send to non-channel expression", channel->context);
+        add_note("Expression has type " + channel->get_type()->toS());
+        status = Parsing_status::TYPE_ERROR;
+    } else if (*ct->v_type != *value->get_type()) {
+        log_error("Type of sent value doesn't match the channel type", value->context);
+        add_note("Unable to convert type from " + value->get_type()->toS() + " to " + ct->v_type->toS());
+        status = Parsing_status::TYPE_ERROR;
+    } else {
+        status = Parsing_status::FULLY_RESOLVED;
+    }
+    return status;
+}
+
+
+Parsing_status read_async_statement(Token_iterator& it, Shared<Abstx_scope> parent_scope) {
+    // syntax: async function_call();
+    // the call is submitted to the thread pool of the generated program (see backend_c/cb_async.h)
+    Token_context context = it->context;
+    it.assert(Token_type::KEYWORD, "async");
+
+    if (!parent_scope->dynamic()) {
+        log_error("Async function calls are not allowed in static scopes", context);
+        it.current_index = it.find_matching_semicolon()+1;
+        if (it.expect_failed()) return Parsing_status::FATAL_ERROR;
+        return Parsing_status::SYNTAX_ERROR;
+    }
+
+    Owned<Value_expression> expr = read_value_expression(it, static_pointer_cast<Abstx_node>(parent_scope));
+    Shared<Abstx_function_call_expression> fc = dynamic_pointer_cast<Abstx_function_call_expression>(expr);
+    if (fc == nullptr) {
+        log_error("Expected function call after async", context);
+        return Parsing_status::SYNTAX_ERROR;
+    }
+    Shared<Abstx_function_call> call = fc->function_call;
+    ASSERT(call);
+    call->async = true;
+
+    // the caller doesn't wait for the call to finish, so there is nothing to return into
+    if (call->out_args.size > 0) {
+        log_error("Async function calls can not return anything", context);
+        call->status = Parsing_status::TYPE_ERROR;
+    }
+
+    it.expect_end_of_statement();
+    if (it.expect_failed()) {
+        add_note("In async statement that started here", context);
+        call->status = Parsing_status::FATAL_ERROR;
+    }
+    return call->status;
+}
+
+
 // maybe should this also return only Parsing_status?
 Shared<Abstx_function_call> read_run_expression(Token_iterator& it, Shared<Abstx_scope> parent_scope) {
-    ASSERT(false, "NYI");
-    return nullptr;
+    // syntax: #run function_call();
+    // the function call statement is added to the parent scope by read_function_call(), just like any other function call
+    // it is also added to the list of #run statements in the global scope, where it's evaluated in batches (see compile_time/run_batch.h)
+    Token_context context = it->context;
+    it.assert(Token_type::COMPILER_COMMAND, "#run");
+
+    Owned<Value_expression> expr = read_value_expression(it, static_pointer_cast<Abstx_node>(parent_scope));
+    Shared<Abstx_function_call_expression> fc = dynamic_pointer_cast<Abstx_function_call_expression>(expr);
+    if (fc == nullptr) {
+        log_error("Expected function call after #run", context);
+        return nullptr;
+    }
+    Shared<Abstx_function_call> call = fc->function_call;
+    ASSERT(call);
+    call->compile_time = true;
+    parent_scope->global_scope()->run_statements.add(call);
+    parent_scope->global_scope()->dependencies.add_node(static_pointer_cast<Statement>(call), true); // not done until it's evaluated
+    return call;
 }
 
 
@@ -1040,14 +1384,151 @@ Parsing_status Abstx_while::fully_parse() {
 }
 
 Parsing_status Abstx_for::fully_parse() {
-    if (is_codegen_ready(status)) return status;
-    // @TODO implement
-    // we reached the end -> we are done
-    // status = Parsing_status::FULLY_RESOLVED;
+    if (is_error(status) || is_codegen_ready(status)) return status;
+    ASSERT(range);
+    ASSERT(it);
+    ASSERT(scope);
+
+    // range
+    range->finalize();
+    if (is_error(range->status)) {
+        status = range->status;
+        return status;
+    }
+    iterable_type = dynamic_pointer_cast<const CB_Iterable>(range->get_type());
+    if (iterable_type == nullptr) {
+        log_error("For loop over non-iterable expression", range->context);
+        add_note("Expression has type " + range->get_type()->toS());
+        status = Parsing_status::TYPE_ERROR;
+        return status;
+    }
+    if (parallel && !iterable_type->parallel_iterable()) {
+        log_error("Parallel for loop over " + range->get_type()->toS() + " is not supported", range->context);
+        add_note("Parallel for loops require a range or a sequence");
+        status = Parsing_status::TYPE_ERROR;
+        return status;
+    }
+
+    if (key && iterable_type->get_key_type() == nullptr) {
+        log_error("For loop with a key over " + range->get_type()->toS(), key->context);
+        add_note("Only maps and sequences have keys");
+        status = Parsing_status::TYPE_ERROR;
+        return status;
+    }
+    if (key && (step != 1 || reverse)) {
+        log_error("For loop with a key can't have a step or be reversed", context);
+        status = Parsing_status::TYPE_ERROR;
+        return status;
+    }
+    if (!iterable_type->ordered() && (step != 1 || reverse)) {
+        log_error("For loop over " + range->get_type()->toS() + " can't have a step or be reversed", context);
+        add_note("The elements have no particular order");
+        status = Parsing_status::TYPE_ERROR;
+        return status;
+    }
+
+    // reductions
+    for (const auto& r : reductions) {
+        Shared<Abstx_scope> s = r.id->parent_scope();
+        if (s == nullptr || !s->dynamic() || r.id->by_pointer) {
+            log_error("Reduction variable " + r.id->name + " must be a local variable", r.context);
+            add_note("Declared here", r.id->context);
+            status = Parsing_status::TYPE_ERROR;
+        } else if (!is_reducible_type(r.id->get_type())) {
+            log_error("Reduction variable " + r.id->name + " must have a numeric type", r.context);
+            if (r.id->get_type()) add_note("Variable has type " + r.id->get_type()->toS());
+            status = Parsing_status::TYPE_ERROR;
+        }
+    }
+    if (is_error(status)) return status;
+
+    // iterator
+    it->value.v_type = iterable_type->get_iterator_type();
+    it->status = Parsing_status::FULLY_RESOLVED;
+    if (iterable_type->iterator_is_index()) {
+        it->iterated_by = iterable_type;
+        it->iterated_range = range_name();
+    }
+    scope->identifiers[it->name] = (Shared<Abstx_identifier>)it;
+    if (key) {
+        if (key->name == it->name) {
+            log_error("Key and value in for loop have the same name", key->context);
+            status = Parsing_status::SYNTAX_ERROR;
+            return status;
+        }
+        key->value.v_type = iterable_type->get_key_type();
+        key->status = Parsing_status::FULLY_RESOLVED;
+        scope->identifiers[key->name] = (Shared<Abstx_identifier>)key;
+    }
+
+    // scope; shared writes in parallel loops are caught by the statements themselves (see check_shared_write())
+    scope->fully_parse();
+    if (is_error(scope->status)) {
+        status = scope->status;
+        return status;
+    }
+    if (it->iterated_by) it->iterated_range = iterated_name(); // only known when the body is parsed
+
+    status = Parsing_status::FULLY_RESOLVED;
     return status;
 }
 
 
+// Checks that target is not a variable shared between the chunks of a parallel for loop that writer is inside of.
+// Returns false and logs an error if it is.
+bool check_shared_write(Shared<Variable_expression> target, Shared<Abstx_node> writer) {
+    // find the variable being written to
+    Shared<Abstx_identifier> id = nullptr;
+    bool through_pointer = false;
+    Seq<Shared<const Abstx_for>> element_loops; // loops whose key indexes the target -> each iteration writes to its own element
+    while (target != nullptr && id == nullptr) {
+        if (Shared<Abstx_identifier_reference> ref = dynamic_pointer_cast<Abstx_identifier_reference>(target)) id = ref->id;
+        else if (Shared<Abstx_identifier> i = dynamic_pointer_cast<Abstx_identifier>(target)) id = i;
+        else if (Shared<Abstx_pointer_dereference> deref = dynamic_pointer_cast<Abstx_pointer_dereference>(target)) {
+            id = deref->pointer_id;
+            through_pointer = true;
+        }
+        else if (Shared<Abstx_struct_getter> getter = dynamic_pointer_cast<Abstx_struct_getter>(target)) target = getter->struct_expr;
+        else if (Shared<Abstx_map_index> index = dynamic_pointer_cast<Abstx_map_index>(target)) target = dynamic_pointer_cast<Variable_expression>((Shared<Value_expression>)index->map);
+        else if (Shared<Abstx_vector_view> view = dynamic_pointer_cast<Abstx_vector_view>(target)) target = dynamic_pointer_cast<Variable_expression>((Shared<Value_expression>)view->seq);
+        else if (Shared<Abstx_seq_index> index = dynamic_pointer_cast<Abstx_seq_index>(target)) {
+            if (index->in_bounds() && index->bounds_loop) element_loops.add(index->bounds_loop);
+            target = dynamic_pointer_cast<Variable_expression>((Shared<Value_expression>)index->seq);
+        }
+        else return true; // not a named variable
+    }
+    if (id == nullptr) return true;
+
+    // writes that can be seen outside of the function
+    Shared<Abstx_scope> scope = id->parent_scope();
+    Shared<Abstx_function_literal> fn = writer->parent_function();
+    if (fn && fn->side_effect == nullptr && (through_pointer || scope == nullptr || !scope->dynamic())) fn->side_effect = writer;
+
+    for (Shared<Abstx_node> node = writer; node != nullptr; node = node->owner) {
+        Shared<Abstx_for_scope> fs = dynamic_pointer_cast<Abstx_for_scope>(node);
+        if (fs == nullptr) continue;
+        Shared<Abstx_for> loop = fs->loop();
+        if (loop == nullptr || !loop->parallel || loop->is_reduction(id)) continue;
+        if (through_pointer) {
+            log_error("Write through pointer " + id->name + " in parallel for loop", target->context);
+            add_note("The pointer might point to memory that is shared with other iterations", loop->context);
+            return false;
+        }
+        bool own_element = false;
+        for (const auto& l : element_loops) own_element = own_element || l.v == loop.v;
+        if (own_element) continue;
+        auto capture = fs->captures.find(id->name);
+        if (capture != fs->captures.end() && capture->second.v == id.v) {
+            log_error("Write to shared variable " + id->name + " in parallel for loop", target->context);
+            add_note("Declared outside the loop here", id->context);
+            add_note("Only variables declared inside the loop, reduction variables, and elements indexed by the key of the loop can be written to", loop->context);
+            return false;
+        }
+    }
+    return true;
+}
+
+
 
 /*
 
@@ -114,6 +114,7 @@ struct Token
     Token_type type = Token_type::UNKNOWN;
     std::string token{};
     Token_context context{};
+    int symbol = 0; // interned SYMBOL, IDENTIFIER or KEYWORD token; index in the operator table (see operator_table.h)
 
     Token() {}
     Token(const Token_type& type, const std::string token) : type{type}, token{token} {}
@@ -0,0 +1,223 @@
+#include "token_cache.h"
+#include "operator_table.h"
+#include "../lexer/lexer.h"
+#include "../runtime_dll/dll.h" // get_cache_dir(), compiler_build()
+#include "../utilities/hash.h"
+#include "../utilities/error_handler.h"
+
+#include <cstring> // memcmp, memcpy
+#include <cstdio> // rename, remove
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+namespace {
+
+const char TOKEN_CACHE_MAGIC[4] = { 'C', 'B', 'T', '\0' };
+const uint32_t TOKEN_CACHE_VERSION = 2; // increment when the layout changes; lexer changes are covered by the compiler build
+
+struct Token_cache_header {
+    char magic[4];
+    uint32_t version;
+    uint64_t compiler_build; // see dll::compiler_build()
+    uint64_t source_hash;
+    uint32_t token_count;
+    uint32_t string_size;
+};
+
+struct Cached_token {
+    uint32_t type; // Token_type
+    int32_t line;
+    int32_t position;
+    uint32_t string_offset;
+    uint32_t string_length;
+};
+
+// a read-only view of a whole file
+struct Mapped_file {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    void* handle = nullptr; // platform specific
+};
+
+} // namespace
+
+
+
+#ifdef __WIN32
+
+#include <windows.h>
+
+static bool map_file(const std::string& file_name, Mapped_file& file)
+{
+    HANDLE h = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    HANDLE mapping = GetFileSizeEx(h, &size) && size.QuadPart > 0 ? CreateFileMappingA(h, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    CloseHandle(h); // the mapping keeps the file open
+    if (mapping == NULL) return false;
+    file.data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (file.data == nullptr) {
+        CloseHandle(mapping);
+        return false;
+    }
+    file.size = size.QuadPart;
+    file.handle = mapping;
+    return true;
+}
+
+static void unmap_file(Mapped_file& file)
+{
+    UnmapViewOfFile(file.data);
+    CloseHandle((HANDLE)file.handle);
+    file = Mapped_file();
+}
+
+#else
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static bool map_file(const std::string& file_name, Mapped_file& file)
+{
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void* data = fstat(fd, &st) == 0 && st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED) return false;
+    file.data = (const uint8_t*)data;
+    file.size = st.st_size;
+    return true;
+}
+
+static void unmap_file(Mapped_file& file)
+{
+    munmap((void*)file.data, file.size);
+    file = Mapped_file();
+}
+
+#endif
+
+
+
+std::string token_cache_file_name(const std::string& source_file)
+{
+    return dll::get_cache_dir() + "/_cb_tokens_" + hash_to_string(hash_string(source_file)) + ".cbt";
+}
+
+
+bool read_token_cache(const std::string& source_file, uint64_t source_hash, Seq<Token>& tokens)
+{
+    Mapped_file file;
+    if (!map_file(token_cache_file_name(source_file), file)) return false;
+
+    // validate the header and the sizes before reading anything else
+    Token_cache_header header;
+    bool valid = file.size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, file.data, sizeof(header));
+        valid = memcmp(header.magic, TOKEN_CACHE_MAGIC, sizeof(TOKEN_CACHE_MAGIC)) == 0
+            && header.version == TOKEN_CACHE_VERSION
+            && header.compiler_build == dll::compiler_build()
+            && header.source_hash == source_hash
+            && header.token_count > 0
+            && file.size == sizeof(header) + (uint64_t)header.token_count * sizeof(Cached_token) + header.string_size;
+    }
+
+    if (valid) {
+        const uint8_t* token_data = file.data + sizeof(header);
+        const char* strings = (const char*)(token_data + header.token_count * sizeof(Cached_token));
+        tokens.clear();
+        tokens.reallocate(header.token_count);
+        for (uint32_t i = 0; i < header.token_count && valid; ++i) {
+            Cached_token mt;
+            memcpy(&mt, token_data + i * sizeof(Cached_token), sizeof(mt)); // the mapping is not guaranteed to be aligned
+            if ((uint64_t)mt.string_offset + mt.string_length > header.string_size || mt.type > (uint32_t)Token_type::EOF) {
+                valid = false;
+                break;
+            }
+            Token t;
+            t.type = (Token_type)mt.type;
+            t.token.assign(strings + mt.string_offset, mt.string_length);
+            t.context.file = source_file;
+            t.context.line = mt.line;
+            t.context.position = mt.position;
+            if (t.type == Token_type::SYMBOL || t.type == Token_type::IDENTIFIER || t.type == Token_type::KEYWORD) {
+                t.symbol = intern_symbol(t.token); // same as the lexer
+            }
+            tokens.add(std::move(t));
+        }
+        valid = valid && tokens[tokens.size-1].is_eof();
+        if (!valid) tokens.clear();
+    }
+
+    unmap_file(file);
+    return valid;
+}
+
+
+void write_token_cache(const std::string& source_file, uint64_t source_hash, const Seq<Token>& tokens)
+{
+    std::string strings;
+    Seq<Cached_token> cached_tokens;
+    for (const Token& t : tokens) {
+        Cached_token mt;
+        mt.type = (uint32_t)t.type;
+        mt.line = t.context.line;
+        mt.position = t.context.position;
+        mt.string_offset = strings.size();
+        mt.string_length = t.token.size();
+        strings += t.token;
+        cached_tokens.add(mt);
+    }
+
+    Token_cache_header header;
+    memcpy(header.magic, TOKEN_CACHE_MAGIC, sizeof(TOKEN_CACHE_MAGIC));
+    header.version = TOKEN_CACHE_VERSION;
+    header.compiler_build = dll::compiler_build();
+    header.source_hash = source_hash;
+    header.token_count = cached_tokens.size;
+    header.string_size = strings.size();
+
+    // write to a temp file first, then move it into place
+    // that way, other compiler instances never read a half-written cache file
+    std::string file_name = token_cache_file_name(source_file);
+    std::string tmp_file_name = file_name + ".tmp";
+    dll::create_cache_dir();
+    {
+        std::ofstream ofs{tmp_file_name, std::ios::binary};
+        if (!ofs.is_open()) return;
+        ofs.write((const char*)&header, sizeof(header));
+        ofs.write((const char*)cached_tokens.v_ptr, cached_tokens.size * sizeof(Cached_token));
+        ofs.write(strings.data(), strings.size());
+        if (!ofs.good()) {
+            ofs.close();
+            std::remove(tmp_file_name.c_str());
+            return;
+        }
+    }
+    std::remove(file_name.c_str()); // rename doesn't overwrite on windows
+    std::rename(tmp_file_name.c_str(), file_name.c_str());
+}
+
+
+Seq<Token> get_cached_tokens(const std::string& source_file)
+{
+    std::ifstream ifs{source_file, std::ios::binary};
+    if (!ifs.is_open()) return get_tokens_from_file(source_file); // let the lexer report the error
+    std::ostringstream content{};
+    content << ifs.rdbuf();
+    uint64_t source_hash = hash_string(content.str());
+
+    Seq<Token> tokens;
+    if (read_token_cache(source_file, source_hash, tokens)) return tokens;
+
+    int errors = error_count();
+    tokens = get_tokens_from_file(source_file);
+    if (error_count() == errors) write_token_cache(source_file, source_hash, tokens); // the errors should be reported again next time
+    return tokens;
+}
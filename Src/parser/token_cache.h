@@ -0,0 +1,42 @@
+#pragma once
+
+#include "token.h"
+#include "../utilities/sequence.h"
+
+#include <string>
+#include <stdint.h>
+
+/*
+Token cache: the lexed tokens of source files, stored in the dll cache directory (see dll::get_cache_dir()).
+
+Lexing is by far the slowest part of reading a file (see lexer/regex_lexer.cpp), so the tokens of each file
+    read with parse_file() are written to a cache file, and loaded directly from it the next time the file is read.
+Only the tokens are cached. The abstx, types and constant values are built from the tokens as usual, since they are
+    tied to type uids that are assigned per compiler invocation. Function scopes are only parsed when reached
+    (see Global_scope::reach()), so the unused functions of a file only cost their signatures.
+This is not a module format: there is no import statement yet, and nothing but the lexer output is reused.
+A precompiled module (a serialized type table, exported identifiers with their constant values, and the token ranges
+    of the function bodies) would need type uids that are stable between compiler invocations (see specification.md).
+
+The cache file is named by a hash of the source file name, and validated with a hash of the source file content
+    and the build of the compiler (see dll::compiler_build()), so an outdated cache file is never used, also when the lexer changes.
+Layout of a cache file _cb_tokens_<hash of the file name>.cbt (native byte order):
+
+    Token_cache_header                  magic "CBT", version, compiler build, hash of the source, token count and string table size
+    Cached_token[token_count]           type, line, position and the token string as an offset into the string table
+    char[string_size]                   string table
+
+The cache file is mapped into memory when it is read. Token::symbol isn't stored, since it's only valid within
+    one compiler invocation; it's interned again when the tokens are loaded.
+*/
+
+std::string token_cache_file_name(const std::string& source_file);
+
+// returns true if the cache file exists and was written for a source with the given hash
+bool read_token_cache(const std::string& source_file, uint64_t source_hash, Seq<Token>& tokens);
+
+// the cache is only a cache -> failing to write it is not an error
+void write_token_cache(const std::string& source_file, uint64_t source_hash, const Seq<Token>& tokens);
+
+// returns the tokens of the source file, from the cache if possible. Writes the cache file otherwise.
+Seq<Token> get_cached_tokens(const std::string& source_file);
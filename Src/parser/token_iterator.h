@@ -179,6 +179,14 @@ struct Token_iterator
 
         int step = forward ? 1 : -1;
 
+        // if the range starts with a different kind of opening bracket, e.g. "[" when searching for ";", skip past it first
+        if (forward && start_token.type == Token_type::SYMBOL && expected_closing_type == Token_type::SYMBOL) {
+            if      (start_token.token == "(" && expected_closing_token != ")") index = find_matching_paren(index, log_errors);
+            else if (start_token.token == "[" && expected_closing_token != "]") index = find_matching_bracket(index, log_errors);
+            else if (start_token.token == "{" && expected_closing_token != "}") index = find_matching_brace(index, log_errors);
+            if (index == -1) return -1;
+        }
+
         while(true) {
             index += step;
             const Token& t = look_at(index);
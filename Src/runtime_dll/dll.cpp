@@ -1,28 +1,38 @@
 
 #include "dll.h"
+#include "../utilities/hash.h"
 #include <vector>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <cstdio> // rename, remove
 #include <iostream> // debug
+#include <set>
+#include <mutex>
 
 using namespace dll;
 
-std::string base_filename = "_tmp_";
+std::string base_filename = "_tmp_"; // temporary files are written to the cache dir, see temp_file()
+std::string cache_dir = "_cb_cache";
 
 
 #ifdef __WIN32
 
 #include <windows.h>
+#include <direct.h> // _mkdir
+#include <process.h> // _getpid
 std::string del_cmd = "del";
 
+std::string dll_extension = ".dll";
+std::string compile_cmd = "gcc -shared";
+
 // returns null if dll can't be found
 dll_handle dll::load_dll(std::string filename)
 {
     return LoadLibrary(filename.c_str());
 }
 
-bool free_dll(dll_handle dll)
+bool dll::free_dll(dll_handle dll)
 {
     return FreeLibrary(dll);
 }
@@ -33,30 +43,191 @@ void* dll::load_fn_ptr(dll_handle dll, std::string fn_name)
     return nullptr;
 }
 
+static void make_dir(const std::string& dir) { _mkdir(dir.c_str()); }
+static int process_id() { return _getpid(); }
+
+static std::string executable_path()
+{
+    char path[MAX_PATH];
+    DWORD size = GetModuleFileNameA(NULL, path, MAX_PATH);
+    if (size == 0 || size == MAX_PATH) return "";
+    return std::string{path, size};
+}
+
 #else
+
+#include <sys/stat.h> // mkdir
+#include <unistd.h> // readlink
 std::string del_cmd = "rm -rf";
+std::string dll_extension = ".so";
+std::string compile_cmd = "gcc -shared -fPIC";
+
+// returns null if dll can't be found
+dll_handle dll::load_dll(std::string filename)
+{
+    // dlopen searches the library paths unless the file name contains a '/'
+    if (filename.find('/') == std::string::npos) filename = "./" + filename;
+    return dlopen(filename.c_str(), RTLD_NOW | RTLD_LOCAL);
+}
+
+bool dll::free_dll(dll_handle dll)
+{
+    return dll && dlclose(dll) == 0;
+}
+
+void* dll::load_fn_ptr(dll_handle dll, std::string fn_name)
+{
+    if (dll) return dlsym(dll, fn_name.c_str());
+    return nullptr;
+}
+
+static void make_dir(const std::string& dir) { mkdir(dir.c_str(), 0755); }
+static int process_id() { return getpid(); }
+
+static std::string executable_path()
+{
+    char path[4096];
+    ssize_t size = readlink("/proc/self/exe", path, sizeof(path));
+    if (size <= 0 || size == sizeof(path)) return "";
+    return std::string{path, (size_t)size};
+}
+
 #endif
 
 
+std::string dll::get_executable_dir()
+{
+    std::string file = executable_path();
+    size_t pos = file.find_last_of("/\\");
+    return pos == std::string::npos ? "" : file.substr(0, pos+1);
+}
+
+
 
+void dll::set_cache_dir(std::string dir) { cache_dir = dir; }
+const std::string& dll::get_cache_dir() { return cache_dir; }
+void dll::create_cache_dir() { make_dir(cache_dir); }
 
+// include directories are part of compile_cmd, so they are also part of the cache key
+static std::vector<std::string> include_dirs;
+void dll::add_include_dir(std::string dir)
+{
+    std::string flag = " -I\"" + dir + "\"";
+    if (compile_cmd.find(flag) != std::string::npos) return;
+    compile_cmd += flag;
+    include_dirs.push_back(dir);
+}
 
+// the executable itself is hashed, since the source files it was built from might not have changed (e.g. only a header did)
+uint64_t dll::compiler_build()
+{
+    static const uint64_t build = []() {
+        std::ifstream ifs{executable_path(), std::ios::binary};
+        if (!ifs.is_open()) return hash_string(__DATE__ " " __TIME__); // unknown executable -> only changes when this file is compiled
+        std::ostringstream content{};
+        content << ifs.rdbuf();
+        return hash_string(content.str());
+    }();
+    return build;
+}
+
+// hashes the content of all files included with #include "file" that are found in the include dirs, recursively
+// other includes (system headers) are only hashed by name, as part of the source
+static uint64_t hash_includes(const std::string& src, uint64_t h, std::set<std::string>& visited)
+{
+    std::istringstream lines{src};
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t pos = line.find_first_not_of(" \t");
+        if (pos == std::string::npos || line.compare(pos, 8, "#include") != 0) continue;
+        size_t begin = line.find('"', pos);
+        size_t end = begin == std::string::npos ? begin : line.find('"', begin + 1);
+        if (end == std::string::npos) continue;
+        std::string name = line.substr(begin + 1, end - begin - 1);
+        for (const std::string& dir : include_dirs) {
+            std::string file_name = dir + "/" + name;
+            std::ifstream ifs{file_name, std::ios::binary};
+            if (!ifs.is_open()) continue;
+            if (visited.insert(file_name).second) {
+                std::ostringstream content{};
+                content << ifs.rdbuf();
+                h = hash_string(content.str(), hash_string(name, h));
+                h = hash_includes(content.str(), h, visited);
+            }
+            break; // same search order as gcc
+        }
+    }
+    return h;
+}
 
+uint64_t dll::hash_source(const std::string& src)
+{
+    std::set<std::string> visited;
+    uint64_t build = compiler_build();
+    uint64_t h = hash_bytes(&build, sizeof(build));
+    h = hash_string(compile_cmd, h);
+    h = hash_string(src, h);
+    return hash_includes(src, h, visited);
+}
 
+static bool file_exists(const std::string& file_name)
+{
+    std::ifstream ifs{file_name};
+    return ifs.good();
+}
 
+// the cache key is built from the contents of all source files (see hash_source())
+// the file names are not included, since they are different for each invocation (_tmp_N.c)
+static uint64_t get_cache_key(const std::vector<std::string>& src_files)
+{
+    uint64_t h = HASH_SEED;
+    for (const std::string& file_name : src_files) {
+        std::ifstream ifs{file_name, std::ios::binary};
+        std::ostringstream content{};
+        content << ifs.rdbuf();
+        uint64_t file_hash = dll::hash_source(content.str());
+        h = hash_bytes(&file_hash, sizeof(file_hash), h);
+    }
+    return h;
+}
+
+
+// a new file name in the cache dir, unique for this process
+// other compiler instances might use the same cache dir -> the process id is part of the name
+// only the temp files of this process are removed by remove_temp_files(), so they are remembered here
+static std::vector<std::string> temp_files;
+static std::string temp_file(int n, const std::string& extension)
+{
+    dll::create_cache_dir();
+    std::ostringstream oss{};
+    oss << cache_dir << "/" << base_filename << process_id() << "_" << n << extension;
+    temp_files.push_back(oss.str());
+    return oss.str();
+}
 
 int dll_counter = 0;
 dll_handle dll::compile_dll(std::vector<std::string> src_files)
 {
-    std::ostringstream dll{};
+    std::string dll = cache_dir + "/_cb_" + hash_to_string(get_cache_key(src_files)) + dll_extension;
+    if (file_exists(dll)) return load_dll(dll); // compiled earlier -> skip gcc
+
+    // compile to a temp file first, then move it into the cache
+    // that way, other compiler instances never load a half-written dll
+    std::string tmp_dll = temp_file(++dll_counter, dll_extension);
     std::ostringstream cmd{};
-    dll << base_filename << ++dll_counter << ".dll";
-    cmd << "gcc -Shared -o " << dll.str();
+    cmd << compile_cmd << " -o " << tmp_dll;
     for (std::string& file_name : src_files) cmd << " " << file_name;
-    system(cmd.str().c_str());
-    return load_dll(dll.str());
+    if (system(cmd.str().c_str()) != 0) return nullptr;
+
+    if (std::rename(tmp_dll.c_str(), dll.c_str()) != 0) {
+        std::remove(dll.c_str()); // windows can't rename to an existing file
+        if (std::rename(tmp_dll.c_str(), dll.c_str()) != 0) return load_dll(tmp_dll);
+    }
+    return load_dll(dll);
 }
 
+
+
 // extern "C" wrapper to prevent c++ name mangling
 std::string extern_c_header = "\n#ifdef __cplusplus\nextern \"C\" {\n#endif\n";
 std::string extern_c_footer = "\n#ifdef __cplusplus\n}\n#endif\n";
@@ -64,25 +235,34 @@ std::string extern_c_footer = "\n#ifdef __cplusplus\n}\n#endif\n";
 int src_counter = 0;
 std::string dll::create_src(std::vector<std::string> includes, std::vector<std::string> lines)
 {
-    std::ostringstream src{};
-    src << base_filename << ++src_counter << ".c";
-    std::ofstream ofs{src.str()};
+    std::string src = temp_file(++src_counter, ".c");
+    std::ofstream ofs{src};
     for (std::string& include : includes) ofs << "#include \"" << include << "\"" << std::endl;
     ofs << extern_c_header << std::endl;
     for (std::string& line : lines) ofs << line << std::endl;
     ofs << extern_c_footer << std::endl;
     ofs.close();
-    return src.str();
+    return src;
 }
 
 void dll::remove_temp_files()
+{
+    std::vector<std::string> kept;
+    for (const std::string& file_name : temp_files) {
+        // temp dlls that were moved into the cache are already gone; loaded dlls can't be removed on windows
+        if (std::remove(file_name.c_str()) != 0 && file_exists(file_name)) kept.push_back(file_name);
+    }
+    temp_files = std::move(kept);
+}
+
+void dll::clear_cache()
 {
     std::ostringstream oss{};
-    oss << del_cmd << " " << base_filename << "*";
+    oss << del_cmd << " " << cache_dir;
     #ifdef __WIN32
     oss << " 2>nul"; // suppress error messages
     #endif
-    auto r = system(oss.str().c_str());
+    if (system(oss.str().c_str()) != 0) return; // there was no cache to clear
 }
 
 
@@ -90,14 +270,48 @@ void dll::remove_temp_files()
 
 
 
+#ifndef DLL_NO_DYNCALL
 namespace dll {
 namespace dll_internal {
 
     #include "dyncall/include/dyncall.h"
 
-    DCCallVM* vm;
+    thread_local DCCallVM* vm = nullptr;
     const DCsize VM_SIZE = 4096;
 
+    static std::mutex vm_pool_mutex;
+    static std::vector<DCCallVM*> vm_pool;
+
+    // returns the vm of the thread to the pool when the thread exits
+    struct Vm_owner {
+        ~Vm_owner() {
+            if (vm == nullptr) return;
+            std::lock_guard<std::mutex> lock(vm_pool_mutex);
+            vm_pool.push_back(vm);
+            vm = nullptr;
+        }
+    };
+    static thread_local Vm_owner vm_owner;
+
+    DCCallVM* acquire_vm() {
+        if (vm == nullptr) {
+            {
+                std::lock_guard<std::mutex> lock(vm_pool_mutex);
+                if (!vm_pool.empty()) {
+                    vm = vm_pool.back();
+                    vm_pool.pop_back();
+                }
+            }
+            if (vm == nullptr) {
+                vm = dcNewCallVM(VM_SIZE);
+                dcMode(vm, DC_CALL_C_DEFAULT);
+            }
+            (void)&vm_owner; // make sure the owner is constructed for this thread
+        }
+        dcReset(vm);
+        return vm;
+    }
+
     // template<typename ret_t> ret_t _call_fn_internal(void* fn_ptr) {  return dcCallPointer(vm, fn_ptr); } // assume that it's a pointer. We should get compile error if it's not
     template<> void _call_fn_internal<void>(void* fn_ptr) { dcCallVoid(vm, fn_ptr); }
     template<> bool _call_fn_internal<bool>(void* fn_ptr) { return dcCallBool(vm, fn_ptr); }
@@ -121,3 +335,4 @@ namespace dll_internal {
 
 } // namespace dll_internal
 } // namespace dll
+#endif // DLL_NO_DYNCALL
@@ -4,24 +4,62 @@
 Minimal interface for dll handling
 To call loaded functions, you either need to know the function signature at compile time,
     or use the dyncall library to push the arguments on the stack manually.
+call_fn() is a direct call through a typed function pointer; call_fn_dyncall() pushes the arguments through dyncall.
+The compiler itself never calls CB functions with a signature that is only known at runtime: each #run statement
+    gets a generated entry point with the signature void(void**), compiled in the same dll as the called function,
+    that calls it with its real signature (see compile_time/run_batch.h). The entry points are the call stubs,
+    so there is no separate cache of stubs per function type.
+The dyncall library is only linked on Windows (see make.bat). Builds without it (see make.sh) define DLL_NO_DYNCALL,
+    which removes call_fn_dyncall().
+
+Compiled dlls are cached on disk, keyed by a hash of the source files, the runtime headers they include,
+    the gcc command and the build of the compiler (see hash_source()).
+If the same source is compiled again (also in a later compiler invocation), the cached dll
+    is loaded directly and gcc is never called.
 */
 
 #include <string>
 #include <vector>
+#include <stdint.h>
+
+#ifdef __WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <dlfcn.h>
+#else
+#error dll not implemented on current OS
+#endif
 
 namespace dll {
 
 #ifdef __WIN32
-#include <windows.h>
 typedef HMODULE dll_handle;
 #else
-#error dll not implemented on current OS
+typedef void* dll_handle;
 #endif
 
 // returns nullptr if dll failed to load
 dll_handle load_dll(std::string filename);
 dll_handle compile_dll(std::vector<std::string> src_files); // requires gcc in path
-std::string create_src(std::vector<std::string> includes, std::vector<std::string> lines);
+std::string create_src(std::vector<std::string> includes, std::vector<std::string> lines); // writes a temp file in the cache dir, returns its name
+
+// the directory where compiled dlls are stored between compiler invocations (default "_cb_cache")
+void set_cache_dir(std::string dir);
+const std::string& get_cache_dir();
+void create_cache_dir(); // does nothing if it already exists
+
+// the directory of the running executable, with a trailing '/'; "" if it's unknown
+std::string get_executable_dir();
+
+// directories searched by gcc for files included by the source files
+void add_include_dir(std::string dir);
+
+// changes every time the compiler is built, so that nothing generated or cached by an older compiler is reused
+uint64_t compiler_build();
+
+// hash of the source, the headers it includes from the include dirs (recursively), the gcc command and the compiler build
+// anything computed from generated source should be keyed with this, so that it's invalidated when the runtime or the compiler changes
+uint64_t hash_source(const std::string& src);
 
 // returns true if successful
 bool free_dll(dll_handle dll);
@@ -33,16 +71,22 @@ void* load_fn_ptr(dll_handle dll, std::string fn_name);
 template<typename fn_t = void(*)()>
 fn_t load_fn(dll_handle dll, std::string fn_name) { return (fn_t)dll::load_fn_ptr(dll, fn_name); }
 
-// removes temp files. Dlls that is currently will not be removed.
+// removes the temp files written by this process (sources from create_src()). Dlls that are currently loaded might not be removed.
+// cached dlls are not temp files and are kept; use clear_cache() to remove them.
 void remove_temp_files();
+void clear_cache();
 
+#ifndef DLL_NO_DYNCALL
 // internal namespace for internal template functions that we don't want exposed
 namespace dll_internal {
 
     #include "dyncall/include/dyncall.h"
 
-    extern DCCallVM* vm;
+    // each thread has its own vm, so compile time functions can be called from several threads at once
+    // vms are taken from a shared pool, and returned to the pool when the thread exits
+    extern thread_local DCCallVM* vm;
     extern const DCsize VM_SIZE;
+    DCCallVM* acquire_vm(); // sets up vm for the current thread and resets it
 
     template<typename ret_t> ret_t _call_fn_internal(void* fn_ptr) { return dcCallPointer(vm, fn_ptr); } // assume that it's a pointer. We should get compile error if it's not
     template<> void _call_fn_internal<void>(void* fn_ptr);
@@ -73,21 +117,27 @@ namespace dll_internal {
 
     template<typename ret_t=void, typename... arg_ts>
     ret_t _call_fn(void* fn_ptr, arg_ts... args) {
-        if (vm == nullptr) {
-            vm = dcNewCallVM(VM_SIZE);
-            dcMode(vm, DC_CALL_C_DEFAULT);
-        }
-        dcReset(vm);
+        acquire_vm();
         return _call_fn_internal<ret_t, arg_ts...>(fn_ptr, args...);
     }
 
 } // namespace dll_internal
+#endif // DLL_NO_DYNCALL
 
-// call a function with some arguments, using dyncall as a backend
+// call a function with some arguments
+// the signature is known at compile time, so this is just a direct call
 template<typename ret_t=void, typename... arg_ts>
 ret_t call_fn(void* fn_ptr, arg_ts... args) {
-    dll_internal::_call_fn(fn_ptr, args...);
+    return ((ret_t(*)(arg_ts...))fn_ptr)(args...);
+}
+
+#ifndef DLL_NO_DYNCALL
+// call a function with some arguments, using dyncall as a backend
+template<typename ret_t=void, typename... arg_ts>
+ret_t call_fn_dyncall(void* fn_ptr, arg_ts... args) {
+    return dll_internal::_call_fn<ret_t, arg_ts...>(fn_ptr, args...);
 }
+#endif // DLL_NO_DYNCALL
 
 
 
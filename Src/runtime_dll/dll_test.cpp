@@ -79,8 +79,30 @@ std::vector<std::string> lines = {
 };
 
 
+// compiling the same source twice should give a cached dll the second time
+void cache_test() {
+    std::vector<std::string> cache_lines = { "int get_42() { return 42; }" };
+    set_cache_dir("_cb_test_cache");
+    clear_cache();
+
+    auto dll1 = compile_dll({create_src({}, cache_lines)});
+    auto fn1 = load_fn<int(*)()>(dll1, "get_42");
+    printf("first compile: %s, get_42() = %d\n", dll1 ? "ok" : "failed", fn1 ? fn1() : -1);
+
+    remove_temp_files(); // the cached dll should survive this
+    auto dll2 = compile_dll({create_src({}, cache_lines)});
+    auto fn2 = load_fn<int(*)()>(dll2, "get_42");
+    printf("cached compile: %s, get_42() = %d\n", dll2 ? "ok" : "failed", fn2 ? fn2() : -1);
+
+    free_dll(dll1);
+    free_dll(dll2);
+    remove_temp_files();
+    clear_cache();
+}
+
 int main()
 {
+    cache_test();
     struct_test();
     return 0;
 
@@ -14,11 +14,21 @@
 #include "utilities/unique_id.h"
 #include "parser/parser.h"
 #include "lexer/lexer.h"
+#include "compile_server/compile_server.h"
+#include "compile_time/run_batch.h"
+#include "parser/token_cache.h"
+#include "runtime_dll/dll.h"
 #include <string>
 #include <sstream>
+#include <fstream>
 #include <iostream>
 #include <cstdlib>
 #include <memory>
+#include <regex>
+#ifndef __WIN32
+#include <unistd.h> // fork
+#include <sys/wait.h>
+#endif
 using namespace std;
 
 
@@ -263,6 +273,358 @@ void str_test()
 }
 
 
+// escape sequences in string literals (see CB_String::from_token())
+void string_escape_test()
+{
+    CB_String::c_typedef str;
+    std::string bad;
+    ASSERT(CB_String::from_token(R"(a\tb\r\n\\\"\'\?\x41\101\0z)", str, bad));
+    ASSERT(std::string(_cb_string_cstr(&str), _cb_string_size(&str)) == std::string("a\tb\r\n\\\"'?AA\0z", 13));
+    _cb_string_free(&str);
+    ASSERT(!CB_String::from_token(R"(a\qb)", str, bad) && bad == R"(\q)");
+    ASSERT(!CB_String::from_token(R"(\x)", str, bad) && bad == R"(\x)");
+    ASSERT(!CB_String::from_token(R"(\x100)", str, bad) && bad == R"(\x100)");
+    ASSERT(!CB_String::from_token(R"(\777)", str, bad) && bad == R"(\777)");
+    std::cout << "string escape test done" << std::endl;
+}
+
+
+
+// the runtime of #arena scopes, in the order the generated code calls it (see backend_c/cb_arena.h):
+//  s : [..] u64; #arena { t : [..] u64; m : [u64] u64; t[31] = 1; m[1] = 2; s[3] = 4; } s[2000] = 5;
+void arena_test()
+{
+    uint64_t* s = (uint64_t*)_cb_realloc(nullptr, 0, 16 * sizeof(uint64_t)); // not bound to an arena
+    ASSERT(_cb_arena_owner(s) == nullptr);
+    {
+        _cb_arena a = {0};
+        uint64_t* t = (uint64_t*)_cb_arena_empty(&a);
+        _cb_map m = {0};
+        _cb_map_bind_arena(&m, &a);
+        ASSERT(_cb_arena_owner(t) == &a);
+
+        t = (uint64_t*)_cb_realloc(t, 0, 16 * sizeof(uint64_t));
+        uint64_t* grown = (uint64_t*)_cb_realloc(t, 16 * sizeof(uint64_t), 32 * sizeof(uint64_t));
+        ASSERT(grown == t); // the latest allocation grows in place
+        t[31] = 1;
+
+        _cb_map_info info = { 2 * sizeof(uint64_t), sizeof(uint64_t),
+            [](void const* k) { return _cb_map_hash_u64(*(uint64_t const*)k); },
+            [](void const* a, void const* b) { return (int)(*(uint64_t const*)a == *(uint64_t const*)b); } };
+        uint64_t key = 1;
+        int inserted;
+        *(uint64_t*)_cb_map_put(&m, &info, &key, &inserted) = 2;
+        ASSERT(inserted && _cb_arena_owner(m.ctrl) == &a && _cb_arena_owner(m.slots) == &a);
+
+        s = (uint64_t*)_cb_realloc(s, 16 * sizeof(uint64_t), 32 * sizeof(uint64_t)); // grows inside the scope, but stays on the heap
+        ASSERT(_cb_arena_owner(s) == nullptr);
+        s[3] = 4;
+        _cb_arena_end(&a);
+    }
+    s = (uint64_t*)_cb_realloc(s, 32 * sizeof(uint64_t), 2001 * sizeof(uint64_t));
+    s[2000] = 5;
+    ASSERT(s[3] == 4);
+    _cb_free(s);
+    std::cout << "arena test done" << std::endl;
+}
+
+static std::vector<uint64_t> run_results(const std::string& source, const std::string& name); // see below
+
+// the chunks of a parallel loop run on other threads, so containers declared in the loop body stay on the heap
+void arena_parallel_test()
+{
+    std::string source =
+        "sum :: fn()->(r: uint) {\n"
+        "    s : [..] uint; s[999] = 0;\n"
+        "    r = 0;\n"
+        "    #arena { for #parallel (v in s, reduce(+: r)) { t : [..] uint; t[0] = v + 1; r = r + t[0]; } }\n"
+        "};\n"
+        "main :: fn() {};\n"
+        "#run sum();\n";
+    ASSERT(run_results(source, "arena_parallel_test") == std::vector<uint64_t>{ 1000 });
+    std::cout << "arena parallel test done" << std::endl;
+}
+
+
+
+// the channel runtime is C11, so it's tested through a dll (see backend_c/cb_channel.h)
+// a channel with capacity n takes n values without blocking, and the next send blocks until a value is received
+void channel_test()
+{
+    std::vector<std::string> lines = {
+        "#define _CB_CHANNEL_IMPLEMENTATION",
+        "#include \"cb_channel.h\"",
+        "#include <pthread.h>",
+        "#include <unistd.h>",
+        "static _cb_chan* c;",
+        "static size_t n;",
+        "static _Atomic size_t sent;",
+        "static void* sender(void* arg) { for (size_t i = 0; i <= n; ++i) { _cb_chan_send(c, &i); sent = i+1; } return NULL; }",
+        "int blocking_send_test(size_t capacity) {",
+        "    c = _cb_chan_new(sizeof(size_t), capacity);",
+        "    n = capacity ? capacity : 1;", // unbuffered channels hold one value
+        "    sent = 0;",
+        "    pthread_t t;",
+        "    pthread_create(&t, NULL, sender, NULL);",
+        "    while (sent < n) usleep(1000);",
+        "    usleep(50000);",
+        "    int ok = sent == n;", // the last send is blocked
+        "    for (size_t i = 0; i <= n; ++i) { size_t v; _cb_chan_recv(c, &v); ok = ok && v == i; }",
+        "    pthread_join(t, NULL);",
+        "    _cb_chan_free(c);",
+        "    return ok && sent == n+1;",
+        "}",
+    };
+    dll::add_include_dir("backend_c");
+    dll::dll_handle dll = dll::compile_dll({dll::create_src({}, lines)});
+    dll::remove_temp_files();
+    ASSERT(dll);
+    auto blocking_send_test = dll::load_fn<int(*)(size_t)>(dll, "blocking_send_test");
+    for (size_t capacity : {0, 1, 2, 3, 4, 5}) {
+        ASSERT(blocking_send_test(capacity), capacity);
+    }
+    dll::free_dll(dll);
+    std::cout << "channel test done" << std::endl;
+}
+
+
+
+static int count_matches(const std::string& s, const std::string& rx)
+{
+    std::regex r{rx};
+    return std::distance(std::sregex_iterator(s.begin(), s.end(), r), std::sregex_iterator());
+}
+
+// loops whose body might grow the sequence they loop over read the size and the elements through the sequence,
+// not through the copy of the range, which would point to the old buffer (see Abstx_for::iterated_name())
+void growing_loop_test()
+{
+    std::ostringstream code;
+    bool ok = compile_string(
+        "main :: fn() {\n"
+        "    s : [..] uint; t : [..] uint; sum : uint;\n"
+        "    for (i, v in s) { sum = sum + s[i]; s[1000] = 0; }\n"   // grows s
+        "    for (i, v in s) { for (j, w in t) { x := s[j]; } }\n"   // j might be outside s, so s[j] grows s
+        "    for (i, v in t) { sum = sum + t[i]; }\n"                // can't grow t
+        "};\n", "growing_loop_test", code);
+    ASSERT(ok);
+    ASSERT(count_matches(code.str(), "< s\\.size && \\(v = s\\.v_ptr\\[i\\]") == 2);
+    ASSERT(count_matches(code.str(), "_cb_range_[0-9]+\\.size") == 2); // the loops over t
+    std::cout << "growing loop test done" << std::endl;
+}
+
+
+void parallel_write_test()
+{
+    std::ostringstream code;
+    bool ok = compile_string(
+        "main :: fn() {\n"
+        "    s : [..] uint; s[99] = 1;\n"
+        "    for #parallel (i, v in s) { s[i] = v + 1; }\n"           // each iteration writes its own element
+        "};\n", "parallel_write_test", code);
+    ASSERT(ok);
+    ASSERT(count_matches(code.str(), "_cb_i64 i = _cb_i;") == 1);
+
+    const char* bodies[] = {
+        "for #parallel (v in s) { x := t[v]; }",                       // might grow t
+        "for #parallel (v in s) { x := bump(v); }",                    // bump writes to g
+        "for #parallel (i, v in s) { t[i] = v; }",                     // i might be outside t
+    };
+    int n = 0;
+    for (const char* body : bodies) {
+        std::ostringstream failed_code;
+        ok = compile_string(
+            "g : uint = 0;\n"
+            "bump :: fn(a: uint)->(r: uint) { g = g + a; r = a; };\n"
+            "main :: fn() {\n"
+            "    s : [..] uint; t : [..] uint;\n"
+            "    " + std::string(body) + "\n"
+            "};\n", "parallel_write_test_" + std::to_string(n++), failed_code); // parsed files are kept by name
+        ASSERT(!ok, body);
+    }
+    std::cout << "parallel write test done" << std::endl;
+}
+
+
+void soa_index_test()
+{
+    std::ostringstream code;
+    bool ok = compile_string(
+        "P :: struct { x : uint; y : uint; };\n"
+        "main :: fn() {\n"
+        "    src : [..] uint; src[9] = 0;\n"
+        "    s : [..] #soa P;\n"
+        "    for (i, v in src) { p : P; p.x = 1; s[i] = p; s[i].y = 2; }\n"   // grows s
+        "    sum : uint = 0;\n"
+        "    for (k, p in s) { s[k].x = s[k].x + 1; q := s[k]; s[k] = q; }\n" // k is inside s
+        "    for (p in s) { sum = sum + p.x + p.y; }\n"
+        "};\n", "soa_index_test", code);
+    ASSERT(ok);
+    ASSERT(count_matches(code.str(), "_cb_soa_put_[0-9]+\\(&s, i, p\\);") == 1);
+    ASSERT(count_matches(code.str(), "_cb_element.y = 2ULL; _cb_soa_put_[0-9]+\\(&s, i, _cb_element\\);") == 1);
+    ASSERT(count_matches(code.str(), "s.x\\[k\\] = \\(\\(_cb_uint\\)\\(s.x\\[k\\] \\+ 1ULL\\)\\);") == 1);
+    ASSERT(count_matches(code.str(), "q = _cb_soa_get_[0-9]+\\(s, k\\);") == 1);
+    ASSERT(count_matches(code.str(), "_cb_soa_set_[0-9]+\\(&s, k, q\\);") == 1);
+    std::cout << "soa index test done" << std::endl;
+}
+
+
+
+// the thread pool and the channel runtime are only included in programs that use them
+void runtime_include_test()
+{
+    const char* programs[] = {
+        "main :: fn() { x := 1; };",
+        "foo :: fn(a: uint) {}; main :: fn() { async foo(1); };",
+        "main :: fn() { s : [..] uint; s[9] = 1; for #parallel (v in s) { x := v; } };",
+        "main :: fn() { c := chan(4) uint; c <- 1; x := <- c; };",
+    };
+    int async_includes[] = { 0, 1, 1, 0 };
+    int channel_includes[] = { 0, 0, 0, 1 };
+    for (int i = 0; i < 4; ++i) {
+        std::ostringstream code;
+        ASSERT(compile_string(programs[i], "runtime_include_test_" + std::to_string(i), code), programs[i]);
+        ASSERT(count_matches(code.str(), "#include \"cb_async.h\"") == async_includes[i], programs[i]);
+        ASSERT(count_matches(code.str(), "#include \"cb_channel.h\"") == channel_includes[i], programs[i]);
+    }
+    std::cout << "runtime include test done" << std::endl;
+}
+
+
+// the results of the #run statements in the source, in statement order (each statement must have one uint result)
+static std::vector<uint64_t> run_results(const std::string& source, const std::string& name)
+{
+    Token_context context;
+    context.file = name;
+    Shared<Global_scope> gs = parse_string(source, name, context);
+    ASSERT(gs && !is_error(gs->status), name);
+    std::vector<uint64_t> results;
+    for (const auto& st : gs->statements) {
+        Shared<Abstx_function_call> call = dynamic_pointer_cast<Abstx_function_call>((Shared<Statement>)st);
+        if (call == nullptr || !call->compile_time) continue;
+        Shared<Abstx_identifier> id = dynamic_pointer_cast<Abstx_identifier>(call->out_args[0]);
+        ASSERT(id && id->value.v_ptr, name);
+        results.push_back(*(uint64_t*)id->value.v_ptr);
+    }
+    return results;
+}
+
+// compiles the source in a new process, which gets the same unique ids as any other source compiled that way, just like
+//     a new compiler invocation. Cached #run results are keyed by the generated code, which contains the ids.
+// returns true if the #run results are the expected ones
+static bool has_run_results(const std::string& source, const std::vector<uint64_t>& expected)
+{
+#ifdef __WIN32
+    return run_results(source, "run_results_" + std::to_string(get_unique_id())) == expected; // the ids differ -> nothing is read from the cache
+#else
+    pid_t pid = fork(); // no #run statements may have been evaluated before -> there are no worker threads to lose
+    if (pid == 0) _exit(run_results(source, "run_results") == expected ? 0 : 1);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+}
+
+// a token cache file is only used by the compiler build that wrote it, since the lexer might have changed
+void token_cache_test()
+{
+    dll::set_cache_dir("_cb_test_cache");
+    dll::clear_cache();
+    Seq<Token> tokens;
+    Token t;
+    t.type = Token_type::SYMBOL;
+    t.token = "&&";
+    tokens.add(t);
+    t.type = Token_type::EOF;
+    t.token = "";
+    tokens.add(t);
+    write_token_cache("token_cache_test.cb", 1, tokens);
+    Seq<Token> read;
+    ASSERT(read_token_cache("token_cache_test.cb", 1, read) && read.size == 2 && read[0].token == "&&");
+    ASSERT(!read_token_cache("token_cache_test.cb", 2, read)); // the source changed
+
+    // overwrite the compiler build in the header, as if an older compiler wrote the file
+    std::fstream fs{token_cache_file_name("token_cache_test.cb"), std::ios::binary | std::ios::in | std::ios::out};
+    ASSERT(fs.is_open());
+    uint64_t build = dll::compiler_build() + 1;
+    fs.seekp(8); // after the magic and the version
+    fs.write((const char*)&build, sizeof(build));
+    fs.close();
+    ASSERT(!read_token_cache("token_cache_test.cb", 1, read));
+    dll::clear_cache();
+    std::cout << "token cache test done" << std::endl;
+}
+
+
+// statements that use a global variable depend on the statements before them, so they are never cached (see run_cache.h)
+void run_cache_test()
+{
+    dll::set_cache_dir("_cb_test_cache");
+    dll::clear_cache();
+    std::string functions =
+        "g : uint = 0;\n"
+        "bump :: fn(a: uint)->(r: uint) { g = g + a; r = g * 1000000; };\n"
+        "square :: fn(a: uint)->(r: uint) { r = a * a; };\n"
+        "main :: fn() {};\n";
+    ASSERT(has_run_results(functions + "#run bump(1); #run bump(2); #run bump(3); #run bump(4); #run square(3);",
+        {1000000, 3000000, 6000000, 10000000, 9}));
+    ASSERT(has_run_results(functions + "#run bump(5); #run bump(2); #run bump(3); #run bump(4); #run square(3);",
+        {5000000, 7000000, 10000000, 14000000, 9})); // square(3) is read from the cache
+    dll::clear_cache();
+    std::cout << "run cache test done" << std::endl;
+}
+
+
+// statements that change a global are run one at the time, in order, even when the pure ones are run in parallel
+void run_parallel_test()
+{
+    set_run_thread_count(4);
+    std::string source =
+        "g : uint = 0;\n"
+        "bump :: fn(a: uint)->(r: uint) { t := g; s : [..] uint; s[99999] = 0; for (v in s) { t = t + v; } g = t + a; r = g; };\n" // slow, so that parallel calls would race
+        "square :: fn(a: uint)->(r: uint) { r = a * a; };\n"
+        "main :: fn() {};\n";
+    std::vector<uint64_t> expected;
+    for (int i = 1; i <= 20; ++i) {
+        source += "#run bump(" + std::to_string(i) + "); #run square(" + std::to_string(i) + ");\n";
+        expected.push_back(i * (i+1) / 2);
+        expected.push_back(i * i);
+    }
+    ASSERT(run_results(source, "run_parallel_test") == expected);
+    set_run_thread_count(0);
+    std::cout << "run parallel test done" << std::endl;
+}
+
+
+// the results of a wave share one frame, which must be aligned enough for every value in it
+void run_alignment_test()
+{
+    std::string source =
+        "one :: fn()->(r: bool) { r = true; };\n"
+        "vec :: fn(a: float)->(r: v8f32) { r = v8f32(a); };\n"
+        "main :: fn() {};\n"
+        "#run one(); #run vec(1.0); #run one(); #run vec(2.0); #run one(); #run vec(3.0);\n"; // some offsets are only 16 byte aligned
+    Token_context context;
+    context.file = "run_alignment_test";
+    Shared<Global_scope> gs = parse_string(source, "run_alignment_test", context);
+    ASSERT(gs && !is_error(gs->status));
+    float expected = 1;
+    for (const auto& st : gs->statements) {
+        Shared<Abstx_function_call> call = dynamic_pointer_cast<Abstx_function_call>((Shared<Statement>)st);
+        if (call == nullptr || !call->compile_time) continue;
+        Shared<Abstx_identifier> id = dynamic_pointer_cast<Abstx_identifier>(call->out_args[0]);
+        ASSERT(id && id->value.v_ptr);
+        if (id->get_type()->cb_sizeof() == 1) {
+            ASSERT(*(bool*)id->value.v_ptr);
+            continue;
+        }
+        ASSERT((uintptr_t)id->value.v_ptr % 32 == 0);
+        for (int i = 0; i < 8; ++i) ASSERT(((float*)id->value.v_ptr)[i] == expected);
+        expected++;
+    }
+    ASSERT(expected == 4);
+    std::cout << "run alignment test done" << std::endl;
+}
 
 void ptr_reference_test()
 {
@@ -439,32 +801,8 @@ void code_gen_test()
     // }
     // std::cout << endl;
 
-    Shared<Global_scope> gs = parse_file("../Demos/minimal.cb");
-    // Shared<Global_scope> gs = parse_tokens(std::move(hw_tokens), "Demos/minimal.cb");
-
-    // later:
-    // find identifier main, it should be a function
-    // fully parse starting from that function
-    // then generate code starting from that function
-
-    LOG("exiting if errors");
-    exit_if_errors();
-
-    LOG("generating typedefs");
-    generate_typedefs(std::cout);
-
-    LOG("generating statement code");
-    for (const auto& s : gs->statements) {
-        ASSERT(s); // no statement can be nullpointer here
-        // @TODO: any dependencies should be generated FIRST!
-        s->generate_code(std::cout); // for now, just fully parse the statements
-    }
-
-    LOG("generating used function code");
-    for (const auto& fn : gs->used_functions) {
-        ASSERT(fn.second); // no f unction can be nullpointer here
-        fn.second->generate_declaration(std::cout, std::cout);
-    }
+    // the global scope is parsed starting from main; only the functions reached from it are generated
+    if (!compile_file("../Demos/minimal.cb", std::cout)) exit_if_errors();
 
     // compile into abstx tree
     // TODO
@@ -527,8 +865,19 @@ void abstx_test()
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
+    // the Src directory of the compiler, needed by #run statements (see compile_time/run_batch.h)
+    if (argc >= 3 && std::string(argv[1]) == "--runtime-dir") {
+        set_runtime_dir(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+
+    // see compile_server/compile_server.h
+    if (argc == 3 && std::string(argv[1]) == "--server") return serve(argv[2]);
+    if (argc == 4 && std::string(argv[1]) == "--connect") return request_compile(argv[2], argv[3], std::cout, std::cerr);
+
     // Debug_os os{std::cout};
     // ptr_reference_test();
     // unique_id_test();
@@ -537,6 +886,18 @@ int main()
     // float_test();
     // wchar_test();
     // str_test();
+    // string_escape_test();
+    // arena_test();
+    // arena_parallel_test();
+    // channel_test();
+    // growing_loop_test();
+    // parallel_write_test();
+    // soa_index_test();
+    // runtime_include_test();
+    // token_cache_test();
+    // run_cache_test();
+    // run_parallel_test();
+    // run_alignment_test();
     // seq_test();
     // owning_test();
     // template_test();
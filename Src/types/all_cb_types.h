@@ -3,14 +3,18 @@
 
 #include "../utilities/assert.h"
 #include "cb_any.h"
+#include "cb_channel.h"
 #include "cb_function.h"
+#include "cb_map.h"
 #include "cb_pointer.h"
 #include "cb_primitives.h"
 #include "cb_range.h"
 #include "cb_seq.h"
+#include "cb_soa_seq.h"
 #include "cb_string.h"
 #include "cb_struct.h"
 #include "cb_type.h"
+#include "cb_vector.h"
 
 
 /*
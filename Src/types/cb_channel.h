@@ -0,0 +1,98 @@
+#pragma once
+
+#include "cb_type.h"
+#include "cb_primitives.h"
+#include "../utilities/pointers.h"
+
+/*
+CB_Channel: a bounded queue for sending values between threads (see backend_c/cb_channel.h for the runtime)
+
+Syntax:
+c : chan T;             // channel type. The default value is no channel.
+c := chan(N) T;         // creates a new channel with room for N values. N is evaluated compile time.
+c <- t;                 // send t (blocks while the channel is full)
+t := <- c;              // receive (blocks while the channel is empty)
+
+The channel itself is a pointer to the runtime channel, so copies of it (for example as an argument
+    to an async function call) refer to the same channel.
+*/
+
+struct CB_Channel : CB_Type
+{
+    static constexpr void* _default_value = nullptr;
+    Shared<const CB_Type> v_type = nullptr;
+
+    CB_Channel(bool explicit_unresolved=false) { uid = type->uid; if (explicit_unresolved) finalize(); }
+    CB_Channel(const std::string& name, size_t size, void const* default_value) : CB_Type(name, size, default_value) {}
+
+    static Shared<const CB_Type> get_channel_type(Shared<const CB_Type> member_type) {
+        Owned<CB_Channel> o = alloc(CB_Channel());
+        o->v_type = member_type;
+        o->finalize();
+        return add_complex_cb_type(owned_static_cast<CB_Type>(std::move(o)));
+    }
+
+    std::string toS() const override {
+        if (v_type == nullptr) return "_cb_unresolved_channel";
+        std::ostringstream oss;
+        oss << "chan ";
+        v_type->generate_type(oss);
+        return oss.str();
+    }
+
+    bool is_primitive() const override { return true; } // it's just a pointer
+
+    void finalize() override {
+        std::string tos = toS();
+        for (const auto& tn_pair : typenames) {
+            if (tn_pair.second == tos) {
+                // found existing channel type with the same signature -> grab its id
+                uid = tn_pair.first;
+                return;
+            }
+        }
+        // no matching signature found -> register new type
+        register_type(tos, sizeof(_default_value), &_default_value);
+    }
+
+    // the typedef also contains typed wrappers for send and receive, so the values can be passed around as c values
+    // the wrappers declare the runtime functions themselves, so the typedefs can be used without including the runtime
+    void generate_typedef(ostream& os) const override {
+        ASSERT(v_type != nullptr);
+        os << "typedef struct _cb_chan* ";
+        generate_type(os);
+        os << ";" << std::endl;
+
+        os << "static inline void _cb_chan_send_" << uid << "(";
+        generate_type(os);
+        os << " c, ";
+        v_type->generate_type(os);
+        os << " v) { void _cb_chan_send(struct _cb_chan*, void const*); _cb_chan_send(c, &v); }" << std::endl;
+
+        os << "static inline ";
+        v_type->generate_type(os);
+        os << " _cb_chan_recv_" << uid << "(";
+        generate_type(os);
+        os << " c) { void _cb_chan_recv(struct _cb_chan*, void*); ";
+        v_type->generate_type(os);
+        os << " v; _cb_chan_recv(c, &v); return v; }" << std::endl;
+    }
+    void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override {
+        ASSERT(raw_data);
+        ASSERT(*(void**)raw_data == nullptr); // channels only exist in the running program
+        os << "NULL";
+    }
+    void generate_destructor(ostream& os, const std::string& id, uint32_t depth = 0) const override {
+        // channels are shared between threads, so the declaring scope doesn't own them
+    }
+
+    // code for creating a new channel
+    void generate_new(ostream& os, uint64_t capacity) const {
+        ASSERT(v_type != nullptr);
+        os << "_cb_chan_new(sizeof(";
+        v_type->generate_type(os);
+        os << "), " << capacity << ")";
+    }
+    void generate_send(ostream& os) const { os << "_cb_chan_send_" << uid; }
+    void generate_receive(ostream& os) const { os << "_cb_chan_recv_" << uid; }
+};
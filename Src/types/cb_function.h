@@ -173,6 +173,10 @@ struct CB_Function : CB_Type
 
     bool is_primitive() const override { return true; }
 
+    // a function with exactly one out argument returns it as the C return value, instead of through a pointer
+    // that way, the C compiler can keep the result in a register
+    bool returns_value() const { return out_types.size == 1; }
+
     void finalize() override {
         std::string tos = toS();
         for (const auto& tn_pair : typenames) {
@@ -188,7 +192,10 @@ struct CB_Function : CB_Type
 
     // code generation functions
     void generate_typedef(ostream& os) const override {
-        os << "typedef void(*";
+        os << "typedef ";
+        if (returns_value()) out_types[0]->generate_type(os);
+        else os << "void";
+        os << "(*";
         generate_type(os);
         os << ")(";
         for (int i = 0; i < in_types.size; ++i) {
@@ -196,6 +203,10 @@ struct CB_Function : CB_Type
             in_types[i]->generate_type(os);
             if (!in_types[i]->is_primitive()) os << " const*";
         }
+        if (returns_value()) {
+            os << ");" << std::endl;
+            return;
+        }
         if (in_types.size > 0 && out_types.size > 0) os << ", ";
         for (int i = 0; i < out_types.size; ++i) {
             if (i) os << ", ";
@@ -204,6 +215,30 @@ struct CB_Function : CB_Type
         }
         os << ");" << std::endl;
     }
+    // argument struct and thunk for async calls of this function type (see backend_c/cb_async.h)
+    // only allowed for functions without out arguments
+    void generate_async_thunk(ostream& os) const {
+        ASSERT(out_types.size == 0);
+        os << "typedef struct { ";
+        for (uint32_t i = 0; i < in_types.size; ++i) {
+            in_types[i]->generate_type(os);
+            os << " a" << i << "; ";
+        }
+        os << "} _cb_async_args_" << uid << ";" << std::endl;
+
+        os << "static void _cb_async_thunk_" << uid << "(void* fn_ptr, void* args) { ";
+        os << "_cb_async_args_" << uid << "* a = (_cb_async_args_" << uid << "*)args; ";
+        os << "((";
+        generate_type(os);
+        os << ")fn_ptr)(";
+        for (uint32_t i = 0; i < in_types.size; ++i) {
+            if (i) os << ", ";
+            if (!in_types[i]->is_primitive()) os << "&"; // non-primitives by const pointer
+            os << "a->a" << i;
+        }
+        os << "); }" << std::endl;
+    }
+
     void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override {
         if (!raw_data) os << "NULL";
         if (!*(void**)raw_data) os << "NULL";
@@ -229,106 +264,36 @@ struct CB_Function : CB_Type
 
 
 
-// @todo: generic functions
-
-
-
 /*
 A generic function is a function with one or more generic arguments.
 For each set of types that the function is called with, a new function instance is created and compiled.
-This means that the generic function is closely connected to the parser.
+This means that the generic function is closely connected to the parser (see get_specialization() in parser.h).
 
 Syntax:
-foo : fn($T, T)->T; // T is decided by the first in argument
-foo : fn(T, $T)->T; // T is decided by the second in argument
-// foo : fn(T); // error, unable to infer the type T; no type decider
-// foo : fn(T)->$T; // error, unable to infer the type T; type deciders has to be in the in argument list
-foo : fn($T1, $T2); // more than one type can be generic
-foo : fn(int, $T); // generic and non-generic types can be mixed
-*/
-
-
-
-// typedef std::map<CB_Int, CB_Type> Type_map; // from generic index to inferred type
-
-// FIXME: move these to parser
-// struct Abstx_Generic_function {};
-// CB_Function recompile(CB_Sharing_pointer<Abstx_Generic_function> abstx, const Type_map& inferred_map) {} // FIXME: move to parser files
-
-
-
-
-
+foo :: fn(a: $T, b: T)->(r: T) {...};   // T is decided by the first in argument
+foo :: fn(a: T, b: $T) {...};           // T is decided by the second in argument
+// foo :: fn(a: T) {...};               // error, unable to infer the type T; no type decider
+foo :: fn(a: $T1, b: $T2) {...};        // more than one type can be generic
+foo :: fn(a: int, b: $T) {...};         // generic and non-generic types can be mixed
+foo :: fn($n: int) {...};               // the value of n is known at compile time, so each value gets its own instance
 
+The specializations are cached in the generic function literal, keyed by the inferred types and the compile time values.
+All calls with the same key shares the same function instance, so it's only type checked and generated once.
 
-
-/*
-// inherits id, type and has_default_value from Function_arg
-struct Generic_arg : Function_arg {
-    CB_Int generic_index = -1; // -1: not generic
-    CB_Bool deciding = false;
-};
-
-struct Generic_function_metadata {
-    CB_Dynamic_seq<Generic_arg> in_args;
-    CB_Dynamic_seq<Generic_arg> out_args;
-};
-
-struct CB_Generic_function
+A generic function only exists at compile time; its value in the generated code is always NULL.
+*/
+struct CB_Generic_function : CB_Type
 {
-    static CB_Type type;
-    CB_Owning_pointer<Generic_function_metadata> metadata;
-    CB_Dynamic_seq<CB_Function> constructed_fns;
-    CB_Sharing_pointer<Abstx_Generic_function> abstx; // only compile time
-
-    std::string toS() const {
-        return "generic_function"; // FIXME: better toS()
-    }
+    static const Shared<const CB_Type> type;
+    static constexpr void* _default_value = nullptr;
 
-    CB_Generic_function(CB_Sharing_pointer<Abstx_Generic_function> abstx) : abstx{abstx} {}
-    ~CB_Generic_function() {}
+    CB_Generic_function() { uid = type->uid; }
+    CB_Generic_function(const std::string& name, size_t size, void const* default_value) : CB_Type(name, size, default_value) {}
+    std::string toS() const override { return "generic_fn"; }
 
-    CB_Generic_function& operator=(const CB_Generic_function& fn) {
-        metadata = alloc<Generic_function_metadata>(*fn.metadata);
-        constructed_fns = fn.constructed_fns;
-        abstx = fn.abstx;
-        return *this;
-    }
-    CB_Generic_function(const CB_Generic_function& fn) { *this = fn; }
-
-    CB_Generic_function& operator=(CB_Generic_function&& fn) {
-        constructed_fns = std::move(fn.constructed_fns);
-        metadata = std::move(fn.metadata);
-        abstx = fn.abstx;
-        return *this;
-    }
-    CB_Generic_function(CB_Generic_function&& fn) { *this = fn; }
-
-    void add_specialization(const CB_Function& fn) {
-        // verify types
-        ASSERT(verify_types(fn.metadata->in_args));
-        constructed_fns.add(fn);
-    }
-
-    CB_Function get_specialization(const CB_Dynamic_seq<Function_arg>& in_args) {
-        // infer types
-        Type_map inferred_map = infer_types(in_args);
-        CB_Function fn = recompile(abstx, inferred_map);
-        constructed_fns.add(fn);
-        return fn;
-    }
-
-    Type_map infer_types(const CB_Dynamic_seq<Function_arg>& in_args) {
-        ASSERT(false, "NYI");
-        return Type_map();
-    }
-
-    bool verify_types(const CB_Dynamic_seq<Function_arg>& in_args) {
-        ASSERT(false, "NYI");
-        return false;
-    }
+    bool is_primitive() const override { return true; }
 
+    // there is no typedef, so that it isn't included in every program
+    void generate_type(ostream& os) const override { os << "void*"; }
+    void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override { os << "NULL"; }
 };
-CB_Type CB_Generic_function::type = CB_Type("generic_fn");
-
-*/
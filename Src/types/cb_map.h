@@ -0,0 +1,217 @@
+#pragma once
+
+#include "cb_type.h"
+#include "cb_primitives.h"
+#include "cb_range.h" // CB_Iterable
+#include "cb_string.h"
+#include "../utilities/pointers.h"
+#include "../utilities/unique_id.h"
+#include "../backend_c/cb_map.h"
+
+/*
+CB_Map: a hash map from keys of one type to values of another type (see backend_c/cb_map.h for the runtime)
+
+Syntax:
+m : [string] int;               // map type. The default value is an empty map.
+m := ["a"->1, "b"->2];          // map literal; the types are taken from the first pair
+m := [string->int: ];           // empty map literal with explicit types
+m["c"] = 3;                     // indexing inserts the key with a default value if it's not in the map
+for (k, v in m) {}              // iterates over all keys and values, in no particular order
+
+Keys must be numbers, bools or strings.
+*/
+
+struct CB_Map : CB_Type, CB_Iterable
+{
+    static constexpr _cb_map _default_value = {nullptr, nullptr, 0, 0, 0};
+    Shared<const CB_Type> k_type = nullptr;
+    Shared<const CB_Type> v_type = nullptr;
+
+    CB_Map(bool explicit_unresolved=false) { uid = type->uid; if (explicit_unresolved) finalize(); }
+    CB_Map(const std::string& name, size_t size, void const* default_value) : CB_Type(name, size, default_value) {}
+
+    static Shared<const CB_Type> get_map_type(Shared<const CB_Type> key_type, Shared<const CB_Type> value_type) {
+        Owned<CB_Map> o = alloc(CB_Map());
+        o->k_type = key_type;
+        o->v_type = value_type;
+        o->finalize();
+        return add_complex_cb_type(owned_static_cast<CB_Type>(std::move(o)));
+    }
+
+    static bool is_valid_key_type(Shared<const CB_Type> t) {
+        if (t == nullptr) return false;
+        for (const auto& kt : { CB_Bool::type, CB_i8::type, CB_i16::type, CB_i32::type, CB_i64::type, CB_Int::type,
+                                CB_u8::type, CB_u16::type, CB_u32::type, CB_u64::type, CB_Uint::type,
+                                CB_f32::type, CB_f64::type, CB_Float::type, CB_String::type }) {
+            if (*t == *kt) return true;
+        }
+        return false;
+    }
+
+    std::string toS() const override {
+        if (k_type == nullptr || v_type == nullptr) return "_cb_unresolved_map";
+        std::ostringstream oss;
+        oss << "[" << k_type->toS() << "] " << v_type->toS();
+        return oss.str();
+    }
+
+    bool is_primitive() const override { return false; }
+
+    virtual size_t alignment() const override { return alignof(_cb_map); }
+
+    void finalize() override {
+        std::string tos = toS();
+        for (const auto& tn_pair : typenames) {
+            if (tn_pair.second == tos) {
+                // found existing map type with the same signature -> grab its id
+                uid = tn_pair.first;
+                return;
+            }
+        }
+        // no matching signature found -> register new type
+        register_type(tos, sizeof(_default_value), &_default_value);
+    }
+
+    // layout of a slot, the same as the c struct generated in generate_typedef()
+    size_t value_offset() const {
+        size_t a = v_type->alignment();
+        return (k_type->cb_sizeof() + a-1) / a * a;
+    }
+    size_t slot_size() const {
+        size_t a = std::max(k_type->alignment(), v_type->alignment());
+        return (value_offset() + v_type->cb_sizeof() + a-1) / a * a;
+    }
+
+    // The typedef includes typed wrappers for lookup, so the compiler can inline the hash and compare functions:
+    //  _cb_map_at_N(&m, k) returns a pointer to the value of k, inserting it if necessary
+    //  _cb_map_find_N(&m, k) returns a pointer to the value of k, or NULL
+    void generate_typedef(ostream& os) const override {
+        ASSERT(k_type != nullptr && v_type != nullptr);
+        os << "#include \"cb_map.h\"" << std::endl;
+        os << "typedef struct { ";
+        k_type->generate_type(os);
+        os << " key; ";
+        v_type->generate_type(os);
+        os << " value; } _cb_map_slot_" << uid << ";" << std::endl;
+        os << "typedef _cb_map ";
+        generate_type(os);
+        os << ";" << std::endl;
+
+        // hash and compare
+        std::ostringstream key;
+        key << "*(";
+        k_type->generate_type(key);
+        key << " const*)";
+        os << "static uint64_t _cb_map_hash_" << uid << "(void const* k) { return ";
+        if (*k_type == *CB_String::type) os << "_cb_map_hash_bytes(_cb_string_cstr(k), _cb_string_size(k))";
+        else if (*k_type == *CB_f32::type || *k_type == *CB_f64::type || *k_type == *CB_Float::type) os << "_cb_map_hash_f64(" << key.str() << "k)";
+        else os << "_cb_map_hash_u64((uint64_t)" << key.str() << "k)";
+        os << "; }" << std::endl;
+        os << "static int _cb_map_eq_" << uid << "(void const* a, void const* b) { return ";
+        if (*k_type == *CB_String::type) os << "_cb_string_eq(a, b)";
+        else os << key.str() << "a == " << key.str() << "b";
+        os << "; }" << std::endl;
+        os << "static const _cb_map_info _cb_map_info_" << uid << " = { sizeof(_cb_map_slot_" << uid << "), offsetof(_cb_map_slot_" << uid
+           << ", value), _cb_map_hash_" << uid << ", _cb_map_eq_" << uid << " };" << std::endl;
+
+        // typed lookup
+        os << "static inline ";
+        v_type->generate_type(os);
+        os << "* _cb_map_at_" << uid << "(";
+        generate_type(os);
+        os << "* m, ";
+        k_type->generate_type(os);
+        os << " k) { int inserted; ";
+        v_type->generate_type(os);
+        os << "* v = (";
+        v_type->generate_type(os);
+        os << "*)_cb_map_put(m, &_cb_map_info_" << uid << ", &k, &inserted); if (inserted) *v = ";
+        v_type->generate_literal(os, v_type->default_value().v_ptr);
+        os << "; return v; }" << std::endl;
+        os << "static inline ";
+        v_type->generate_type(os);
+        os << "* _cb_map_find_" << uid << "(";
+        generate_type(os);
+        os << " const* m, ";
+        k_type->generate_type(os);
+        os << " k) { return (";
+        v_type->generate_type(os);
+        os << "*)_cb_map_find(m, &_cb_map_info_" << uid << ", &k); }" << std::endl;
+    }
+
+    // Maps live on the heap, so a literal is built with a gnu statement expression.
+    // This means that non-empty map constants can only be used inside functions.
+    void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override {
+        ASSERT(raw_data);
+        if (depth > MAX_ALLOWED_DEPTH) { post_circular_reference_error(); return; }
+        _cb_map const* m = (_cb_map const*)raw_data;
+        if (m->size == 0) {
+            os << "(";
+            generate_type(os);
+            os << "){0}";
+            return;
+        }
+        os << "({ ";
+        generate_type(os);
+        os << " _cb_m = {0}; ";
+        for (uint64_t i = 0; i < m->capacity; ++i) {
+            if (m->ctrl[i] < 0) continue;
+            uint8_t const* slot = m->slots + i * slot_size();
+            os << "*";
+            generate_at(os);
+            os << "(&_cb_m, ";
+            k_type->generate_literal(os, slot, depth+1);
+            os << ") = ";
+            v_type->generate_literal(os, slot + value_offset(), depth+1);
+            os << "; ";
+        }
+        os << "_cb_m; })";
+    }
+
+    void generate_destructor(ostream& os, const std::string& id, uint32_t depth = 0) const override {
+        if (depth > MAX_ALLOWED_DEPTH) { post_circular_reference_error(); return; }
+        os << "for (uint64_t _it = 0; _it < " << id << ".capacity; ++_it) if (" << id << ".ctrl[_it] >= 0) { ";
+        v_type->generate_destructor(os, "((_cb_map_slot_" + std::to_string(uid) + "*)" + id + ".slots)[_it].value", depth+1);
+        os << " }" << std::endl;
+        os << "_cb_map_free(&" << id << ");" << std::endl;
+    }
+    void generate_arena_binding(ostream& os, const std::string& id, const std::string& arena, uint32_t depth = 0) const override {
+        os << "_cb_map_bind_arena(&" << id << ", " << arena << ");" << std::endl;
+    }
+
+    void generate_at(ostream& os) const { os << "_cb_map_at_" << uid; }
+
+    // iteration; without a key name, only the values are visible in the loop
+    void generate_for(ostream& os, const std::string& id, const std::string& it_name = "it", uint64_t step = 1, bool reverse = false, bool protected_scope = true) const override {
+        ASSERT(step == 1 && !reverse); // checked by the parser
+        generate_for_key_value(os, id, "_cb_key_" + std::to_string(get_unique_id()), it_name, protected_scope);
+    }
+    void generate_for_after_scope(ostream& os, bool protected_scope = true) const override {
+        if (!protected_scope) os << "}" << std::endl; // close the brace with unique iterator name
+    }
+
+    Shared<const CB_Type> get_iterator_type() const override { return v_type; }
+    void generate_iterator_declaration(ostream& os, const std::string& it_name) const override {
+        v_type->generate_type(os);
+        if (!v_type->is_primitive()) os << " const*"; // same as for sequences
+        os << " " << it_name;
+    }
+    Shared<const CB_Type> get_key_type() const override { return k_type; }
+    bool ordered() const override { return false; }
+    bool reallocates() const override { return true; }
+
+    void generate_for_key_value(ostream& os, const std::string& id, const std::string& key_name, const std::string& it_name, bool protected_scope = true) const override {
+        uint64_t it_uid = get_unique_id();
+        std::string slot = "((_cb_map_slot_" + std::to_string(uid) + "*)" + id + ".slots)[_it_" + std::to_string(it_uid) + "]";
+        if (!protected_scope) os << "{ "; // open brace to put unique iterator name out of scope for the rest of the program
+        k_type->generate_type(os);
+        os << " " << key_name << "; ";
+        generate_iterator_declaration(os, it_name);
+        os << "; ";
+        os << "for (uint64_t _it_" << it_uid << " = 0; _it_" << it_uid << " < " << id << ".capacity; ++_it_" << it_uid << ") ";
+        os << "if (" << id << ".ctrl[_it_" << it_uid << "] >= 0 && (";
+        os << key_name << " = " << slot << ".key, " << it_name << " = ";
+        if (!v_type->is_primitive()) os << "&";
+        os << slot << ".value, 1))";
+    }
+};
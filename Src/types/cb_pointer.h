@@ -47,13 +47,13 @@ struct CB_Pointer : CB_Type
     void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override {
         ASSERT(raw_data);
         if (!*(void**)raw_data) os << "NULL";
-        os << std::hex << *(void**)raw_data;
+        else os << "(void*)0x" << std::hex << (uintptr_t)*(void**)raw_data << std::dec; // restore dec so later numbers are printed correctly
     }
     void generate_destructor(ostream& os, const std::string& id, uint32_t depth = 0) const override {
         if (depth > MAX_ALLOWED_DEPTH) { post_circular_reference_error(); return; }
         if (owning) {
             v_type->generate_destructor(os, "*"+id, depth+1);
-            os << "free " << id << ";" << std::endl;
+            os << "_cb_free(" << id << ");" << std::endl;
         }
     }
 
@@ -2,6 +2,8 @@
 
 #include "cb_type.h"
 
+#include <limits>
+
 #define GENERATE_PRIMITIVE(cpp_type, tos, c_type, literal_suffix) \
 struct cpp_type : CB_Type { \
     static const Shared<const CB_Type> type; \
@@ -19,7 +21,9 @@ struct cpp_type : CB_Type { \
     } \
     void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override { \
         ASSERT(raw_data); \
-        os << *(c_type*)raw_data << literal_suffix;\
+        std::streamsize precision = os.precision(std::numeric_limits<c_type>::max_digits10); /* floats must survive the round trip */ \
+        os << +*(c_type*)raw_data << literal_suffix; /* unary + prints 8 bit values as numbers, not chars */ \
+        os.precision(precision); \
     } \
 }
 
@@ -23,6 +23,36 @@ struct CB_Iterable {
     // generate_for_after_scope(): called after the for scope is printed (directly after the closing })
     // this function is optional to implement
     virtual void generate_for_after_scope(ostream& os, bool protected_scope = true) const {}
+
+    // the type of the iterator variable
+    virtual Shared<const CB_Type> get_iterator_type() const = 0;
+    // c declaration of the iterator variable, without ';'
+    virtual void generate_iterator_declaration(ostream& os, const std::string& it_name) const {
+        get_iterator_type()->generate_type(os);
+        os << " " << it_name;
+    }
+
+    // iterables with keys (maps) can also be iterated as for (k, v in m)
+    virtual Shared<const CB_Type> get_key_type() const { return nullptr; }
+    virtual void generate_for_key_value(ostream& os, const std::string& id, const std::string& key_name, const std::string& it_name, bool protected_scope = true) const { ASSERT(false, "no keys"); }
+    // unordered iterables can't be iterated with step or reverse
+    virtual bool ordered() const { return true; }
+    // iterables whose elements are moved when they grow: a copy of the iterable is invalid after the original has grown
+    virtual bool reallocates() const { return false; }
+
+    // Iterables that don't store whole elements (#soa sequences) use an index as the c iterator.
+    // References to the iterator then have to be generated by the iterable, see Abstx_identifier::iterated_by.
+    virtual bool iterator_is_index() const { return false; }
+    virtual void generate_iterator_value(ostream& os, const std::string& id, const std::string& it_name) const { ASSERT(false, "iterator is not an index"); }
+    virtual void generate_iterator_member(ostream& os, const std::string& id, const std::string& it_name, const std::string& member) const { ASSERT(false, "iterator is not an index"); }
+
+    // Parallel for loops (see Abstx_for) split the loop into chunks of iteration indices [0, count).
+    // Only iterables with a known number of elements can be used in parallel.
+    virtual bool parallel_iterable() const { return false; }
+    // generate_count(): the number of iterations as an int64_t
+    virtual void generate_count(ostream& os, const std::string& id, uint64_t step = 1) const { ASSERT(false, "not parallel iterable"); }
+    // generate_element(): the iterator value for the iteration index given by the c expression index
+    virtual void generate_element(ostream& os, const std::string& id, const std::string& index, uint64_t step = 1, bool reverse = false) const { ASSERT(false, "not parallel iterable"); }
 };
 
 struct CB_Range : CB_Type, CB_Iterable {
@@ -66,6 +96,16 @@ struct CB_Range : CB_Type, CB_Iterable {
         os << it_name << (reverse?" >= ":" <= ") << id << (reverse?".r_start":".r_end") << ";";
         os << it_name << (reverse?" -= ":" += ") << step << ")";
     }
+
+    Shared<const CB_Type> get_iterator_type() const override { return CB_i64::type; }
+    bool parallel_iterable() const override { return true; }
+    void generate_count(ostream& os, const std::string& id, uint64_t step = 1) const override {
+        os << "(" << id << ".r_end < " << id << ".r_start ? 0 : (" << id << ".r_end - " << id << ".r_start) / " << step << " + 1)";
+    }
+    void generate_element(ostream& os, const std::string& id, const std::string& index, uint64_t step = 1, bool reverse = false) const override {
+        if (reverse) os << id << ".r_end - " << index << " * " << step;
+        else os << id << ".r_start + " << index << " * " << step;
+    }
 };
 
 
@@ -110,6 +150,9 @@ struct CB_Float_range : CB_Type, CB_Iterable {
         os << it_name << (reverse?" >= ":" <= ") << id << (reverse?".r_start":".r_end") << ";";
         os << it_name << (reverse?" -= ":" += ") << step << ")";
     }
+
+    Shared<const CB_Type> get_iterator_type() const override { return CB_f64::type; }
+    // not parallel iterable: the number of iterations depends on rounding
 };
 
 
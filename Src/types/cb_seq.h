@@ -15,11 +15,42 @@ a : T[] = [T, size=N: t1, t2, t3]; // T inferred from members, N evaluated compi
 a : T[] = [T: t1, t2, t3]; // N inferred by the number of arguments
 a : T[] = [size=N: t1, t2, t3]; // T inferred from the type of the members
 a : T[] = [t1, t2, t3]; // T and N inferred
+
+s[i]                    // element i; the sequence grows if i >= size, and a temporary default value is returned if i < 0
+for (i, v in s) {}      // i is the index of v
 */
 
 struct CB_Indexable {
+    // unchecked indexing: id.v_ptr[index]
     virtual void generate_index_start(ostream& os, const std::string& id) const = 0;
     virtual void generate_index_end(ostream& os) const = 0;
+
+    // generate_at(): the name of the checked index function, declared by generate_typedef(), as in (*_cb_seq_at_N(&s, i))
+    // it handles indices outside of the sequence as described in the spec
+    virtual void generate_at(ostream& os) const { ASSERT(false, "no checked indexing"); }
+
+protected:
+    // the for statement of generate_for(): the bounds are checked before the element is read
+    // the unsigned index counts down from size to 0 in reverse, and is one more than the index of the element
+    // by_address: it_name is a pointer to the element
+    void generate_for_loop(ostream& os, const std::string& id, const std::string& it_name, const std::string& size, bool by_address, uint64_t it_uid, uint64_t step, bool reverse) const {
+        std::string it = "_it_" + std::to_string(it_uid);
+        os << "for (size_t " << it << " = " << (reverse ? size : "0") << "; ";
+        // stop condition
+        if (reverse) os << it << " > 0";
+        else os << it << " < " << size;
+        // array indexing
+        os << " && (" << it_name << " = ";
+        if (by_address) os << "&";
+        generate_index_start(os, id);
+        os << it << (reverse ? " - 1" : "");
+        generate_index_end(os);
+        os << ", 1)";
+        // increment/decrement
+        if (reverse) os << "; " << it << " = " << it << " > " << step << " ? " << it << " - " << step << " : 0)";
+        else os << "; " << it << " += " << step << ")";
+    }
+public:
 };
 
 
@@ -63,8 +94,10 @@ struct CB_Seq : CB_Type, CB_Iterable, CB_Indexable
         register_type(tos, sizeof(_default_value), &_default_value);
     }
 
+    // The typedef includes the checked index function, see generate_at()
     void generate_typedef(ostream& os) const override {
         ASSERT(v_type != nullptr);
+        os << "#include \"cb_arena.h\"" << std::endl;
         os << "typedef struct { ";
         CB_u32::type->generate_type(os);
         os << " size; ";
@@ -74,6 +107,26 @@ struct CB_Seq : CB_Type, CB_Iterable, CB_Indexable
         os << "* v_ptr; } ";
         generate_type(os);
         os << ";" << std::endl;
+
+        // grows the sequence with default values if i >= size
+        os << "static inline ";
+        v_type->generate_type(os);
+        os << "* ";
+        generate_at(os);
+        os << "(";
+        generate_type(os);
+        os << "* s, int64_t i) { ";
+        os << "static _Thread_local ";
+        v_type->generate_type(os);
+        os << " _cb_tmp; if (i < 0) { _cb_tmp = ";
+        v_type->generate_literal(os, v_type->default_value().v_ptr);
+        os << "; return &_cb_tmp; } ";
+        os << "if (i >= s->size) { if (i >= s->capacity) { uint32_t c = s->capacity ? 2 * s->capacity : 16; if (c <= i) c = i + 1; ";
+        os << "s->v_ptr = _cb_realloc(s->v_ptr, s->size * sizeof(*s->v_ptr), c * sizeof(*s->v_ptr)); s->capacity = c; } ";
+        os << "for (int64_t j = s->size; j <= i; ++j) s->v_ptr[j] = ";
+        v_type->generate_literal(os, v_type->default_value().v_ptr);
+        os << "; s->size = i + 1; } ";
+        os << "return &s->v_ptr[i]; }" << std::endl;
     }
     void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override {
         ASSERT(raw_data);
@@ -99,9 +152,14 @@ struct CB_Seq : CB_Type, CB_Iterable, CB_Indexable
         os << " _it=0; _it<" << id << ".capacity; ++i) { ";
         v_type->generate_destructor(os, id+".v_ptr[_it]", depth+1);
         os << " }" << std::endl;
-        os << "free " << id << ".v_ptr;" << std::endl;
+        os << "_cb_free(" << id << ".v_ptr);" << std::endl;
+    }
+    // the elements are default values when the sequence grows, so only the sequence itself is bound
+    void generate_arena_binding(ostream& os, const std::string& id, const std::string& arena, uint32_t depth = 0) const override {
+        os << "if (!" << id << ".v_ptr) " << id << ".v_ptr = _cb_arena_empty(" << arena << ");" << std::endl;
     }
 
+
     void generate_for(ostream& os, const std::string& id, const std::string& it_name = "it", uint64_t step = 1, bool reverse = false, bool protected_scope = true) const override {
         uint64_t it_uid = get_unique_id();
         if (!protected_scope) os << "{ "; // open brace to put unique iterator name out of scope for the rest of the program
@@ -109,26 +167,44 @@ struct CB_Seq : CB_Type, CB_Iterable, CB_Indexable
         v_type->generate_type(os);
         if (!v_type->is_primitive()) os << " const*";
         os << " " << it_name << ";";
-        // for start, unique it name
-        os << "for (size_t _it_" << it_uid << " = ";
-        if(reverse) os << id << ".size-1";
-        else os << "0";
-        os << "; ";
-        // array indexing
-        os << it_name << " = ";
+        generate_for_loop(os, id, it_name, id + ".size", !v_type->is_primitive(), it_uid, step, reverse);
+    }
+    void generate_for_after_scope(ostream& os, bool protected_scope = true) const override {
+        if (!protected_scope) os << "}" << std::endl; // close the brace with unique iterator name
+    }
+
+    Shared<const CB_Type> get_iterator_type() const override { return v_type; }
+    void generate_iterator_declaration(ostream& os, const std::string& it_name) const override {
+        v_type->generate_type(os);
+        if (!v_type->is_primitive()) os << " const*"; // same as generate_for()
+        os << " " << it_name;
+    }
+    bool parallel_iterable() const override { return true; }
+    bool reallocates() const override { return true; }
+    void generate_count(ostream& os, const std::string& id, uint64_t step = 1) const override {
+        os << "(((int64_t)" << id << ".size + " << step-1 << ") / " << step << ")";
+    }
+    void generate_element(ostream& os, const std::string& id, const std::string& index, uint64_t step = 1, bool reverse = false) const override {
         if (!v_type->is_primitive()) os << "&";
         generate_index_start(os, id);
-        os << "_it_" << it_uid;
+        if (reverse) os << id << ".size - 1 - " << index << " * " << step;
+        else os << index << " * " << step;
         generate_index_end(os);
-        // stop condition
-        os << ", _it_" << it_uid;
-        if(reverse) os << " >= 0";
-        else os << " < " << id << ".size";
-        // increment/decrement
-        os << "; _it_" << uid << (reverse?" -= ":" += ") << step << ")";
     }
-    void generate_for_after_scope(ostream& os, bool protected_scope = true) const override {
-        if (!protected_scope) os << "}" << std::endl; // close the brace with unique iterator name
+
+    // the key is the index of the element
+    Shared<const CB_Type> get_key_type() const override { return CB_i64::type; }
+    void generate_for_key_value(ostream& os, const std::string& id, const std::string& key_name, const std::string& it_name, bool protected_scope = true) const override {
+        if (!protected_scope) os << "{ "; // open brace to put unique iterator name out of scope for the rest of the program
+        generate_iterator_declaration(os, it_name);
+        os << "; for (";
+        CB_i64::type->generate_type(os);
+        os << " " << key_name << " = 0; " << key_name << " < " << id << ".size && (" << it_name << " = ";
+        if (!v_type->is_primitive()) os << "&";
+        generate_index_start(os, id);
+        os << key_name;
+        generate_index_end(os);
+        os << ", 1); ++" << key_name << ")";
     }
 
     void generate_index_start(ostream& os, const std::string& id) const override {
@@ -137,6 +213,7 @@ struct CB_Seq : CB_Type, CB_Iterable, CB_Indexable
     void generate_index_end(ostream& os) const override {
         os << "]";
     }
+    void generate_at(ostream& os) const override { os << "_cb_seq_at_" << uid; }
 
 };
 
@@ -202,6 +279,7 @@ struct CB_Fixed_seq : CB_Type, CB_Iterable, CB_Indexable
     }
 
 
+    // The typedef includes the checked index function, see generate_at()
     void generate_typedef(ostream& os) const override {
         ASSERT(v_type != nullptr);
         os << "typedef ";
@@ -211,6 +289,20 @@ struct CB_Fixed_seq : CB_Type, CB_Iterable, CB_Indexable
         os << "] ";
         generate_type(os);
         os << ";" << std::endl;
+
+        // indices outside of the sequence gives a temporary default value
+        os << "static inline ";
+        v_type->generate_type(os);
+        os << "* ";
+        generate_at(os);
+        os << "(";
+        generate_type(os);
+        os << "* s, int64_t i) { ";
+        os << "static _Thread_local ";
+        v_type->generate_type(os);
+        os << " _cb_tmp; if (i < 0 || i >= " << size << ") { _cb_tmp = ";
+        v_type->generate_literal(os, v_type->default_value().v_ptr);
+        os << "; return &_cb_tmp; } return &(*s)[i]; }" << std::endl;
     }
     void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override {
         ASSERT(raw_data != nullptr);
@@ -232,7 +324,7 @@ struct CB_Fixed_seq : CB_Type, CB_Iterable, CB_Indexable
         os << " _it=0; _it<" << id << ".capacity; ++i) { ";
         v_type->generate_destructor(os, id+".v_ptr[_it]", depth+1);
         os << " }" << std::endl;
-        os << "free " << id << ".v_ptr;" << std::endl;
+        os << "_cb_free(" << id << ".v_ptr);" << std::endl;
     }
 
     void generate_for(ostream& os, const std::string& id, const std::string& it_name = "it", uint64_t step = 1, bool reverse = false, bool protected_scope = true) const override {
@@ -242,26 +334,43 @@ struct CB_Fixed_seq : CB_Type, CB_Iterable, CB_Indexable
         v_type->generate_type(os);
         if (!v_type->is_primitive()) os << " const*";
         os << " " << it_name << "; ";
-        // for start, unique it name
-        os << "for (size_t _it_" << it_uid << " = ";
-        if(reverse) os << size << "-1";
-        else os << "0";
-        os << "; ";
-        // array indexing
-        os << it_name << " = ";
+        generate_for_loop(os, id, it_name, std::to_string(size), !v_type->is_primitive(), it_uid, step, reverse);
+    }
+    void generate_for_after_scope(ostream& os, bool protected_scope = true) const override {
+        if(!protected_scope) os << "}" << std::endl; // close the brace with unique iterator name
+    }
+
+    Shared<const CB_Type> get_iterator_type() const override { return v_type; }
+    void generate_iterator_declaration(ostream& os, const std::string& it_name) const override {
+        v_type->generate_type(os);
+        if (!v_type->is_primitive()) os << " const*"; // same as generate_for()
+        os << " " << it_name;
+    }
+    bool parallel_iterable() const override { return true; }
+    void generate_count(ostream& os, const std::string& id, uint64_t step = 1) const override {
+        os << "((" << size << " + " << step-1 << ") / " << step << ")";
+    }
+    void generate_element(ostream& os, const std::string& id, const std::string& index, uint64_t step = 1, bool reverse = false) const override {
         if (!v_type->is_primitive()) os << "&";
         generate_index_start(os, id);
-        os << "_it_" << it_uid;
+        if (reverse) os << size << " - 1 - " << index << " * " << step;
+        else os << index << " * " << step;
         generate_index_end(os);
-        // stop condition
-        os << ", _it_" << it_uid;
-        if(reverse) os << " >= 0";
-        else os << " < " << size;
-        // increment/decrement
-        os << "; _it_" << uid << (reverse?" -= ":" += ") << step << ")";
     }
-    void generate_for_after_scope(ostream& os, bool protected_scope = true) const override {
-        if(!protected_scope) os << "}" << std::endl; // close the brace with unique iterator name
+
+    // the key is the index of the element
+    Shared<const CB_Type> get_key_type() const override { return CB_i64::type; }
+    void generate_for_key_value(ostream& os, const std::string& id, const std::string& key_name, const std::string& it_name, bool protected_scope = true) const override {
+        if (!protected_scope) os << "{ "; // open brace to put unique iterator name out of scope for the rest of the program
+        generate_iterator_declaration(os, it_name);
+        os << "; for (";
+        CB_i64::type->generate_type(os);
+        os << " " << key_name << " = 0; " << key_name << " < " << size << " && (" << it_name << " = ";
+        if (!v_type->is_primitive()) os << "&";
+        generate_index_start(os, id);
+        os << key_name;
+        generate_index_end(os);
+        os << ", 1); ++" << key_name << ")";
     }
 
     void generate_index_start(ostream& os, const std::string& id) const override {
@@ -270,6 +379,7 @@ struct CB_Fixed_seq : CB_Type, CB_Iterable, CB_Indexable
     void generate_index_end(ostream& os) const override {
         os << "]";
     }
+    void generate_at(ostream& os) const override { os << "_cb_fixed_seq_at_" << uid; }
 };
 
 
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "cb_type.h"
+#include "cb_primitives.h"
+#include "cb_range.h"
+#include "cb_seq.h" // CB_Indexable
+#include "cb_struct.h"
+#include "../utilities/unique_id.h"
+#include "../utilities/pointers.h"
+
+/*
+CB_Soa_seq: a dynamic sequence of structs, stored as one array per struct member ("struct of arrays")
+
+Syntax:
+Particle : type : struct { x, y, vx, vy : f32; id : u64; };
+s : [..] #soa Particle;
+
+for (p in s) { p.x = p.x + p.vx; }  // only the arrays for x and vx are touched
+
+Generated c code:
+typedef struct { _cb_u32 size; _cb_u32 capacity; _cb_f32* x; _cb_f32* y; _cb_f32* vx; _cb_f32* vy; _cb_u64* id; } _cb_type_30;
+
+Loops that only use a few members of a wide struct read contiguous memory, and can be vectorized by the c compiler.
+The iterator of a for loop is an index into the arrays. Member access on the iterator is generated as
+    s.member[it], and the iterator used as a value is gathered into a struct with _cb_soa_get_N(s, it).
+
+s[i] works like indexing a [..] sequence (see Abstx_seq_index): the sequence grows if i >= size, and negative indices
+    read a default value. The elements aren't c lvalues, so s[i] = v is generated as _cb_soa_put_N(&s, i, v),
+    and s[i].x = v reads the whole element, changes it, and writes it back.
+When the index is known to be inside the sequence (for example the key of a loop over s), s[i] is generated as
+    _cb_soa_get_N(s, i), s[i] = v as _cb_soa_set_N(&s, i, v), and s[i].x as s.x[i].
+*/
+
+struct CB_Soa_seq : CB_Type, CB_Iterable, CB_Indexable
+{
+    Shared<const CB_Struct> v_type = nullptr;
+    void* _default_value = nullptr; // size and capacity 0, all arrays null
+
+    CB_Soa_seq(bool explicit_unresolved=false) { uid = type->uid; if (explicit_unresolved) finalize(); }
+    CB_Soa_seq(const std::string& name, size_t size, void const* default_value) : CB_Type(name, size, default_value) {}
+    ~CB_Soa_seq() { free(_default_value); }
+
+    static Shared<const CB_Type> get_soa_seq_type(Shared<const CB_Struct> member_type) {
+        Owned<CB_Soa_seq> o = alloc(CB_Soa_seq());
+        o->v_type = member_type;
+        o->finalize();
+        return add_complex_cb_type(owned_static_cast<CB_Type>(std::move(o)));
+    }
+
+    std::string toS() const override {
+        if (v_type == nullptr) return "_cb_unresolved_soa_sequence";
+        std::ostringstream oss;
+        oss << "#soa ";
+        v_type->generate_type(oss); // same as CB_Seq
+        oss << "[]";
+        return oss.str();
+    }
+
+    bool is_primitive() const override { return false; }
+
+    virtual size_t alignment() const override { return alignof(void*); }
+
+    // layout of the c struct: size and capacity, then one pointer per member
+    static constexpr size_t header_size = 2 * sizeof(uint32_t);
+    size_t c_size() const { return header_size + (v_type ? v_type->members.size : 0) * sizeof(void*); }
+
+    void finalize() override {
+        _default_value = calloc(1, c_size());
+
+        std::string tos = toS();
+        for (const auto& tn_pair : typenames) {
+            if (tn_pair.second == tos) {
+                // found existing sequence type with the same signature -> grab its id
+                uid = tn_pair.first;
+                return;
+            }
+        }
+        // no matching signature found -> register new type
+        register_type(tos, c_size(), _default_value);
+    }
+
+    // The typedef includes typed helpers:
+    //  _cb_soa_get_N(s, i) returns element i as a struct
+    //  _cb_soa_set_N(&s, i, v) sets all members of element i
+    //  _cb_soa_push_N(&s, v) adds an element at the end, growing all arrays if necessary
+    //  _cb_soa_at_N(&s, i) and _cb_soa_put_N(&s, i, v) are the checked versions of get and set, see generate_at()
+    void generate_typedef(ostream& os) const override {
+        ASSERT(v_type != nullptr);
+        os << "#include \"cb_arena.h\"" << std::endl;
+        os << "typedef struct { ";
+        CB_u32::type->generate_type(os);
+        os << " size; ";
+        CB_u32::type->generate_type(os);
+        os << " capacity; ";
+        for (const auto& member : v_type->members) {
+            member.id->value.v_type->generate_type(os);
+            os << "* " << member_name(member) << "; ";
+        }
+        os << "} ";
+        generate_type(os);
+        os << ";" << std::endl;
+
+        os << "static inline ";
+        v_type->generate_type(os);
+        os << " _cb_soa_get_" << uid << "(";
+        generate_type(os);
+        os << " s, int64_t i) { ";
+        v_type->generate_type(os);
+        os << " v; ";
+        for (const auto& member : v_type->members) os << "v." << member_name(member) << " = s." << member_name(member) << "[i]; ";
+        os << "return v; }" << std::endl;
+
+        os << "static inline void _cb_soa_set_" << uid << "(";
+        generate_type(os);
+        os << "* s, int64_t i, ";
+        v_type->generate_type(os);
+        os << " v) { ";
+        for (const auto& member : v_type->members) os << "s->" << member_name(member) << "[i] = v." << member_name(member) << "; ";
+        os << "}" << std::endl;
+
+        os << "static inline void _cb_soa_push_" << uid << "(";
+        generate_type(os);
+        os << "* s, ";
+        v_type->generate_type(os);
+        os << " v) { if (s->size == s->capacity) { s->capacity = s->capacity ? 2 * s->capacity : 16; ";
+        for (const auto& member : v_type->members) {
+            os << "s->" << member_name(member) << " = _cb_realloc(s->" << member_name(member) << ", s->size * sizeof(*s->" << member_name(member) << "), s->capacity * sizeof(*s->" << member_name(member) << ")); ";
+        }
+        os << "} _cb_soa_set_" << uid << "(s, s->size++, v); }" << std::endl;
+
+        // grows the sequence with default values if i >= size
+        os << "static inline ";
+        v_type->generate_type(os);
+        os << " ";
+        generate_at(os);
+        os << "(";
+        generate_type(os);
+        os << "* s, int64_t i) { if (i < 0) return ";
+        v_type->generate_literal(os, v_type->default_value().v_ptr);
+        os << "; while (i >= s->size) _cb_soa_push_" << uid << "(s, ";
+        v_type->generate_literal(os, v_type->default_value().v_ptr);
+        os << "); return _cb_soa_get_" << uid << "(*s, i); }" << std::endl;
+
+        os << "static inline void ";
+        generate_put(os);
+        os << "(";
+        generate_type(os);
+        os << "* s, int64_t i, ";
+        v_type->generate_type(os);
+        os << " v) { if (i < 0) return; while (i >= s->size) _cb_soa_push_" << uid << "(s, ";
+        v_type->generate_literal(os, v_type->default_value().v_ptr);
+        os << "); _cb_soa_set_" << uid << "(s, i, v); }" << std::endl;
+    }
+
+    // Constant sequences are built with a gnu statement expression, the same way as map literals
+    void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override {
+        ASSERT(raw_data);
+        if (depth > MAX_ALLOWED_DEPTH) { post_circular_reference_error(); return; }
+        uint32_t size = *(uint32_t const*)raw_data;
+        if (size == 0) {
+            os << "(";
+            generate_type(os);
+            os << "){0}";
+            return;
+        }
+        void* const* arrays = (void* const*)((uint8_t const*)raw_data + header_size);
+        uint8_t* element = (uint8_t*)malloc(v_type->cb_sizeof());
+        os << "({ ";
+        generate_type(os);
+        os << " _cb_s = {0}; ";
+        for (uint32_t i = 0; i < size; ++i) {
+            for (uint32_t m = 0; m < v_type->members.size; ++m) {
+                size_t member_size = v_type->members[m].id->value.v_type->cb_sizeof();
+                memcpy(element + v_type->members[m].byte_position, (uint8_t const*)arrays[m] + i * member_size, member_size);
+            }
+            os << "_cb_soa_push_" << uid << "(&_cb_s, ";
+            v_type->generate_literal(os, element, depth+1);
+            os << "); ";
+        }
+        os << "_cb_s; })";
+        free(element);
+    }
+
+    void generate_destructor(ostream& os, const std::string& id, uint32_t depth = 0) const override {
+        if (depth > MAX_ALLOWED_DEPTH) { post_circular_reference_error(); return; }
+        for (const auto& member : v_type->members) {
+            std::string array = id + "." + member_name(member);
+            os << "if (" << array << ") { for (";
+            CB_u32::type->generate_type(os);
+            os << " _it=0; _it<" << id << ".size; ++_it) { ";
+            member.id->value.v_type->generate_destructor(os, array + "[_it]", depth+1);
+            os << " } _cb_free(" << array << "); }" << std::endl;
+        }
+    }
+    void generate_arena_binding(ostream& os, const std::string& id, const std::string& arena, uint32_t depth = 0) const override {
+        for (const auto& member : v_type->members) {
+            std::string array = id + "." + member_name(member);
+            os << "if (!" << array << ") " << array << " = _cb_arena_empty(" << arena << ");" << std::endl;
+        }
+    }
+
+    // The c iterator is an index, see generate_iterator_value() and generate_iterator_member()
+    void generate_for(ostream& os, const std::string& id, const std::string& it_name = "it", uint64_t step = 1, bool reverse = false, bool protected_scope = true) const override {
+        if (!protected_scope) os << "{ ";
+        os << "for (int64_t " << it_name << " = ";
+        if (reverse) os << "(int64_t)" << id << ".size-1; " << it_name << " >= 0; " << it_name << " -= " << step << ")";
+        else os << "0; " << it_name << " < " << id << ".size; " << it_name << " += " << step << ")";
+    }
+    void generate_for_after_scope(ostream& os, bool protected_scope = true) const override {
+        if (!protected_scope) os << "}" << std::endl;
+    }
+
+    Shared<const CB_Type> get_iterator_type() const override { return static_pointer_cast<const CB_Type>(v_type); }
+    void generate_iterator_declaration(ostream& os, const std::string& it_name) const override {
+        os << "int64_t " << it_name;
+    }
+    bool iterator_is_index() const override { return true; }
+
+    // the key is the same index as the iterator
+    Shared<const CB_Type> get_key_type() const override { return CB_i64::type; }
+    void generate_for_key_value(ostream& os, const std::string& id, const std::string& key_name, const std::string& it_name, bool protected_scope = true) const override {
+        if (!protected_scope) os << "{ ";
+        generate_iterator_declaration(os, it_name);
+        os << "; for (";
+        CB_i64::type->generate_type(os);
+        os << " " << key_name << " = 0; " << key_name << " < " << id << ".size && (" << it_name << " = " << key_name << ", 1); ++" << key_name << ")";
+    }
+    void generate_iterator_value(ostream& os, const std::string& id, const std::string& it_name) const override {
+        generate_index_start(os, id);
+        os << it_name;
+        generate_index_end(os);
+    }
+    void generate_iterator_member(ostream& os, const std::string& id, const std::string& it_name, const std::string& member) const override {
+        generate_field_index(os, id, it_name, member);
+    }
+
+    bool parallel_iterable() const override { return true; }
+    bool reallocates() const override { return true; }
+    void generate_count(ostream& os, const std::string& id, uint64_t step = 1) const override {
+        os << "(((int64_t)" << id << ".size + " << step-1 << ") / " << step << ")";
+    }
+    void generate_element(ostream& os, const std::string& id, const std::string& index, uint64_t step = 1, bool reverse = false) const override {
+        if (reverse) os << id << ".size - 1 - " << index << " * " << step;
+        else os << index << " * " << step;
+    }
+
+    // indexing the whole element gathers all members into a struct
+    void generate_index_start(ostream& os, const std::string& id) const override {
+        os << "_cb_soa_get_" << uid << "(" << id << ", ";
+    }
+    void generate_index_end(ostream& os) const override {
+        os << ")";
+    }
+    // returns the element by value, not a pointer like CB_Seq::generate_at()
+    void generate_at(ostream& os) const override { os << "_cb_soa_at_" << uid; }
+    void generate_set(ostream& os) const { os << "_cb_soa_set_" << uid; }
+    void generate_put(ostream& os) const { os << "_cb_soa_put_" << uid; }
+    // s[i].member only touches one array
+    void generate_field_index(ostream& os, const std::string& id, const std::string& index, const std::string& member) const {
+        os << id << "." << member << "[" << index << "]";
+    }
+
+private:
+    static std::string member_name(const CB_Struct::Struct_member& member) {
+        std::ostringstream oss;
+        member.id->generate_code(oss);
+        return oss.str();
+    }
+};
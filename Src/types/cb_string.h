@@ -5,42 +5,130 @@
 
 #include <string>
 #include <cstring> // strlen, strcmp
+#include <cctype> // isxdigit, tolower
+#include <algorithm> // min
+#include "../backend_c/cb_string.h"
 
 /*
-String - Worls like a dynamic array of characters
-Actual allocated size is size+1 - the last character is always '\0'
+String - Works like a dynamic array of characters
+The size is stored explicitly, and the data is always followed by a '\0' (see backend_c/cb_string.h for the runtime)
+Short strings (up to 22 bytes) are stored inline, without allocating.
 
 Operating on individual chars is currently not allowed, since it would behave strangely when using utf-8.
 
 Syntax:
 a : String = "text";
+
+In #c code, use _cb_string_cstr(&a) to get a null terminated char const*, and _cb_string_size(&a) for the size in bytes.
 */
 
 struct CB_String : CB_Type {
     static const Shared<const CB_Type> type;
-    static constexpr char _default_str[] = "";
-    static constexpr char const* _default_value = _default_str;
-    typedef char* c_typedef;
+    static const _cb_string _default_value; // the empty string; all zeros
+    typedef _cb_string c_typedef;
 
     CB_String() { uid = type->uid; }
     CB_String(const std::string& name, size_t size, void const* default_value) : CB_Type(name, size, default_value) {}
     std::string toS() const override { return "string"; }
 
-    bool is_primitive() const override { return true; }
+    bool is_primitive() const override { return false; } // 24 bytes; passed by const pointer like sequences
+
+    virtual size_t alignment() const override { return alignof(_cb_string); }
 
     void generate_type(ostream& os) const override { os << "_cb_string"; }
 
     void generate_typedef(ostream& os) const override {
-        // for now, just use regular null-terminated char*
-        os << "typedef char* ";
-        generate_type(os);
-        os << ";" << std::endl;
+        // _cb_string is defined in the runtime header
+        os << "#include \"cb_string.h\"" << std::endl;
     }
+
+    // Literals never allocate: short strings are stored inline, and long strings point to the c string literal
     void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override {
         ASSERT(raw_data);
-        char const* raw_str = *(c_typedef const*)raw_data;
-        if (!raw_str) os << "NULL";
-        os << "\"" << raw_str << "\"";
+        c_typedef const* str = (c_typedef const*)raw_data;
+        uint64_t size = _cb_string_size(str);
+        os << "((";
+        generate_type(os);
+        if (size <= _CB_STRING_SMALL_MAX) {
+            os << "){ .small = { ";
+            generate_c_string_literal(os, _cb_string_cstr(str), size);
+            os << ", " << size << " } })";
+        } else {
+            os << "){ .large = { (char*)";
+            generate_c_string_literal(os, _cb_string_cstr(str), size);
+            os << ", " << size << "ULL, _CB_STRING_LARGE_FLAG } })";
+        }
+    }
+    void generate_destructor(ostream& os, const std::string& id, uint32_t depth = 0) const override {
+        os << "_cb_string_free(&" << id << ");" << std::endl;
+    }
+
+    // "text" with c escape sequences
+    static void generate_c_string_literal(ostream& os, char const* data, uint64_t size) {
+        os << "\"";
+        for (uint64_t i = 0; i < size; ++i) {
+            unsigned char c = data[i];
+            if (c == '\\' || c == '"') os << '\\' << c;
+            else if (c == '\n') os << "\\n";
+            else if (c < 0x20 || c == 0x7f) {
+                // octal escapes are at most 3 digits, so they can't swallow the next character
+                const char* digits = "01234567";
+                os << '\\' << digits[(c >> 6) & 7] << digits[(c >> 3) & 7] << digits[c & 7];
+            }
+            else os << c;
+        }
+        os << "\"";
+    }
+
+    // string literal tokens still contain their escape sequences, with the same meaning as in c:
+    //     \a \b \f \n \r \t \v \\ \' \" \? \ooo (1-3 octal digits) \xhh (hex digits)
+    // returns false for other escape sequences, and sets bad_escape to the first of them; the string then ends before it
+    static bool from_token(const std::string& token, c_typedef& result, std::string& bad_escape) {
+        std::string str;
+        str.reserve(token.size());
+        bool ok = true;
+        for (size_t i = 0; i < token.size() && ok; ++i) {
+            if (token[i] != '\\' || i+1 == token.size()) {
+                str += token[i];
+                continue;
+            }
+            size_t start = i;
+            char c = token[++i];
+            switch (c) {
+                case 'a': str += '\a'; break;
+                case 'b': str += '\b'; break;
+                case 'f': str += '\f'; break;
+                case 'n': str += '\n'; break;
+                case 'r': str += '\r'; break;
+                case 't': str += '\t'; break;
+                case 'v': str += '\v'; break;
+                case '\\': case '\'': case '"': case '?': str += c; break;
+                case 'x': {
+                    unsigned value = 0;
+                    size_t digits = 0;
+                    while (i+1 < token.size() && isxdigit((unsigned char)token[i+1])) {
+                        char d = token[++i];
+                        value = std::min(value * 16 + (isdigit((unsigned char)d) ? d - '0' : tolower(d) - 'a' + 10), 0x100u);
+                        digits++;
+                    }
+                    ok = digits > 0 && value <= 0xff;
+                    if (ok) str += (char)value;
+                    break;
+                }
+                default:
+                    if (c >= '0' && c <= '7') {
+                        unsigned value = c - '0';
+                        for (int n = 1; n < 3 && i+1 < token.size() && token[i+1] >= '0' && token[i+1] <= '7'; ++n) value = value * 8 + (token[++i] - '0');
+                        ok = value <= 0xff;
+                        if (ok) str += (char)value;
+                    } else {
+                        ok = false;
+                    }
+            }
+            if (!ok) bad_escape = token.substr(start, i+1 - start);
+        }
+        result = _cb_string_from(str.data(), str.size()); // also set on errors, so that the literal is still a valid string
+        return ok;
     }
 };
 
@@ -55,84 +143,47 @@ struct CB_String : CB_Type {
 
 
 // Below: utilities version of any that can be used in c++
+// Uses the same representation as the runtime, so it doesn't allocate for short strings.
 
 struct _string {
-    uint32_t size = 0; // size in bytes, not in UTF-8 characters
-    uint32_t capacity = 0;
-    char* v_ptr = nullptr;
+    _cb_string str = {};
 
     std::string toS() const {
-        ASSERT(v_ptr != nullptr);
-        return std::string(v_ptr);
+        return std::string(_cb_string_cstr(&str), _cb_string_size(&str));
     }
+    uint64_t size() const { return _cb_string_size(&str); }
+    char const* c_str() const { return _cb_string_cstr(&str); }
 
-    // default constructor
-    _string() {
-        v_ptr = (char*)malloc(capacity+1);
-        memset(v_ptr, 0, capacity+1);
-    }
-    _string(const std::string& str) {
-        size = str.length();
-        capacity = size;
-        v_ptr = (char*)malloc(size+1);
-        memcpy(v_ptr, str.c_str(), size+1);
-    }
-    _string(const char* cstr) {
-        size = strlen(cstr);
-        capacity = size;
-        v_ptr = (char*)malloc(size+1);
-        memcpy(v_ptr, cstr, size+1);
-    }
+    _string() {}
+    _string(const std::string& s) : str{_cb_string_from(s.data(), s.size())} {}
+    _string(const char* cstr) : str{_cb_string_from_cstr(cstr)} {}
 
     // copy
-    _string& operator=(const _string& str) {
-        if (capacity < str.size)
-            reallocate(str.size, false);
-        ASSERT(capacity >= str.size);
-        ASSERT(v_ptr != nullptr);
-        size = str.size;
-        memcpy(v_ptr, str.v_ptr, size+1);
+    _string& operator=(const _string& s) {
+        if (this == &s) return *this;
+        _cb_string_free(&str);
+        str = _cb_string_copy(&s.str);
         return *this;
     }
-    _string(const _string& str) {
-        v_ptr = (char*)malloc(capacity+1);
-        memset(v_ptr, 0, capacity+1);
-        *this = str;
-    }
+    _string(const _string& s) : str{_cb_string_copy(&s.str)} {}
 
     // move
-    _string& operator=(_string&& str) {
-        free(v_ptr);
-        size = str.size;
-        v_ptr = str.v_ptr;
-        str.v_ptr = nullptr;
+    _string& operator=(_string&& s) {
+        if (this == &s) return *this;
+        _cb_string_free(&str);
+        str = s.str;
+        s.str = {};
         return *this;
     }
-    _string(_string&& str) {
-        *this = std::move(str);
-    }
+    _string(_string&& s) : str{s.str} { s.str = {}; }
 
     // destructor
-    ~_string() {
-        free(v_ptr);
-        v_ptr = nullptr;
-    }
-
-    bool operator==(const _string& str) const { return size == str.size && strcmp(v_ptr, str.v_ptr) == 0; }
-    bool operator!=(const _string& str) const { !(*this == str); }
-    bool operator<(const _string& str) const { return strcmp(v_ptr, str.v_ptr) < 0; }
-    bool operator>=(const _string& str) const { return !(*this < str); }
-    bool operator>(const _string& str) const { return str < *this; }
-    bool operator<=(const _string& str) const { return !(str < *this); }
-
-    void reallocate(uint32_t capacity, bool move=true) {
-        this->capacity = capacity;
-        char* new_ptr = (char*)malloc(capacity+1);
-        ASSERT(new_ptr != nullptr);
-        if (capacity < size) size = capacity;
-        if (move) memcpy(new_ptr, v_ptr, size+1);
-        free(v_ptr);
-        v_ptr = new_ptr;
-    }
+    ~_string() { _cb_string_free(&str); }
+
+    bool operator==(const _string& s) const { return _cb_string_eq(&str, &s.str); }
+    bool operator!=(const _string& s) const { return !(*this == s); }
+    bool operator<(const _string& s) const { return toS() < s.toS(); }
+    bool operator>=(const _string& s) const { return !(*this < s); }
+    bool operator>(const _string& s) const { return s < *this; }
+    bool operator<=(const _string& s) const { return !(s < *this); }
 };
-
@@ -7,6 +7,7 @@
 
 #include <string>
 #include <iomanip>
+#include <utility>
 
 #define ONELINE_STRUCT_DEFINITIONS true
 
@@ -23,6 +24,14 @@ a.a = 4;
 a.b = "asd";
 a.ásdas; // log_error("ásdas is not a member of a", context);
 
+U := struct #packed_reorder
+    {
+        a : u8;
+        b : i64;
+        c : bool;
+    };
+// the members are laid out as b, a, c: 16 bytes instead of 24. Members are still accessed by name.
+
 typeof(T) // type
 valueof(T) // unik struct_type (ny för varje "struct"-keyword)
 
@@ -100,9 +109,11 @@ struct CB_Struct : CB_Type
         }
     };
 
-    Seq<Struct_member> members;
+    Seq<Struct_member> members; // in memory order; the same as declaration order unless packed_reorder is set
     void* _default_value = nullptr;
     size_t max_alignment = 0;
+    bool packed_reorder = false; // sort the members by alignment to minimize padding
+    size_t declared_size = 0; // the size the struct would have with the members in declaration order
 
     // Constructors has to be speficied, otherwise the default move constructor is used when we want to copy
     CB_Struct() {}
@@ -110,6 +121,7 @@ struct CB_Struct : CB_Type
     CB_Struct(CB_Struct&& sm) { *this = std::move(sm); }
     CB_Struct& operator=(const CB_Struct& sm) {
         uid=sm.uid; members = sm.members; max_alignment=sm.max_alignment;
+        packed_reorder = sm.packed_reorder; declared_size = sm.declared_size;
         _default_value = malloc(sm.cb_sizeof());
         memcpy(_default_value, sm._default_value, sm.cb_sizeof());
     }
@@ -118,12 +130,15 @@ struct CB_Struct : CB_Type
         members = std::move(sm.members);
         _default_value = sm._default_value; sm._default_value = nullptr;
         max_alignment=sm.max_alignment;
+        packed_reorder = sm.packed_reorder; declared_size = sm.declared_size;
     }
     ~CB_Struct() { free(_default_value); }
 
     std::string toS() const override {
         std::ostringstream oss;
-        oss << "struct { ";
+        oss << "struct ";
+        if (packed_reorder) oss << "#packed_reorder ";
+        oss << "{ ";
         for (int i = 0; i < members.size; ++i) {
             oss << members[i].toS();
             oss << "; ";
@@ -152,11 +167,22 @@ struct CB_Struct : CB_Type
         size_t total_size = 0;
         if (members.empty()) {
             total_size = 1;
+            declared_size = 1;
             _default_value = malloc(total_size);
             // actual default value doesn't matter since it will never be used anyway
         } else {
+            declared_size = layout_size();
+            if (packed_reorder) {
+                // stable insertion sort by decreasing alignment; this never needs more padding than any other order,
+                //  since every member then starts at an offset which is a multiple of its alignment
+                for (uint32_t i = 1; i < members.size; ++i) {
+                    for (uint32_t j = i; j > 0 && member_alignment(members[j-1]) < member_alignment(members[j]); --j) {
+                        std::swap(members[j-1], members[j]);
+                    }
+                }
+            }
+
             // go through all members, assign them byte positions
-            // (TODO: rearrange the members if it would save space)
             for (auto& member : members) {
                 // add memory alignment for 16 / 32 bit or bigger values (since this is done in C by default)
                 size_t alignment = member.id->value.v_type->alignment();
@@ -223,8 +249,33 @@ struct CB_Struct : CB_Type
             member.id->value.v_type->generate_destructor(os, id + "." + member.id->name, depth+1);
         }
     };
+    void generate_arena_binding(ostream& os, const std::string& id, const std::string& arena, uint32_t depth = 0) const override {
+        if (depth > MAX_ALLOWED_DEPTH) { post_circular_reference_error(); return; }
+        for (const auto& member : members) {
+            member.id->value.v_type->generate_arena_binding(os, id + "." + member.id->name, arena, depth+1);
+        }
+    };
+
+    size_t bytes_saved() const { return declared_size - cb_sizeof(); }
 
 private:
+    static size_t member_alignment(const Struct_member& member) {
+        return member.id->value.v_type->alignment();
+    }
+
+    // size of the struct with the members in their current order
+    size_t layout_size() const {
+        size_t size = 0, max_align = 1;
+        for (const auto& member : members) {
+            size_t alignment = member_alignment(member);
+            align(&size, alignment);
+            size += member.id->value.v_type->cb_sizeof();
+            if (alignment > max_align) max_align = alignment;
+        }
+        align(&size, max_align);
+        return size;
+    }
+
     static void align(size_t* v, size_t alignment) {
         *v += (alignment - *v % alignment) % alignment;
     }
@@ -143,6 +143,9 @@ struct CB_Type
     // literal & destructor has an additional argument depth, to safeguard against infinite loops
     virtual void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const { ASSERT(raw_data); os << *(c_typedef*)raw_data << "UL"; }
     virtual void generate_destructor(ostream& os, const std::string& id, uint32_t depth = 0) const { };
+    // generated after the declaration of id inside an #arena scope: binds the empty containers in id to the arena,
+    //   so that they grow in it (see backend_c/cb_arena.h). arena is a c expression of type _cb_arena*
+    virtual void generate_arena_binding(ostream& os, const std::string& id, const std::string& arena, uint32_t depth = 0) const { };
     // constructor:
     //   type name = literal(default_value); // default
     //   type name; // explicit uninitialized
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "cb_type.h"
+#include "cb_primitives.h"
+
+/*
+CB_Vector: fixed width SIMD vectors of a primitive number type, e.g. v4f32 (4 x f32) or v8i32 (8 x i32)
+The vector types are defined in compile_time/built_in_operators.h, using gcc vector extensions.
+A vector is aligned to its full size, just like the gcc vector types.
+
+Syntax:
+a : v4f32;
+b := v4f32(2.0);        // every lane set to the same value (converted to the lane type)
+c := v4f32(s, i);       // the 4 elements of the sequence s starting at index i; can also be assigned to
+d := a * b + c;         // operators work element-wise, see Abstx_infix_operator
+
+Available types:
+128 bit: v16i8, v8i16, v4i32, v2i64, v16u8, v8u16, v4u32, v2u64, v4f32, v2f64
+256 bit: v8i32, v4i64, v8u32, v4u64, v8f32, v4f64
+*/
+
+struct CB_Vector : CB_Type {
+    CB_Vector() {}
+    CB_Vector(const std::string& name, size_t size, void const* default_value) : CB_Type(name, size, default_value) {}
+
+    virtual Shared<const CB_Type> lane_type() const = 0;
+    virtual size_t lanes() const = 0;
+
+    bool is_primitive() const override { return true; }
+
+    // gcc aligns vector_size types to their full size
+    virtual size_t alignment() const override { return cb_sizeof(); }
+
+    void generate_type(ostream& os) const override { os << "_cb_" << toS(); }
+
+    void generate_typedef(ostream& os) const override; // see below
+
+    void generate_literal(ostream& os, void const* raw_data, uint32_t depth = 0) const override {
+        ASSERT(raw_data);
+        uint8_t const* raw_it = (uint8_t const*)raw_data;
+        os << "((";
+        generate_type(os);
+        os << "){ ";
+        for (size_t i = 0; i < lanes(); ++i) {
+            if (i) os << ", ";
+            lane_type()->generate_literal(os, raw_it, depth+1);
+            raw_it += lane_type()->cb_sizeof();
+        }
+        os << " })";
+    }
+};
+
+#define GENERATE_VECTOR(cpp_type, tos, lane_cpp_type, lane_count) \
+struct cpp_type : CB_Vector { \
+    static const Shared<const CB_Type> type; \
+    static constexpr lane_cpp_type::c_typedef _default_value[lane_count] = {}; \
+    cpp_type() { uid = type->uid; } \
+    cpp_type(const std::string& name, size_t size, void const* default_value) : CB_Vector(name, size, default_value) {} \
+    std::string toS() const override { return tos; } \
+    Shared<const CB_Type> lane_type() const override { return lane_cpp_type::type; } \
+    size_t lanes() const override { return lane_count; } \
+}
+
+GENERATE_VECTOR(CB_v16i8, "v16i8", CB_i8, 16);
+GENERATE_VECTOR(CB_v8i16, "v8i16", CB_i16, 8);
+GENERATE_VECTOR(CB_v4i32, "v4i32", CB_i32, 4);
+GENERATE_VECTOR(CB_v2i64, "v2i64", CB_i64, 2);
+GENERATE_VECTOR(CB_v16u8, "v16u8", CB_u8, 16);
+GENERATE_VECTOR(CB_v8u16, "v8u16", CB_u16, 8);
+GENERATE_VECTOR(CB_v4u32, "v4u32", CB_u32, 4);
+GENERATE_VECTOR(CB_v2u64, "v2u64", CB_u64, 2);
+GENERATE_VECTOR(CB_v4f32, "v4f32", CB_f32, 4);
+GENERATE_VECTOR(CB_v2f64, "v2f64", CB_f64, 2);
+
+GENERATE_VECTOR(CB_v8i32, "v8i32", CB_i32, 8);
+GENERATE_VECTOR(CB_v4i64, "v4i64", CB_i64, 4);
+GENERATE_VECTOR(CB_v8u32, "v8u32", CB_u32, 8);
+GENERATE_VECTOR(CB_v4u64, "v4u64", CB_u64, 4);
+GENERATE_VECTOR(CB_v8f32, "v8f32", CB_f32, 8);
+GENERATE_VECTOR(CB_v4f64, "v4f64", CB_f64, 4);
+
+// all vector types and their operators are defined in the same header, so it's only included by the first vector type
+inline void CB_Vector::generate_typedef(ostream& os) const {
+    if (uid == CB_v16i8::type->uid) os << "#include \"built_in_operators.h\"" << std::endl;
+}
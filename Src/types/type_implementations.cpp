@@ -83,11 +83,39 @@ static const CB_Float_range static_cb_float_range("range", sizeof(CB_Float_range
 const Shared<const CB_Type> CB_Float_range::type = &static_cb_range;
 
 #include "cb_string.h"
-constexpr char CB_String::_default_str[];
-constexpr char const* CB_String::_default_value;
-static const CB_String static_cb_string("string", sizeof(&CB_String::_default_value), &CB_String::_default_value);
+const _cb_string CB_String::_default_value = {};
+static const CB_String static_cb_string("string", sizeof(CB_String::_default_value), &CB_String::_default_value);
 const Shared<const CB_Type> CB_String::type = &static_cb_string;
 
+#include "cb_function.h"
+constexpr void* CB_Generic_function::_default_value;
+static const CB_Generic_function static_cb_generic_function("generic_fn", sizeof(CB_Generic_function::_default_value), &CB_Generic_function::_default_value);
+const Shared<const CB_Type> CB_Generic_function::type = &static_cb_generic_function;
+
+#include "cb_vector.h"
+#define VECTOR_STATICS(cpp_type, tos) \
+constexpr decltype(cpp_type::_default_value) cpp_type::_default_value; \
+static const cpp_type static_##cpp_type(tos, sizeof(cpp_type::_default_value), &cpp_type::_default_value); \
+const Shared<const CB_Type> cpp_type::type = &static_##cpp_type;
+
+VECTOR_STATICS(CB_v16i8, "v16i8");
+VECTOR_STATICS(CB_v8i16, "v8i16");
+VECTOR_STATICS(CB_v4i32, "v4i32");
+VECTOR_STATICS(CB_v2i64, "v2i64");
+VECTOR_STATICS(CB_v16u8, "v16u8");
+VECTOR_STATICS(CB_v8u16, "v8u16");
+VECTOR_STATICS(CB_v4u32, "v4u32");
+VECTOR_STATICS(CB_v2u64, "v2u64");
+VECTOR_STATICS(CB_v4f32, "v4f32");
+VECTOR_STATICS(CB_v2f64, "v2f64");
+
+VECTOR_STATICS(CB_v8i32, "v8i32");
+VECTOR_STATICS(CB_v4i64, "v4i64");
+VECTOR_STATICS(CB_v8u32, "v8u32");
+VECTOR_STATICS(CB_v4u64, "v4u64");
+VECTOR_STATICS(CB_v8f32, "v8f32");
+VECTOR_STATICS(CB_v4f64, "v4f64");
+
 #include "cb_pointer.h"
 constexpr void* CB_Pointer::_default_value;
 // an explicit unresolved_pointer is needed just so that unresolved pointers can be used and thrown away without storing
@@ -115,6 +143,23 @@ static const CB_Seq _unresolved_sequence = CB_Seq(true);
 static const CB_Fixed_seq _unresolved_fixed_sequence = CB_Fixed_seq(true);
 // type is registered with CB_Fixed_seq::finalize()
 
+#include "cb_soa_seq.h"
+// same reason as for unresolved sequences
+static const CB_Soa_seq _unresolved_soa_sequence = CB_Soa_seq(true);
+// type is registered with CB_Soa_seq::finalize()
+
+#include "cb_channel.h"
+constexpr void* CB_Channel::_default_value;
+// same reason as for unresolved pointers
+static const CB_Channel _unresolved_channel = CB_Channel(true);
+// type is registered with CB_Channel::finalize()
+
+#include "cb_map.h"
+constexpr _cb_map CB_Map::_default_value;
+// same reason as for unresolved sequences
+static const CB_Map _unresolved_map = CB_Map(true);
+// type is registered with CB_Map::finalize()
+
 
 
 
@@ -136,8 +181,8 @@ Shared<const CB_Type> parse_type(const Any& any) {
 std::string parse_string(const Any& any) {
     ASSERT(*any.v_type == *CB_String::type);
     ASSERT(any.v_ptr);
-    ASSERT(*(char**)any.v_ptr);
-    return std::string(*(char**)any.v_ptr);
+    CB_String::c_typedef const* str = (CB_String::c_typedef const*)any.v_ptr;
+    return std::string(_cb_string_cstr(str), _cb_string_size(str));
 }
 
 int64_t parse_int(const Any& any) {
@@ -208,6 +253,22 @@ void prepare_built_in_types() {
     CB_Type::built_in_types[static_cb_range.uid] = &static_cb_range;
     CB_Type::built_in_types[static_cb_float_range.uid] = &static_cb_float_range;
     CB_Type::built_in_types[static_cb_string.uid] = &static_cb_string;
+    CB_Type::built_in_types[static_CB_v16i8.uid] = &static_CB_v16i8;
+    CB_Type::built_in_types[static_CB_v8i16.uid] = &static_CB_v8i16;
+    CB_Type::built_in_types[static_CB_v4i32.uid] = &static_CB_v4i32;
+    CB_Type::built_in_types[static_CB_v2i64.uid] = &static_CB_v2i64;
+    CB_Type::built_in_types[static_CB_v16u8.uid] = &static_CB_v16u8;
+    CB_Type::built_in_types[static_CB_v8u16.uid] = &static_CB_v8u16;
+    CB_Type::built_in_types[static_CB_v4u32.uid] = &static_CB_v4u32;
+    CB_Type::built_in_types[static_CB_v2u64.uid] = &static_CB_v2u64;
+    CB_Type::built_in_types[static_CB_v4f32.uid] = &static_CB_v4f32;
+    CB_Type::built_in_types[static_CB_v2f64.uid] = &static_CB_v2f64;
+    CB_Type::built_in_types[static_CB_v8i32.uid] = &static_CB_v8i32;
+    CB_Type::built_in_types[static_CB_v4i64.uid] = &static_CB_v4i64;
+    CB_Type::built_in_types[static_CB_v8u32.uid] = &static_CB_v8u32;
+    CB_Type::built_in_types[static_CB_v4u64.uid] = &static_CB_v4u64;
+    CB_Type::built_in_types[static_CB_v8f32.uid] = &static_CB_v8f32;
+    CB_Type::built_in_types[static_CB_v4f64.uid] = &static_CB_v4f64;
     // only primitives - seq, set, function types and struct types are not included here
 }
 
@@ -371,6 +432,14 @@ int main()
     { CB_Fixed_seq s; s.v_type = CB_Int::type; s.size = 6; s.finalize(); test_type(&s); }
     { CB_Fixed_seq s; s.v_type = CB_i64::type; s.size = 5; s.finalize(); test_type(&s); }
 
+    { CB_Channel c; c.v_type = CB_Int::type; c.finalize(); test_type(&c); c.generate_typedef(std::cout); }
+    { CB_Channel c; c.v_type = CB_Int::type; c.finalize(); test_type(&c); } // same uid as above
+    { CB_Map m; m.k_type = CB_String::type; m.v_type = CB_Int::type; m.finalize(); test_type(&m); m.generate_typedef(std::cout); }
+    { CB_Map m; m.k_type = CB_String::type; m.v_type = CB_Int::type; m.finalize(); test_type(&m); } // same uid as above
+
+    test_type(CB_v4f32::type);
+    test_type(CB_v8i32::type);
+
 }
 
 #endif
@@ -3,12 +3,26 @@
 
 #include "debug.h" // defines DEBUG
 
-#ifdef DEBUG
 #include <stdexcept>
+
+#ifdef DEBUG
 #include <sstream>
 #include <iostream>
 #endif
 
+// thrown by failed asserts instead of exiting, if recoverable_asserts() is set
+// used by the compile server, so that one bad request doesn't take the server down (see compile_server.h)
+struct Assert_failure : std::runtime_error
+{
+    Assert_failure(const std::string& msg) : std::runtime_error{msg} {}
+};
+
+inline bool& recoverable_asserts()
+{
+    static bool recoverable = false;
+    return recoverable;
+}
+
 #ifdef DEBUG
 #	define _GET_ASSERT_MACRO(_1,_2,ASSERT,...) ASSERT
 #	define ASSERT(...) _GET_ASSERT_MACRO(__VA_ARGS__,_ASSERT2,_ASSERT1)(__VA_ARGS__)
@@ -23,6 +37,7 @@
         _assert_oss << __FILE__ << ":" << __LINE__                                      \
             << ": Assert failed: (" << #b << ")";                                       \
         std::cerr << _assert_oss.str() << std::endl;                                    \
+        if (recoverable_asserts()) throw Assert_failure(_assert_oss.str());             \
         exit(1);                                                                        \
     } while(0)
 #endif
@@ -35,6 +50,7 @@
             << ": Assert failed: (" << #b << ")";                                       \
         _assert_oss << ": " << msg;                                                     \
         std::cerr << _assert_oss.str() << std::endl;                                    \
+        if (recoverable_asserts()) throw Assert_failure(_assert_oss.str());             \
         exit(1);                                                                        \
     } while(0)
 #endif
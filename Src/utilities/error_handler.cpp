@@ -23,6 +23,18 @@ void exit_if_errors()
 }
 
 
+int error_count()
+{
+    return err_count;
+}
+
+
+void reset_error_count()
+{
+    err_count = 0;
+}
+
+
 void check_for_termination()
 {
     if (err_count >= err_max) {
@@ -47,6 +59,13 @@ void log_warning(const std::string& msg, const Token_context& context)
 }
 
 
+void log_info(const std::string& msg, const Token_context& context)
+{
+    if (!should_log) return;
+    std::cerr << std::endl << context.toS() << ": Info: " << msg << std::endl;
+}
+
+
 void add_note(const std::string& msg, const Token_context& context)
 {
     if (!should_log) return;
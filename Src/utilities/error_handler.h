@@ -6,11 +6,14 @@ struct Token_context;
 
 void log_error(const std::string& msg, const Token_context& context);
 void log_warning(const std::string& msg, const Token_context& context);
+void log_info(const std::string& msg, const Token_context& context); // compiler reports that are neither errors nor warnings
 
 void add_note(const std::string& msg, const Token_context& context);
 void add_note(const std::string& msg);
 
 void exit_if_errors();
+int error_count(); // the number of errors logged so far
+void reset_error_count(); // used by the compile server, so that every request starts without errors
 
 void set_logging(bool on); // if set to false, no errors will be logged. Default is true.
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+/*
+Simple non-cryptographic 64 bit hash (FNV-1a).
+Used to identify generated source files and other build artifacts by their content,
+    so that results from earlier compiler invocations can be reused.
+
+Hashes can be chained by passing the previous hash as seed:
+    uint64_t h = hash_string(a);
+    h = hash_string(b, h);
+*/
+
+const uint64_t HASH_SEED = 14695981039346656037ULL; // FNV-1a 64 bit offset basis
+const uint64_t HASH_PRIME = 1099511628211ULL;
+
+inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = HASH_SEED) {
+    uint64_t h = seed;
+    const uint8_t* it = (const uint8_t*)data;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= it[i];
+        h *= HASH_PRIME;
+    }
+    return h;
+}
+
+inline uint64_t hash_string(const std::string& s, uint64_t seed = HASH_SEED) {
+    return hash_bytes(s.data(), s.size(), seed);
+}
+
+// returns the hash as a fixed length hex string, suitable as a file name
+inline std::string hash_to_string(uint64_t h) {
+    static const char digits[] = "0123456789abcdef";
+    std::string s(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        s[i] = digits[h & 0xf];
+        h >>= 4;
+    }
+    return s;
+}
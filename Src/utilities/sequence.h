@@ -80,7 +80,7 @@ struct Seq {
         return v_ptr[index];
     }
 
-    template<typename T2> operator==(const Seq<T2>& seq) const { return false; }
+    template<typename T2> bool operator==(const Seq<T2>& seq) const { return false; }
     bool operator==(const Seq<T>& seq) const {
         if (size != seq.size) return false;
         if (v_ptr == *seq.v_ptr) return true;